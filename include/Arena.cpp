@@ -0,0 +1,192 @@
+/*! \file Arena.cpp
+    Arena Class Implementation.
+    \verbinclude Arena.cpp
+*/
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>                                  // max
+#include <cstring>                                    // memcpy
+#include <cstdint>                                    // uintptr_t
+#include "Arena.h"                                    // Declaration File
+
+namespace Arena
+{
+    //------------------------------Constructor---------------------------------//
+    Arena::Arena( size_t block_size )
+    {
+        _block_size = block_size;
+        _block = 0;
+        _free = NULL;
+        _free_size = 0;
+        _last = NULL;
+        _num_allocations = 0;
+        _num_bytes = 0;
+        _num_filled_bytes = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    Arena::~Arena()
+    {
+
+    }
+
+    //------------------------------Allocation----------------------------------//
+    bool Arena::nextBlock( size_t size )
+    {
+        if ( _free != NULL )
+        {
+            _num_filled_bytes += _block_sizes[_block - 1];
+        }
+
+        // Blocks kept by reset are reused in order
+        while ( _block < _blocks.size() )
+        {
+            if ( _block_sizes[_block] >= size )
+            {
+                _free = _blocks[_block].get();
+                _free_size = _block_sizes[_block];
+                _block++;
+                return true;
+            }
+            _block++;
+        }
+
+        size = std::max( size, _block_size );
+        _blocks.emplace_back( new char[size] );
+        _block_sizes.push_back( size );
+        _num_bytes += size;
+        _free = _blocks.back().get();
+        _free_size = size;
+        _block = _blocks.size();
+        return true;
+    }
+
+    char* Arena::allocate( size_t size, size_t alignment )
+    {
+        size_t padding;
+        char* start;
+
+        _num_allocations++;
+
+        // Reuse a freed object of the same size
+        for ( size_t i = 0; i < _free_lists.size(); i++ )
+        {
+            if ( _free_lists[i].size == size && _free_lists[i].head != NULL )
+            {
+                start = static_cast<char*>( _free_lists[i].head );
+                memcpy( &_free_lists[i].head, start, sizeof( void* ) );
+                return start;
+            }
+        }
+
+        padding = -reinterpret_cast<uintptr_t>( _free ) & ( alignment - 1 );
+        if ( _free == NULL || padding + size > _free_size )
+        {
+            Arena::nextBlock( size + alignment - 1 );
+            padding = -reinterpret_cast<uintptr_t>( _free ) & ( alignment - 1 );
+        }
+        start = _free + padding;
+        _free += padding + size;
+        _free_size -= padding + size;
+        _last = start;
+        return start;
+    }
+
+    void Arena::deallocate( void* start, size_t size )
+    {
+        size_t i;
+
+        // The last allocation goes back to the block
+        if ( start == _last && _last + size == _free )
+        {
+            _free = _last;
+            _free_size += size;
+            _last = NULL;
+            return;
+        }
+
+        // Objects too small to hold a link are left until reset
+        if ( size < sizeof( void* ) )
+        {
+            return;
+        }
+        for ( i = 0; i < _free_lists.size() && _free_lists[i].size != size; i++ );
+        if ( i == _free_lists.size() )
+        {
+            _free_lists.push_back( FreeList{ size, NULL } );
+        }
+        memcpy( start, &_free_lists[i].head, sizeof( void* ) );
+        _free_lists[i].head = start;
+    }
+
+    std::string_view Arena::copy( std::string_view text )
+    {
+        char* start = Arena::allocate( text.size(), 1 );
+
+        memcpy( start, text.data(), text.size() );
+        return std::string_view( start, text.size() );
+    }
+
+    FastQ::FastQView Arena::copyRecord( const FastQ::FastQView& record )
+    {
+        FastQ::FastQView copy;
+        char* start = Arena::allocate( record.id.size() + record.sequence.size() +
+                                       record.line3.size() + record.quality.size(), 1 );
+
+        // One allocation holds all four fields
+        memcpy( start, record.id.data(), record.id.size() );
+        copy.id = std::string_view( start, record.id.size() );
+        start += record.id.size();
+        memcpy( start, record.sequence.data(), record.sequence.size() );
+        copy.sequence = std::string_view( start, record.sequence.size() );
+        start += record.sequence.size();
+        memcpy( start, record.line3.data(), record.line3.size() );
+        copy.line3 = std::string_view( start, record.line3.size() );
+        start += record.line3.size();
+        memcpy( start, record.quality.data(), record.quality.size() );
+        copy.quality = std::string_view( start, record.quality.size() );
+        return copy;
+    }
+
+    void Arena::reset()
+    {
+        _block = 0;
+        _free = NULL;
+        _free_size = 0;
+        _last = NULL;
+        _free_lists.clear();
+        _num_filled_bytes = 0;
+    }
+
+    void Arena::clear()
+    {
+        Arena::reset();
+        _blocks.clear();
+        _block_sizes.clear();
+        _num_bytes = 0;
+    }
+
+    //-------------------------------Counters-----------------------------------//
+    unsigned long long Arena::getNumAllocations() const
+    {
+        return _num_allocations;
+    }
+
+    size_t Arena::getNumBlocks() const
+    {
+        return _blocks.size();
+    }
+
+    unsigned long long Arena::getMemoryUsage() const
+    {
+        return _num_bytes;
+    }
+
+    unsigned long long Arena::getUsedMemory() const
+    {
+        return _num_filled_bytes + ( _free != NULL ? _block_sizes[_block - 1] - _free_size : 0 );
+    }
+
+} // namespace Arena
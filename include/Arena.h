@@ -0,0 +1,185 @@
+/*! \file Arena.h
+    Arena Class Declaration.
+    \verbinclude Arena.h
+*/
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include "FastQ.h"                                    // FastQView
+
+namespace Arena
+{
+    /** \class Arena
+        \brief A block allocator for records and container nodes.
+
+        Memory is handed out from large blocks by moving a pointer, so storing
+        millions of small objects costs a few block allocations instead of one
+        malloc each. Freed objects are kept in per-size free lists and reused
+        (a slab), which suits the fixed-size nodes of std::map and std::set.
+        reset() rewinds the arena while keeping its blocks, so a batch that is
+        rebuilt repeatedly reaches a steady state with no allocation at all.
+        An Arena is not thread safe, use one per thread.
+    */
+    class Arena
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \struct FreeList
+                \brief Freed objects of one size, linked through their own memory.
+            */
+            struct FreeList
+            {
+                size_t size;                       /**<Size of each object. */
+                void* head;                        /**<First free object. */
+            };
+
+            std::vector<std::unique_ptr<char[]> > _blocks;  /**<Allocated blocks. */
+            std::vector<size_t> _block_sizes;      /**<Size of each block. */
+            std::vector<FreeList> _free_lists;     /**<Freed objects by size. */
+            size_t _block_size;                    /**<Size of a new block. */
+            size_t _block;                         /**<Block being filled. */
+            char* _free;                           /**<Unused space of the current block. */
+            size_t _free_size;                     /**<Bytes left in the current block. */
+            char* _last;                           /**<Start of the last allocation. */
+            unsigned long long _num_allocations;   /**<Calls to allocate. */
+            unsigned long long _num_bytes;         /**<Bytes in blocks. */
+            unsigned long long _num_filled_bytes;  /**<Bytes in blocks filled before the current one. */
+
+            bool nextBlock( size_t size );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the Arena object.
+                Constructs an empty Arena, no block is allocated until the first object.
+                @param block_size size of each block in bytes
+            */
+            explicit Arena( size_t block_size = 1024 * 1024 );
+
+            /** \fn Destructor */
+            ~Arena();
+
+            Arena( const Arena& ) = delete;
+            Arena& operator=( const Arena& ) = delete;
+
+            /**
+                \fn allocate
+                \brief Returns uninitialized memory that lives until the arena is reset.
+                @param size bytes needed
+                @param alignment power of two, 1 for packed byte records
+                @return Start of the memory
+            */
+            char* allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+
+            /**
+                \fn deallocate
+                \brief Returns an object to the free list of its size, for reuse by allocate.
+                The most recent allocation is given back to the block instead.
+                @param start memory returned by allocate
+                @param size size passed to allocate
+            */
+            void deallocate( void* start, size_t size );
+
+            /**
+                \fn copy
+                \brief Copies text into the arena.
+                @param text text to copy
+                @return View of the copy
+            */
+            std::string_view copy( std::string_view text );
+
+            /**
+                \fn copyRecord
+                \brief Copies the fields of a record into the arena.
+                @param record record to copy, ex. a view into a buffer about to be reused
+                @return View of the copy
+            */
+            FastQ::FastQView copyRecord( const FastQ::FastQView& record );
+
+            /**
+                \fn reset
+                \brief Frees every object at once but keeps the blocks for the next batch.
+            */
+            void reset();
+
+            /**
+                \fn clear
+                \brief Frees every object and block.
+            */
+            void clear();
+
+            /**
+                \fn getNumAllocations
+                \brief Returns the number of objects allocated since the arena was constructed.
+                @return Allocations
+            */
+            unsigned long long getNumAllocations() const;
+
+            /**
+                \fn getNumBlocks
+                \brief Returns the number of blocks, the only allocations made from the heap.
+                @return Blocks
+            */
+            size_t getNumBlocks() const;
+
+            /**
+                \fn getMemoryUsage
+                \brief Returns the memory held in blocks.
+                @return Bytes
+            */
+            unsigned long long getMemoryUsage() const;
+
+            /**
+                \fn getUsedMemory
+                \brief Returns the memory handed out since the last reset, the touched part of the blocks.
+                @return Bytes
+            */
+            unsigned long long getUsedMemory() const;
+
+    }; // class Arena
+
+    /** \class ArenaAllocator
+        \brief Standard allocator drawing from an Arena, for std::map and std::set nodes.
+    */
+    template <typename T>
+    class ArenaAllocator
+    {
+        public:
+            typedef T value_type;
+
+            Arena* arena;                          /**<Source of the memory. */
+
+            ArenaAllocator( Arena& source ) : arena( &source ) {}
+
+            template <typename U>
+            ArenaAllocator( const ArenaAllocator<U>& other ) : arena( other.arena ) {}
+
+            T* allocate( size_t n )
+            {
+                return reinterpret_cast<T*>( arena->allocate( n * sizeof( T ), alignof( T ) ) );
+            }
+
+            void deallocate( T* start, size_t n )
+            {
+                arena->deallocate( start, n * sizeof( T ) );
+            }
+    };
+
+    template <typename T, typename U>
+    bool operator==( const ArenaAllocator<T>& first, const ArenaAllocator<U>& second )
+    {
+        return first.arena == second.arena;
+    }
+
+    template <typename T, typename U>
+    bool operator!=( const ArenaAllocator<T>& first, const ArenaAllocator<U>& second )
+    {
+        return first.arena != second.arena;
+    }
+
+} // namespace Arena
@@ -0,0 +1,130 @@
+/*! \file BoundedQueue.h
+    BoundedQueue Class Declaration and Implementation.
+    \verbinclude BoundedQueue.h
+*/
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace BoundedQueue
+{
+    /** \class BoundedQueue
+        \brief A blocking first-in first-out queue with a maximum size.
+
+        Producers block while the queue is full and consumers block while it is
+        empty, so a fast producer cannot run arbitrarily far ahead of its consumer.
+        Closing the queue wakes everyone: pushes fail, and pops drain what is left.
+    */
+    template <typename T> class BoundedQueue
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            std::deque<T> _items;                  /**<Queued items. */
+            size_t _capacity;                      /**<Maximum number of items. */
+            bool _closed;                          /**<No more items will be pushed. */
+            std::mutex _mutex;
+            std::condition_variable _not_empty;
+            std::condition_variable _not_full;
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs an open BoundedQueue.
+                @param capacity maximum number of queued items
+            */
+            explicit BoundedQueue( size_t capacity = 16 )
+            {
+                _capacity = capacity > 0 ? capacity : 1;
+                _closed = false;
+            }
+
+            /**
+                \fn setCapacity
+                \brief Sets the maximum number of queued items.
+                @param capacity maximum number of queued items
+            */
+            void setCapacity( size_t capacity )
+            {
+                std::lock_guard<std::mutex> lock( _mutex );
+                _capacity = capacity > 0 ? capacity : 1;
+            }
+
+            /**
+                \fn push
+                \brief Adds an item, waiting while the queue is full.
+                @param item item to move into the queue
+                @return False if the queue was closed
+            */
+            bool push( T&& item )
+            {
+                std::unique_lock<std::mutex> lock( _mutex );
+                _not_full.wait( lock, [this]()
+                {
+                    return _closed || _items.size() < _capacity;
+                } );
+                if ( _closed )
+                {
+                    return false;
+                }
+                _items.push_back( std::move( item ) );
+                lock.unlock();
+                _not_empty.notify_one();
+                return true;
+            }
+
+            /**
+                \fn pop
+                \brief Removes the oldest item, waiting while the queue is empty.
+                @param item item moved out of the queue
+                @return False once the queue is closed and empty
+            */
+            bool pop( T& item )
+            {
+                std::unique_lock<std::mutex> lock( _mutex );
+                _not_empty.wait( lock, [this]()
+                {
+                    return _closed || !_items.empty();
+                } );
+                if ( _items.empty() )
+                {
+                    return false;
+                }
+                item = std::move( _items.front() );
+                _items.pop_front();
+                lock.unlock();
+                _not_full.notify_one();
+                return true;
+            }
+
+            /**
+                \fn close
+                \brief Closes the queue and wakes all waiting threads.
+            */
+            void close()
+            {
+                {
+                    std::lock_guard<std::mutex> lock( _mutex );
+                    _closed = true;
+                }
+                _not_empty.notify_all();
+                _not_full.notify_all();
+            }
+
+            /**
+                \fn reopen
+                \brief Empties and reopens a closed queue so it can be reused.
+            */
+            void reopen()
+            {
+                std::lock_guard<std::mutex> lock( _mutex );
+                _items.clear();
+                _closed = false;
+            }
+
+    }; // class BoundedQueue
+
+} // namespace BoundedQueue
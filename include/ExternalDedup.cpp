@@ -0,0 +1,381 @@
+/*! \file ExternalDedup.cpp
+    ExternalDedup Class Implementation.
+    \verbinclude ExternalDedup.cpp
+*/
+
+#include <iostream>
+#include <sstream>
+#include <queue>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include "ExternalDedup.h"                            // Declaration File
+#include "FastQReader.h"                              // Run file input
+#include "QualityKernel.h"                            // Expected errors of best-quality
+
+namespace ExternalDedup
+{
+    static const size_t MAX_MERGE_RUNS = 64;          // Run files open at once
+    static const size_t RUN_RELEASE_SIZE = 256 * 1024;  // Run file bytes read between page releases
+
+    bool parseMemoryLimit( const std::string& text, size_t& bytes )
+    {
+        std::istringstream limit( text );
+        unsigned long long value;
+        char unit = 'B';
+
+        if ( !( limit >> value ) )
+        {
+            return false;
+        }
+        limit >> unit;
+        switch ( unit )
+        {
+            case 'G':
+            case 'g':
+                value *= 1024;
+            // Fall through
+            case 'M':
+            case 'm':
+                value *= 1024;
+            // Fall through
+            case 'K':
+            case 'k':
+                value *= 1024;
+            // Fall through
+            case 'B':
+                break;
+            default:
+                return false;
+        }
+        bytes = value;
+        return bytes > 0 && limit.peek() == EOF;
+    }
+
+    // Orders records as the modules write them, pairs as PackedSeq::PairedSequenceLess,
+    // or PackedSeq::CanonicalPairLess
+    static int compareRecords( FastQ::FastQView first_a, FastQ::FastQView second_a,
+                               FastQ::FastQView first_b, FastQ::FastQView second_b, bool paired,
+                               bool canonical )
+    {
+        size_t common;
+        int order;
+
+        if ( !paired )
+        {
+            return first_a.sequence.compare( first_b.sequence );
+        }
+        if ( canonical && second_a.sequence < first_a.sequence )
+        {
+            std::swap( first_a, second_a );
+        }
+        if ( canonical && second_b.sequence < first_b.sequence )
+        {
+            std::swap( first_b, second_b );
+        }
+
+        // A first sequence sorts after the longer ones it is a prefix of
+        common = std::min( first_a.sequence.size(), first_b.sequence.size() );
+        order = first_a.sequence.substr( 0, common ).compare( first_b.sequence.substr( 0, common ) );
+        if ( order != 0 )
+        {
+            return order;
+        }
+        if ( first_a.sequence.size() != first_b.sequence.size() )
+        {
+            return first_a.sequence.size() > first_b.sequence.size() ? -1 : 1;
+        }
+        return second_a.sequence.compare( second_b.sequence );
+    }
+
+    //------------------------------Constructor---------------------------------//
+    ExternalDedup::ExternalDedup( bool paired )
+    {
+        const char* temp_dir = getenv( "TMPDIR" );
+
+        _paired = paired;
+        _keep_first = false;
+        _best_quality_phred = 0;
+        _canonical = false;
+        _temp_dir = temp_dir != NULL && temp_dir[0] != '\0' ? temp_dir : "/tmp";
+    }
+
+    //------------------------------Destructor----------------------------------//
+    ExternalDedup::~ExternalDedup()
+    {
+        ExternalDedup::removeRuns( 0, _runs_first.size() );
+    }
+
+    //------------------------------Configuration-------------------------------//
+    void ExternalDedup::setKeepFirst( bool keep_first )
+    {
+        _keep_first = keep_first;
+    }
+
+    void ExternalDedup::setKeepBestQuality( int phred_offset )
+    {
+        _best_quality_phred = phred_offset;
+    }
+
+    void ExternalDedup::setCanonical( bool canonical )
+    {
+        _canonical = canonical;
+    }
+
+    //-------------------------------Run Files----------------------------------//
+    bool ExternalDedup::createRunFile( std::string& file_name )
+    {
+        std::vector<char> name_template;
+        int fd;
+
+        file_name = _temp_dir + "/NGSXDedupRun.XXXXXX";
+        name_template.assign( file_name.begin(), file_name.end() );
+        name_template.push_back( '\0' );
+        fd = mkstemp( name_template.data() );
+        if ( fd < 0 )
+        {
+            std::cerr << "ERROR: Cannot create a run file in: " << _temp_dir << std::endl;
+            return false;
+        }
+        close( fd );
+        file_name = name_template.data();
+        return true;
+    }
+
+    void ExternalDedup::removeRuns( size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            unlink( _runs_first[i].c_str() );
+            if ( _paired )
+            {
+                unlink( _runs_second[i].c_str() );
+            }
+        }
+    }
+
+    bool ExternalDedup::startRun()
+    {
+        _runs_first.push_back( std::string() );
+        _runs_second.push_back( std::string() );
+        if ( !ExternalDedup::createRunFile( _runs_first.back() ) ||
+                        ( _paired && !ExternalDedup::createRunFile( _runs_second.back() ) ) )
+        {
+            return false;
+        }
+        if ( !_run_writer.getFirst().open( _runs_first.back() ) ||
+                        ( _paired && !_run_writer.getSecond().open( _runs_second.back() ) ) )
+        {
+            std::cerr << "ERROR: Cannot open run file: " << _runs_first.back() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void ExternalDedup::write( const FastQ::FastQView& record )
+    {
+        _run_writer.getFirst().write( record );
+    }
+
+    void ExternalDedup::write( const FastQ::FastQView& first, const FastQ::FastQView& second )
+    {
+        _run_writer.write( first, second );
+    }
+
+    bool ExternalDedup::endRun()
+    {
+        if ( !( _paired ? _run_writer.close() : _run_writer.getFirst().close() ) )
+        {
+            std::cerr << "ERROR: Cannot write run file: " << _runs_first.back() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    size_t ExternalDedup::getNumRuns() const
+    {
+        return _runs_first.size();
+    }
+
+    //--------------------------------Merging-----------------------------------//
+    bool ExternalDedup::mergeRuns( size_t begin, size_t end, WriteFunction write,
+                                   unsigned long long& num_written )
+    {
+        size_t num_runs = end - begin;
+        std::vector<std::unique_ptr<FastQReader::FastQReader> > readers_first( num_runs );
+        std::vector<std::unique_ptr<FastQReader::FastQReader> > readers_second( num_runs );
+        std::vector<FastQ::FastQView> records_first( num_runs );
+        std::vector<FastQ::FastQView> records_second( num_runs );
+        std::vector<size_t> released( num_runs, 0 );
+        std::vector<size_t> equal_runs;
+        size_t kept_run;
+        uint64_t kept_errors;
+        uint64_t run_errors;
+
+        // Smallest record first, and the earlier run first for a shared sequence
+        auto later_run = [&]( size_t first, size_t second )
+        {
+            int order = compareRecords( records_first[first], records_second[first], records_first[second],
+                                        records_second[second], _paired, _canonical );
+            return order > 0 || ( order == 0 && first > second );
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype( later_run )> merge_queue( later_run );
+
+        // Views of a run are valid until its next record is read, the pages before
+        // it are released often, as many runs are read at once
+        auto nextRecord = [&]( size_t run )
+        {
+            size_t record_start = readers_first[run]->getOffset();
+
+            if ( record_start - released[run] >= RUN_RELEASE_SIZE )
+            {
+                readers_first[run]->releasePages( record_start );
+                if ( _paired )
+                {
+                    readers_second[run]->releasePages( readers_second[run]->getOffset() );
+                }
+                released[run] = record_start;
+            }
+            if ( !readers_first[run]->nextRecord( records_first[run] ) )
+            {
+                return false;
+            }
+            if ( _paired && !readers_second[run]->nextRecord( records_second[run] ) )
+            {
+                records_second[run] = FastQ::FastQView();
+            }
+            return true;
+        };
+
+        for ( size_t run = 0; run < num_runs; run++ )
+        {
+            readers_first[run].reset( new FastQReader::FastQReader() );
+            readers_second[run].reset( new FastQReader::FastQReader() );
+            readers_first[run]->setRetainBuffers( false );
+            readers_second[run]->setRetainBuffers( false );
+            if ( !readers_first[run]->open( _runs_first[begin + run] ) ||
+                            ( _paired && !readers_second[run]->open( _runs_second[begin + run] ) ) )
+            {
+                std::cerr << "ERROR: Cannot open run file: " << _runs_first[begin + run] << std::endl;
+                return false;
+            }
+            if ( nextRecord( run ) )
+            {
+                merge_queue.push( run );
+            }
+        }
+
+        num_written = 0;
+        while ( !merge_queue.empty() )
+        {
+            // Every run holding the smallest sequence, earliest first, the latest
+            // run's record is kept unless the first copy is
+            equal_runs.clear();
+            do
+            {
+                equal_runs.push_back( merge_queue.top() );
+                merge_queue.pop();
+            }
+            while ( !merge_queue.empty() && compareRecords( records_first[merge_queue.top()],
+                            records_second[merge_queue.top()], records_first[equal_runs[0]],
+                            records_second[equal_runs[0]], _paired, _canonical ) == 0 );
+
+            kept_run = _keep_first || _best_quality_phred != 0 ? equal_runs.front() : equal_runs.back();
+            if ( _best_quality_phred != 0 )
+            {
+                auto getErrors = [&]( size_t run )
+                {
+                    return QualityKernel::sumErrorProbabilities( records_first[run].quality,
+                                    _best_quality_phred ) + ( _paired ? QualityKernel::sumErrorProbabilities(
+                                                records_second[run].quality, _best_quality_phred ) : 0 );
+                };
+                kept_errors = getErrors( kept_run );
+                for ( size_t i = 1; i < equal_runs.size(); i++ )
+                {
+                    run_errors = getErrors( equal_runs[i] );
+                    if ( run_errors < kept_errors )
+                    {
+                        kept_run = equal_runs[i];
+                        kept_errors = run_errors;
+                    }
+                }
+            }
+            write( records_first[kept_run], records_second[kept_run] );
+            num_written++;
+
+            for ( size_t i = 0; i < equal_runs.size(); i++ )
+            {
+                if ( nextRecord( equal_runs[i] ) )
+                {
+                    merge_queue.push( equal_runs[i] );
+                }
+            }
+        }
+        return true;
+    }
+
+    bool ExternalDedup::reduceRuns()
+    {
+        size_t num_runs = _runs_first.size();
+        unsigned long long num_merged;
+        size_t end;
+
+        // Consecutive runs are merged into a new run, so the runs stay in input order
+        for ( size_t begin = 0; begin < num_runs; begin = end )
+        {
+            end = std::min( begin + MAX_MERGE_RUNS, num_runs );
+            if ( !ExternalDedup::startRun() || !ExternalDedup::mergeRuns( begin, end,
+                            [&]( const FastQ::FastQView& first, const FastQ::FastQView& second )
+        {
+            _paired ? _run_writer.write( first, second ) : _run_writer.getFirst().write( first );
+            }, num_merged ) || !ExternalDedup::endRun() )
+            {
+                return false;
+            }
+            ExternalDedup::removeRuns( begin, end );
+        }
+        _runs_first.erase( _runs_first.begin(), _runs_first.begin() + num_runs );
+        _runs_second.erase( _runs_second.begin(), _runs_second.begin() + num_runs );
+        return true;
+    }
+
+    bool ExternalDedup::mergeAll( WriteFunction write, unsigned long long& num_written )
+    {
+        while ( _runs_first.size() > MAX_MERGE_RUNS )
+        {
+            if ( !ExternalDedup::reduceRuns() )
+            {
+                return false;
+            }
+        }
+        if ( !ExternalDedup::mergeRuns( 0, _runs_first.size(), write, num_written ) )
+        {
+            return false;
+        }
+        ExternalDedup::removeRuns( 0, _runs_first.size() );
+        _runs_first.clear();
+        _runs_second.clear();
+        return true;
+    }
+
+    bool ExternalDedup::merge( FastQWriter::FastQWriter& output, unsigned long long& num_written )
+    {
+        return ExternalDedup::mergeAll( [&]( const FastQ::FastQView& first,
+                                             const FastQ::FastQView& )
+        {
+            output.write( first );
+        }, num_written );
+    }
+
+    bool ExternalDedup::merge( FastQWriter::FastQPairedWriter& output,
+                               unsigned long long& num_written )
+    {
+        return ExternalDedup::mergeAll( [&]( const FastQ::FastQView& first,
+                                             const FastQ::FastQView& second )
+        {
+            output.write( first, second );
+        }, num_written );
+    }
+
+} // namespace ExternalDedup
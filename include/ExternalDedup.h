@@ -0,0 +1,157 @@
+/*! \file ExternalDedup.h
+    ExternalDedup Class Declaration.
+    \verbinclude ExternalDedup.h
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include "FastQ.h"                                    // FastQView
+#include "FastQWriter.h"                              // Run files
+
+namespace ExternalDedup
+{
+    /**
+        \fn parseMemoryLimit
+        \brief Parses a memory size, ex. "512M", with an optional K, M or G suffix.
+        @param text size
+        @param bytes set to the size in bytes
+        @return False if the size is invalid or zero
+    */
+    bool parseMemoryLimit( const std::string& text, size_t& bytes );
+
+    /** \class ExternalDedup
+        \brief Sorted runs of unique records spilled to disk, merged into one sorted output.
+
+        The dedup modules fill their in-memory structures up to a memory limit,
+        then write the unique records of that run, sorted as their output, to a
+        temporary fastq file (two for pairs). Runs are merged like the sorted
+        chunks of QualityControl: records come out sorted, and when several runs
+        hold the same sequence the record of the latest run is kept (the
+        earliest with setKeepFirst), so the result matches the in-memory path. At most MAX_MERGE_RUNS files are
+        open at once, more runs are first merged in groups. Run files are
+        created in $TMPDIR (or /tmp) and removed as soon as they are merged.
+    */
+    class ExternalDedup
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \typedef WriteFunction
+                \brief Receives merged records (pairs) in output order.
+            */
+            typedef std::function<void( const FastQ::FastQView& first, const FastQ::FastQView& second )>
+            WriteFunction;
+
+            std::vector<std::string> _runs_first;  /**<Run files, in input order. */
+            std::vector<std::string> _runs_second; /**<Second mate run files. */
+            bool _paired;                          /**<Runs hold mate pairs. */
+            bool _keep_first;                      /**<The earliest run wins a shared sequence. */
+            int _best_quality_phred;               /**<Encoding when the fewest errors win, or 0. */
+            bool _canonical;                       /**<Runs are in PackedSeq::CanonicalPairLess order. */
+            std::string _temp_dir;                 /**<Directory of the run files. */
+            FastQWriter::FastQPairedWriter _run_writer;  /**<Run being written. */
+
+            bool createRunFile( std::string& file_name );
+            bool mergeRuns( size_t begin, size_t end, WriteFunction write,
+                            unsigned long long& num_written );
+            void removeRuns( size_t begin, size_t end );
+            bool reduceRuns();
+            bool mergeAll( WriteFunction write, unsigned long long& num_written );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the ExternalDedup object with no runs.
+                @param paired runs hold mate pairs, ordered as PackedSeq::PairedSequenceLess
+            */
+            explicit ExternalDedup( bool paired = false );
+
+            /** \fn Destructor, removes any run file left */
+            ~ExternalDedup();
+
+            ExternalDedup( const ExternalDedup& ) = delete;
+            ExternalDedup& operator=( const ExternalDedup& ) = delete;
+
+            /**
+                \fn setKeepFirst
+                \brief Keeps the record of the earliest run holding a sequence, not the latest.
+                @param keep_first keep the first copy, as --keep first
+            */
+            void setKeepFirst( bool keep_first );
+
+            /**
+                \fn setKeepBestQuality
+                \brief Keeps the record with the fewest expected errors, of both mates for pairs.
+                Ties go to the earliest run.
+                @param phred_offset quality encoding, 33 or 64, or 0 for run order
+            */
+            void setKeepBestQuality( int phred_offset );
+
+            /**
+                \fn setCanonical
+                \brief Merges pairs in PackedSeq::CanonicalPairLess order, swapped mates are duplicates.
+                @param canonical ignore mate orientation
+            */
+            void setCanonical( bool canonical );
+
+            /**
+                \fn startRun
+                \brief Creates the file(s) of the next run.
+                @return False after printing an error
+            */
+            bool startRun();
+
+            /**
+                \fn write
+                \brief Appends a record to the current run, in output order.
+                @param record record
+            */
+            void write( const FastQ::FastQView& record );
+
+            /**
+                \fn write
+                \brief Appends a pair to the current run, in output order.
+                @param first first mate
+                @param second second mate
+            */
+            void write( const FastQ::FastQView& first, const FastQ::FastQView& second );
+
+            /**
+                \fn endRun
+                \brief Closes the current run.
+                @return False after printing an error
+            */
+            bool endRun();
+
+            /**
+                \fn getNumRuns
+                \brief Returns the number of runs written.
+                @return Runs
+            */
+            size_t getNumRuns() const;
+
+            /**
+                \fn merge
+                \brief Merges every run into the output, the latest run wins a shared sequence.
+                @param output output fastq file
+                @param num_written set to the number of records written
+                @return False after printing an error
+            */
+            bool merge( FastQWriter::FastQWriter& output, unsigned long long& num_written );
+
+            /**
+                \fn merge
+                \brief Merges every run of pairs into the output.
+                @param output output fastq files
+                @param num_written set to the number of pairs written
+                @return False after printing an error
+            */
+            bool merge( FastQWriter::FastQPairedWriter& output, unsigned long long& num_written );
+
+    }; // class ExternalDedup
+
+} // namespace ExternalDedup
@@ -6,13 +6,43 @@
 
 #include <iostream>
 #include <string>
+#include <utility>                                   // std::move
 #include <algorithm>                                 // Counting char occurences
 #include "FastQ.h"
+#include "QualityKernel.h"                           // Error probability sums
 #include <math.h>     /* log10 */
-#include <cmath>      /* power exponents */
 
 namespace FastQ
 {
+    //------------------------------Read Names---------------------------------//
+    std::string_view getReadName( std::string_view id )
+    {
+        size_t comment = id.find_first_of( " \t" );
+
+        if ( comment != std::string_view::npos )
+        {
+            id = id.substr( 0, comment );
+        }
+        if ( id.size() > 2 && id[id.size() - 2] == '/' && ( id.back() == '1' || id.back() == '2' ) )
+        {
+            id.remove_suffix( 2 );
+        }
+        return id;
+    }
+
+    //-----------------------------FastQView-----------------------------------//
+    int FastQView::getLength() const
+    {
+        return sequence.length();
+    }
+
+    float FastQView::getGC() const
+    {
+        return ( ( std::count( sequence.begin(), sequence.end(), 'G' ) +
+                std::count( sequence.begin(), sequence.end(), 'C' ) ) /
+                                        double( sequence.length() ) * 100 );
+    }
+
     //------------------------------Constructor---------------------------------//
     FastQ::FastQ()
     {
@@ -25,6 +55,12 @@ namespace FastQ
         _av_qual = 0;
     }
 
+    FastQ::FastQ( const FastQView& view )
+    {
+        _av_qual = 0;
+        FastQ::setRecord( view );
+    }
+
     //------------------------------Destructor---------------------------------//
     FastQ::~FastQ()
     {
@@ -32,23 +68,45 @@ namespace FastQ
     }
 
     //-------------------------Set and Delete Record---------------------------//
-    void FastQ::setRecord( std::string id, std::string sequence, std::string line3,
-                    std::string quality )
+    void FastQ::setRecord( std::string&& id, std::string&& sequence, std::string&& line3,
+                    std::string&& quality )
+    {
+        _id = std::move( id );
+        _sequence = std::move( sequence );
+        _line3 = std::move( line3 );
+        _quality = std::move( quality );
+        FastQ::setLength();
+        FastQ::setGC();
+    }
+
+    void FastQ::setRecord( const FastQView& view )
     {
-        _id = id;
-        _sequence = sequence;
-        _line3 = line3;
-        _quality = quality;
+        // assign keeps the capacity, so no allocation once the fields are large enough
+        _id.assign( view.id );
+        _sequence.assign( view.sequence );
+        _line3.assign( view.line3 );
+        _quality.assign( view.quality );
         FastQ::setLength();
         FastQ::setGC();
     }
 
+    FastQView FastQ::getView() const
+    {
+        FastQView view;
+
+        view.id = _id;
+        view.sequence = _sequence;
+        view.line3 = _line3;
+        view.quality = _quality;
+        return view;
+    }
+
     void FastQ::delRecord()
     {
-        _id = "";
-        _sequence = "";
-        _line3 = "";
-        _quality = "";
+        _id.clear();
+        _sequence.clear();
+        _line3.clear();
+        _quality.clear();
     }
 
     //--------------------------Calculate Attributes----------------------------//
@@ -64,60 +122,55 @@ namespace FastQ
                 std::count( _sequence.begin(), _sequence.end(), 'C' ) ) /
                                         double( _length ) * 100 );
     }
-    // Average Quality
+    // Average Quality, the Phred score of the mean error probability of the bases
     void FastQ::setAvQual(int phred_encode)
     {
+        uint64_t total_probability;
 
-        double total_probability = 0;
-        double average_probability;
-	int char_phred_qual;
-	double char_phred_prob;
-
-        // Iterate through sequence, adding up quality probability of each nucleotide.
-        for ( int i = 0; i < _length; i++ )
+        if ( _quality.empty() )
         {
-            char_phred_qual = int(_sequence[i]) - phred_encode;
-            char_phred_prob = std::pow(10,(-1 * char_phred_qual / 10));
-            total_probability += char_phred_prob;
+            _av_qual = 0;
+            return;
         }
+        total_probability = QualityKernel::sumErrorProbabilities( _quality, phred_encode );
 
-        average_probability = total_probability / double(_length);
-        _av_qual = -10*(log10(average_probability));
-
+        // Bases above Phred 72 round to no error, the mean is kept finite
+        _av_qual = -10 * log10( std::max<uint64_t>( total_probability, 1 ) /
+                                double( QualityKernel::ERROR_SCALE ) / _quality.length() );
     }
 
     //-----------------------------Get Attributes-------------------------------//
-    std::string FastQ::getID()
+    const std::string& FastQ::getID() const
     {
         return _id;
     }
 
-    std::string FastQ::getSeq()
+    const std::string& FastQ::getSeq() const
     {
         return _sequence;
     }
 
-    std::string FastQ::getLine3()
+    const std::string& FastQ::getLine3() const
     {
         return _line3;
     }
 
-    std::string FastQ::getQual()
+    const std::string& FastQ::getQual() const
     {
         return _quality;
     }
 
-    int FastQ::getLength()
+    int FastQ::getLength() const
     {
         return _length;
     }
 
-    float FastQ::getGC()
+    float FastQ::getGC() const
     {
         return _GC;
     }
 
-    float FastQ::getAvQual()
+    float FastQ::getAvQual() const
     {
         return _av_qual;
     }
@@ -127,15 +180,6 @@ namespace FastQ
     //------------------------------Constructor---------------------------------//
     FastQPaired::FastQPaired()
     {
-        _id_first = "";
-        _sequence_first = "";
-        _line3_first = "";
-        _quality_first = "";
-
-        _id_second = "";
-        _sequence_second = "";
-        _line3_second = "";
-        _quality_second = "";
 
     }
 
@@ -146,74 +190,74 @@ namespace FastQ
     }
 
     //-------------------------Set and Delete Record---------------------------//
-    void FastQPaired::setRecord( FastQ fastq_first,
-                    FastQ fastq_second )
+    void FastQPaired::setRecord( FastQ&& fastq_first, FastQ&& fastq_second )
     {
-        _id_first = fastq_first.getID();
-        _sequence_first = fastq_first.getSeq();
-        _line3_first = fastq_first.getLine3();
-        _quality_first = fastq_first.getQual();
-
-        _id_second = fastq_second.getID();
-        _sequence_second = fastq_second.getSeq();
-        _line3_second = fastq_second.getLine3();
-        _quality_second = fastq_second.getQual();
+        _first = std::move( fastq_first );
+        _second = std::move( fastq_second );
+    }
 
+    void FastQPaired::setRecord( const FastQView& view_first, const FastQView& view_second )
+    {
+        _first.setRecord( view_first );
+        _second.setRecord( view_second );
     }
 
     void FastQPaired::delRecord()
     {
-        _id_first = "";
-        _sequence_first = "";
-        _line3_first = "";
-        _quality_first = "";
-
-        _id_second = "";
-        _sequence_second = "";
-        _line3_second = "";
-        _quality_second = "";
+        _first.delRecord();
+        _second.delRecord();
     }
 
 
     //-----------------------------Get Attributes-------------------------------//
-    std::string FastQPaired::getIDFirst()
+    const FastQ& FastQPaired::getFirst() const
+    {
+        return _first;
+    }
+
+    const FastQ& FastQPaired::getSecond() const
+    {
+        return _second;
+    }
+
+    const std::string& FastQPaired::getIDFirst() const
     {
-        return _id_first;
+        return _first.getID();
     }
 
-    std::string FastQPaired::getIDSecond()
+    const std::string& FastQPaired::getIDSecond() const
     {
-        return _id_second;
+        return _second.getID();
     }
 
-    std::string FastQPaired::getSeqFirst()
+    const std::string& FastQPaired::getSeqFirst() const
     {
-        return _sequence_first;
+        return _first.getSeq();
     }
 
-    std::string FastQPaired::getSeqSecond()
+    const std::string& FastQPaired::getSeqSecond() const
     {
-        return _sequence_second;
+        return _second.getSeq();
     }
 
-    std::string FastQPaired::getLine3First()
+    const std::string& FastQPaired::getLine3First() const
     {
-        return _line3_first;
+        return _first.getLine3();
     }
 
-    std::string FastQPaired::getLine3Second()
+    const std::string& FastQPaired::getLine3Second() const
     {
-        return _line3_second;
+        return _second.getLine3();
     }
 
-    std::string FastQPaired::getQualFirst()
+    const std::string& FastQPaired::getQualFirst() const
     {
-        return _quality_first;
+        return _first.getQual();
     }
 
-    std::string FastQPaired::getQualSecond()
+    const std::string& FastQPaired::getQualSecond() const
     {
-        return _quality_second;
+        return _second.getQual();
     }
 
 
@@ -6,13 +6,56 @@
 #pragma once
 
 #include <string>
+#include <string_view>                               // Non-owning record fields
 
 
 namespace FastQ
 {
+    /**
+        \fn getReadName
+        \brief Returns the read name of an id line, shared by both mates.
+        Trims the comment after the first space or tab (ex. Casava's
+        "1:N:0:ATCACG") and a "/1" or "/2" mate suffix, without copying.
+        @param id id line, ex. FastQView::id
+        @return View of the read name within id
+    */
+    std::string_view getReadName( std::string_view id );
+
+    /** \struct FastQView
+        \brief A non-owning view of a fastq record.
+
+        Each field is a pointer and length into a buffer owned by a reader
+        (ex. a memory-mapped file), and is only valid for the lifetime of that buffer.
+    */
+    struct FastQView
+    {
+        std::string_view id;                   /**<Sequence idenfitier. */
+        std::string_view sequence;             /**<Nucleotide sequence. */
+        std::string_view line3;
+        std::string_view quality;              /**<Sequence quality. */
+
+        /**
+            \fn getLength
+            \brief Returns the length of the viewed sequence.
+            @return Length
+        */
+        int getLength() const;
+
+        /**
+            \fn getGC
+            \brief Returns the GC content of the viewed sequence.
+            @return GC Content
+        */
+        float getGC() const;
+    };
+
     /** \class FastQ
         \brief A class to hold a fastq record.
 
+        A FastQ owns its fields and is move-only, so records change hands
+        without copying their strings. Setting a record from a view reuses the
+        capacity of the current fields, so a FastQ reused across records stops
+        allocating once it has held the longest one.
     */
     class FastQ
     {
@@ -40,20 +83,49 @@ namespace FastQ
             */
             FastQ();
 
+            /**
+                \fn Constructor
+                \brief Constructs the FastQ object from a record view.
+                Copies the viewed fields, for modules that must own the record data.
+                @param view fastq record view
+            */
+            explicit FastQ( const FastQView& view );
+
             /** \fn Destructor */
             ~FastQ();
 
+            FastQ( const FastQ& ) = delete;
+            FastQ& operator=( const FastQ& ) = delete;
+            FastQ( FastQ&& ) = default;
+            FastQ& operator=( FastQ&& ) = default;
+
             /**
                 \fn setRecord
                 \brief Stores FastQ record information.
 
-                Reads the fastq record and stores ID, sequence, and quality.
+                Takes ownership of the ID, sequence, and quality, pass temporaries
+                or std::move to avoid copies.
                 @param id sequence identifier
                 @param sequence nucleotide sequence
+                @param line3 third line
                 @param quality nucleotide qualities
             */
-            void setRecord( std::string id, std::string sequence, std::string line3,
-                            std::string quality );
+            void setRecord( std::string&& id, std::string&& sequence, std::string&& line3,
+                            std::string&& quality );
+
+            /**
+                \fn setRecord
+                \brief Copies a viewed record into the existing field capacity.
+                @param view fastq record view
+            */
+            void setRecord( const FastQView& view );
+
+            /**
+                \fn getView
+                \brief Returns a view of the record, valid until it is changed.
+                @return Record view
+            */
+            FastQView getView() const;
 
             /**
                 \fn delRecord
@@ -68,46 +140,46 @@ namespace FastQ
                 \brief Returns the associated sequence record ID.
                 @return ID
             */
-            std::string getID();
+            const std::string& getID() const;
 
             /**
                 \fn getSeq
                 \brief Returns the associated sequence record nucleotide sequence.
                 @return Sequence
             */
-            std::string getSeq();
+            const std::string& getSeq() const;
 
             /**
                 \fn getLine3
                 \brief Returns the associated sequence record line 3.
                 @return Line3
             */
-            std::string getLine3();
+            const std::string& getLine3() const;
 
             /**
                 \fn getQual
                 \brief Returns the associated sequence record quality.
                 @return Quality
             */
-            std::string getQual();
+            const std::string& getQual() const;
 
             /**
                 \fn getLength
                 \brief Returns the associated sequence record length.
                 @return Length
             */
-            int getLength();
+            int getLength() const;
 
             /**
                 \fn getGC
                 \brief Returns the associated sequence record average GC content.
                 @return GC Content
             */
-            float getGC();
+            float getGC() const;
 
             /***
  		\fn setAvQual
-		\brief Calculates average quality of read with user-specified PHRED encoding.
+		\brief Calculates the Phred score of the mean base error probability, with user-specified PHRED encoding.
 		@return None
             */
 	    void setAvQual(int phred_encode);
@@ -117,26 +189,20 @@ namespace FastQ
                 \brief Returns the associated sequence record average quality.
                 @return Average Quality
             */
-            float getAvQual();
+            float getAvQual() const;
     };
 
     /** \class FastQPaired
         \brief A class to hold a paired fastq record.
 
+        Holds the two mates as FastQ records, moved in rather than copied.
     */
     class FastQPaired
     {
             //-------------------------------PRIVATE---------------------------------//
         private:
-            std::string _id_first;                       /**<Sequence idenfitier. */
-            std::string _sequence_first;                 /**<Nucleotide sequence. */
-            std::string _line3_first;
-            std::string _quality_first;                  /**<Sequence quality. */
-
-            std::string _id_second;                       /**<Sequence idenfitier. */
-            std::string _sequence_second;                 /**<Nucleotide sequence. */
-            std::string _line3_second;
-            std::string _quality_second;                  /**<Sequence quality. */
+            FastQ _first;                          /**<First mate. */
+            FastQ _second;                         /**<Second mate. */
 
 
             //-------------------------------PUBLIC----------------------------------//
@@ -155,11 +221,19 @@ namespace FastQ
                 \fn setRecord
                 \brief Stores FastQPaired record information.
 
-                Reads the fastq record and stores ID, sequence, and quality.
+                Takes ownership of both mates, pass std::move to avoid copies.
                 @param fastq_first FastQ object of first record
                 @param fastq_second FastQ object of second record
             */
-            void setRecord( FastQ fastq_first, FastQ fastq_second );
+            void setRecord( FastQ&& fastq_first, FastQ&& fastq_second );
+
+            /**
+                \fn setRecord
+                \brief Copies viewed mates into the existing field capacity.
+                @param view_first first record view
+                @param view_second second record view
+            */
+            void setRecord( const FastQView& view_first, const FastQView& view_second );
 
             /**
                 \fn delRecord
@@ -169,61 +243,75 @@ namespace FastQ
             */
             void delRecord();
 
+            /**
+                \fn getFirst
+                \brief Returns the first mate.
+                @return First record
+            */
+            const FastQ& getFirst() const;
+
+            /**
+                \fn getSecond
+                \brief Returns the second mate.
+                @return Second record
+            */
+            const FastQ& getSecond() const;
+
             /**
                 \fn getIDFirst
                 \brief Returns the associated sequence record ID.
                 @return ID
             */
-            std::string getIDFirst();
+            const std::string& getIDFirst() const;
 
             /**
                 \fn getIDFirst
                 \brief Returns the associated sequence record ID.
                 @return ID
             */
-            std::string getIDSecond();
+            const std::string& getIDSecond() const;
 
             /**
                 \fn getSeq
                 \brief Returns the associated first sequence record nucleotide sequence.
                 @return Sequence
             */
-            std::string getSeqFirst();
+            const std::string& getSeqFirst() const;
 
             /**
                 \fn getSeq
                 \brief Returns the associated second sequence record nucleotide sequence.
                 @return Sequence
             */
-            std::string getSeqSecond();
+            const std::string& getSeqSecond() const;
 
             /**
                 \fn getLine3
                 \brief Returns the associated first sequence record Line 3.
                 @return Line3
             */
-            std::string getLine3First();
+            const std::string& getLine3First() const;
 
             /**
                 \fn getLine3
                 \brief Returns the associated second sequence record Line 3.
                 @return Line3
             */
-            std::string getLine3Second();
+            const std::string& getLine3Second() const;
 
             /**
                 \fn getQualFirst
                 \brief Returns the associated sequence record quality.
                 @return Quality
             */
-            std::string getQualFirst();
+            const std::string& getQualFirst() const;
 
             /**
                 \fn getQualSecond
                 \brief Returns the associated sequence record quality.
                 @return Quality
             */
-            std::string getQualSecond();
+            const std::string& getQualSecond() const;
 
 
     };
@@ -0,0 +1,432 @@
+/*! \file FastQBlockReader.cpp
+    FastQBlockReader Class Implementation.
+    \verbinclude FastQBlockReader.cpp
+*/
+
+#include <string>
+#include <vector>
+#include <cstring>                                    // memchr
+#include <thread>                                     // Worker threads
+#include <mutex>
+#include <condition_variable>
+#include "FastQBlockReader.h"                         // Declaration File
+
+namespace FastQBlockReader
+{
+    //---------------------------Record Boundaries------------------------------//
+    // Returns the offset past the end of the line starting at offset
+    static size_t nextLineStart( const char* data, size_t size, size_t offset )
+    {
+        const char* line_end = static_cast<const char*>( memchr( data + offset, '\n',
+                        size - offset ) );
+
+        if ( line_end == NULL )
+        {
+            return size;
+        }
+        return ( line_end - data ) + 1;
+    }
+
+    size_t findRecordStart( const char* data, size_t size, size_t offset )
+    {
+        size_t line_start[5];
+        size_t seq_length;
+        size_t qual_length;
+
+        if ( offset == 0 || offset >= size )
+        {
+            return offset < size ? offset : size;
+        }
+
+        // Move to the start of the next line, unless already on one
+        if ( data[offset - 1] != '\n' )
+        {
+            offset = nextLineStart( data, size, offset );
+        }
+
+        while ( offset < size )
+        {
+            if ( data[offset] == '@' )
+            {
+                line_start[0] = offset;
+                for ( int i = 1; i < 5; i++ )
+                {
+                    line_start[i] = line_start[i - 1] < size ?
+                                    nextLineStart( data, size, line_start[i - 1] ) : size;
+                }
+
+                // The last quality line of the file may not end with a newline
+                seq_length = line_start[2] - line_start[1];
+                qual_length = line_start[4] - line_start[3];
+                if ( line_start[4] == size && data[size - 1] != '\n' )
+                {
+                    qual_length++;
+                }
+
+                // A quality line starting with '@' is followed by a sequence, not '+'
+                if ( line_start[2] < size && data[line_start[2]] == '+' &&
+                                seq_length == qual_length )
+                {
+                    return offset;
+                }
+            }
+            offset = nextLineStart( data, size, offset );
+        }
+
+        return size;
+    }
+
+    // Returns a record boundary near the end of a buffer starting with a record,
+    // or 0 if the buffer holds less than one whole record
+    static size_t findLastRecordStart( const char* data, size_t size )
+    {
+        size_t window = 64 * 1024;
+        size_t offset;
+
+        while ( true )
+        {
+            offset = size > window ? size - window : 1;
+            offset = findRecordStart( data, size, offset );
+            if ( offset < size )
+            {
+                return offset;
+            }
+            if ( size <= window )
+            {
+                return 0;
+            }
+            window *= 2;
+        }
+    }
+
+    //------------------------------Constructor---------------------------------//
+    FastQBlockReader::FastQBlockReader()
+    {
+        _chunk_size = 8 * 1024 * 1024;
+        _num_threads = 1;
+        _streaming = false;
+        _retain_buffers = true;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    FastQBlockReader::~FastQBlockReader()
+    {
+
+    }
+
+    //-----------------------------Open and Split-------------------------------//
+    bool FastQBlockReader::open( const std::string& file_name )
+    {
+        _chunks.clear();
+        _buffers.clear();
+        _pending.clear();
+        _stream.close();
+
+        // Compressed chunks are cut from the stream as they are claimed
+        _streaming = InputStream::InputStream::isStandardInput( file_name ) ||
+                     InputStream::InputStream::isCompressed( file_name );
+        if ( _streaming )
+        {
+            return _stream.open( file_name );
+        }
+
+        if ( !_reader.open( file_name ) )
+        {
+            return false;
+        }
+
+        FastQBlockReader::splitChunks();
+        return true;
+    }
+
+    void FastQBlockReader::splitChunks()
+    {
+        const char* data = _reader.getData();
+        size_t size = _reader.getSize();
+        size_t begin = 0;
+        size_t end;
+        Chunk chunk;
+
+        while ( begin < size )
+        {
+            end = begin + _chunk_size < size ?
+                  findRecordStart( data, size, begin + _chunk_size ) : size;
+            chunk.data = data + begin;
+            chunk.size = end - begin;
+            chunk.input_end = end;
+            _chunks.push_back( chunk );
+            begin = end;
+        }
+    }
+
+    bool FastQBlockReader::readStreamChunk( std::string& buffer )
+    {
+        std::string block;
+        size_t target_size = _chunk_size;
+        size_t end;
+        bool stream_done = false;
+
+        buffer = std::move( _pending );
+        _pending.clear();
+
+        // Grow until the buffer holds at least one whole record past the target size
+        while ( true )
+        {
+            while ( buffer.size() < target_size && !stream_done )
+            {
+                if ( _stream.read( block ) )
+                {
+                    buffer.append( block );
+                }
+                else
+                {
+                    stream_done = true;
+                }
+            }
+
+            if ( stream_done )
+            {
+                end = buffer.size();
+                break;
+            }
+
+            end = findLastRecordStart( buffer.data(), buffer.size() );
+            if ( end > 0 )
+            {
+                break;
+            }
+            target_size = buffer.size() + 1;
+        }
+
+        if ( buffer.empty() )
+        {
+            return false;
+        }
+
+        _pending.assign( buffer, end, std::string::npos );
+        buffer.resize( end );
+        return true;
+    }
+
+    void FastQBlockReader::addStreamChunk( std::string&& buffer )
+    {
+        Chunk chunk;
+
+        _buffers.push_back( std::move( buffer ) );
+        chunk.data = _buffers.back().data();
+        chunk.size = _buffers.back().size();
+        chunk.input_end = _stream.getInputOffset();
+        _chunks.push_back( chunk );
+    }
+
+    void FastQBlockReader::releaseChunk( size_t chunk_index )
+    {
+        if ( _retain_buffers )
+        {
+            return;
+        }
+
+        // Chunks complete in order, so everything before the end of this one is done
+        if ( _streaming )
+        {
+            std::string().swap( _buffers[chunk_index] );
+        }
+        else
+        {
+            _reader.releasePages( _chunks[chunk_index].input_end );
+        }
+    }
+
+    //-------------------------------Attributes---------------------------------//
+    void FastQBlockReader::setNumThreads( int num_threads )
+    {
+        _num_threads = num_threads > 0 ? num_threads : 1;
+    }
+
+    void FastQBlockReader::setChunkSize( size_t chunk_size )
+    {
+        _chunk_size = chunk_size > 0 ? chunk_size : 1;
+    }
+
+    void FastQBlockReader::setRetainBuffers( bool retain_buffers )
+    {
+        _retain_buffers = retain_buffers;
+    }
+
+    size_t FastQBlockReader::getNumChunks() const
+    {
+        std::lock_guard<std::mutex> lock( _chunk_mutex );
+        return _chunks.size();
+    }
+
+    size_t FastQBlockReader::getNumSlots() const
+    {
+        return 2 * _num_threads;
+    }
+
+    Chunk FastQBlockReader::getChunk( size_t chunk_index ) const
+    {
+        std::lock_guard<std::mutex> lock( _chunk_mutex );
+        return _chunks[chunk_index];
+    }
+
+    FastQReader::FastQReader& FastQBlockReader::getReader()
+    {
+        return _reader;
+    }
+
+    bool FastQBlockReader::fail() const
+    {
+        return _streaming && _stream.fail();
+    }
+
+    //----------------------------Parallel Parsing------------------------------//
+    void FastQBlockReader::parse( ProcessFunction process, CompleteFunction complete )
+    {
+        size_t max_in_flight = FastQBlockReader::getNumSlots();
+        size_t next_chunk = 0;                       // Next chunk to process
+        size_t num_completed = 0;                    // Chunks completed in order
+        bool input_done = !_streaming;               // All chunks have been split
+        std::deque<bool> chunk_done;
+        std::thread reader;                          // Cuts decompressed chunks
+        std::vector<std::thread> workers;
+        std::condition_variable chunk_cv;
+
+        // Single thread, no need for synchronization
+        if ( _num_threads == 1 )
+        {
+            FastQReader::FastQReader chunk_reader;
+            std::string buffer;
+            for ( size_t i = 0; i < _chunks.size() || ( !input_done &&
+                            FastQBlockReader::readStreamChunk( buffer ) ); i++ )
+            {
+                if ( i == _chunks.size() )
+                {
+                    FastQBlockReader::addStreamChunk( std::move( buffer ) );
+                }
+                chunk_reader.openBuffer( _chunks[i].data, _chunks[i].size );
+                process( i, chunk_reader );
+                complete( i );
+                FastQBlockReader::releaseChunk( i );
+            }
+            return;
+        }
+
+        chunk_done.resize( _chunks.size(), false );
+
+        // Decompressed chunks are cut by a reader thread, ahead of the workers but
+        // never further than the chunks that can be in flight
+        if ( !input_done )
+        {
+            reader = std::thread( [&]()
+            {
+                std::string buffer;
+                bool have_chunk;
+
+                do
+                {
+                    {
+                        std::unique_lock<std::mutex> lock( _chunk_mutex );
+                        chunk_cv.wait( lock, [&]()
+                        {
+                            return _chunks.size() < num_completed + max_in_flight;
+                        } );
+                    }
+
+                    have_chunk = FastQBlockReader::readStreamChunk( buffer );
+
+                    {
+                        std::lock_guard<std::mutex> lock( _chunk_mutex );
+                        if ( have_chunk )
+                        {
+                            FastQBlockReader::addStreamChunk( std::move( buffer ) );
+                            chunk_done.resize( _chunks.size(), false );
+                        }
+                        else
+                        {
+                            input_done = true;
+                        }
+                    }
+                    chunk_cv.notify_all();
+                }
+                while ( have_chunk );
+            } );
+        }
+
+        // Workers claim the oldest unclaimed chunk, keeping chunks in flight
+        // close to the completion point
+        for ( int t = 0; t < _num_threads; t++ )
+        {
+            workers.push_back( std::thread( [&]()
+            {
+                FastQReader::FastQReader chunk_reader;
+                Chunk worker_chunk;
+                size_t i;
+
+                while ( true )
+                {
+                    {
+                        std::unique_lock<std::mutex> lock( _chunk_mutex );
+                        chunk_cv.wait( lock, [&]()
+                        {
+                            return ( input_done && next_chunk >= _chunks.size() ) ||
+                                   ( next_chunk < _chunks.size() &&
+                                     next_chunk < num_completed + max_in_flight );
+                        } );
+                        if ( next_chunk >= _chunks.size() )
+                        {
+                            return;
+                        }
+                        i = next_chunk++;
+                        worker_chunk = _chunks[i];
+                    }
+
+                    chunk_reader.openBuffer( worker_chunk.data, worker_chunk.size );
+                    process( i, chunk_reader );
+
+                    {
+                        std::lock_guard<std::mutex> lock( _chunk_mutex );
+                        chunk_done[i] = true;
+                    }
+                    chunk_cv.notify_all();
+                }
+            } ) );
+        }
+
+        // Complete chunks in file order as they finish
+        for ( size_t i = 0; ; i++ )
+        {
+            {
+                std::unique_lock<std::mutex> lock( _chunk_mutex );
+                chunk_cv.wait( lock, [&]()
+                {
+                    return ( i < chunk_done.size() && chunk_done[i] ) ||
+                           ( input_done && i >= _chunks.size() );
+                } );
+                if ( i >= _chunks.size() )
+                {
+                    break;
+                }
+            }
+
+            complete( i );
+
+            {
+                std::lock_guard<std::mutex> lock( _chunk_mutex );
+                FastQBlockReader::releaseChunk( i );
+                num_completed = i + 1;
+            }
+            chunk_cv.notify_all();
+        }
+
+        for ( size_t t = 0; t < workers.size(); t++ )
+        {
+            workers[t].join();
+        }
+        if ( reader.joinable() )
+        {
+            reader.join();
+        }
+    }
+
+} // namespace FastQBlockReader
@@ -0,0 +1,177 @@
+/*! \file FastQBlockReader.h
+    FastQBlockReader Class Declaration.
+    \verbinclude FastQBlockReader.h
+*/
+
+#pragma once
+
+#include <string>
+#include <deque>
+#include <cstddef>
+#include <mutex>
+#include <functional>                                 // Chunk callbacks
+#include "FastQReader.h"                              // Memory-mapped reader
+#include "InputStream.h"                              // gzip and BGZF input
+
+namespace FastQBlockReader
+{
+    /** \struct Chunk
+        \brief A range of whole records, in the mapped file or a decompressed buffer.
+    */
+    struct Chunk
+    {
+        const char* data;                      /**<Start of the first record. */
+        size_t size;                           /**<Size of the chunk in bytes. */
+        unsigned long long input_end;          /**<Input file offset reached, for progress. */
+    };
+
+    /**
+        \fn findRecordStart
+        \brief Resynchronizes an arbitrary offset to the next record boundary.
+
+        A line starting with '@' may be a quality line, so a candidate is only
+        accepted if its third line starts with '+' and its sequence and quality
+        lines have the same length.
+        @param data start of the buffer
+        @param size size of the buffer in bytes
+        @param offset offset to resynchronize
+        @return Offset of the next record at or after offset, or size if none
+    */
+    size_t findRecordStart( const char* data, size_t size, size_t offset );
+
+    /** \class FastQBlockReader
+        \brief Parses a memory-mapped fastq file in parallel chunks.
+
+        The file is split into large chunks that each start on a record boundary.
+        Worker threads parse chunks with their own FastQReader, while the calling
+        thread completes them in file order so output stays deterministic.
+
+        Compressed files and standard input are inflated in the background and
+        cut into chunks by a reader thread, so parsing overlaps with reading.
+    */
+    class FastQBlockReader
+    {
+        public:
+            /** Called on a worker thread with a reader over one chunk. */
+            typedef std::function<void( size_t chunk_index, FastQReader::FastQReader& chunk_reader )>
+            ProcessFunction;
+
+            /** Called on the calling thread for each chunk, in file order. */
+            typedef std::function<void( size_t chunk_index )> CompleteFunction;
+
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            FastQReader::FastQReader _reader;      /**<Reader owning the mapping. */
+            std::deque<Chunk> _chunks;             /**<Chunks split so far. */
+            size_t _chunk_size;                    /**<Target chunk size in bytes. */
+            int _num_threads;                      /**<Number of worker threads. */
+            bool _streaming;                       /**<Reading a compressed file. */
+            bool _retain_buffers;                  /**<Keep decompressed chunks until closed. */
+            InputStream::InputStream _stream;      /**<Decompressor of a compressed file. */
+            std::deque<std::string> _buffers;      /**<Decompressed chunks, by index. */
+            std::string _pending;                  /**<Decompressed data not yet in a chunk. */
+            mutable std::mutex _chunk_mutex;       /**<Guards the chunk lists while parsing. */
+
+            void splitChunks();
+            bool readStreamChunk( std::string& buffer );
+            void addStreamChunk( std::string&& buffer );
+            void releaseChunk( size_t chunk_index );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the FastQBlockReader object.
+                Constructs the FastQBlockReader with one thread and 8 MB chunks.
+            */
+            FastQBlockReader();
+
+            /** \fn Destructor */
+            ~FastQBlockReader();
+
+            /**
+                \fn open
+                \brief Memory-maps a fastq file and splits it into chunks.
+                Gzip and BGZF files are detected and split while parsing instead.
+                @param file_name input fastq file, or "-" for standard input
+                @return True if the file could be opened
+            */
+            bool open( const std::string& file_name );
+
+            /**
+                \fn setNumThreads
+                \brief Sets the number of worker threads used by parse.
+                @param num_threads number of threads
+            */
+            void setNumThreads( int num_threads );
+
+            /**
+                \fn setChunkSize
+                \brief Sets the target chunk size, applied by the next open.
+                @param chunk_size chunk size in bytes
+            */
+            void setChunkSize( size_t chunk_size );
+
+            /**
+                \fn setRetainBuffers
+                \brief Sets whether chunks stay in memory after their complete call.
+                Needed when views of the records are kept, on by default. When off,
+                decompressed chunks are freed and pages of a mapped file released.
+                @param retain_buffers keep chunks until the reader is destroyed
+            */
+            void setRetainBuffers( bool retain_buffers );
+
+            /**
+                \fn getNumChunks
+                \brief Returns the number of chunks split so far.
+                For a mapped file this is known after open, for compressed input after parse.
+                @return Number of chunks
+            */
+            size_t getNumChunks() const;
+
+            /**
+                \fn getNumSlots
+                \brief Returns the maximum number of chunks in flight during parse.
+                Chunks in flight have distinct chunk_index % getNumSlots(), so
+                per-chunk results can be kept in that many reusable slots.
+                @return Number of slots
+            */
+            size_t getNumSlots() const;
+
+            /**
+                \fn getChunk
+                \brief Returns the byte range and input offset of a chunk.
+                @param chunk_index index of the chunk
+                @return Chunk
+            */
+            Chunk getChunk( size_t chunk_index ) const;
+
+            /**
+                \fn getReader
+                \brief Returns the reader owning the mapped file.
+                @return Reader
+            */
+            FastQReader::FastQReader& getReader();
+
+            /**
+                \fn fail
+                \brief Returns true if a compressed input was corrupt or truncated.
+                @return Error state
+            */
+            bool fail() const;
+
+            /**
+                \fn parse
+                \brief Processes every chunk on the worker threads.
+
+                At most two chunks per thread are in flight at once, so the memory
+                held for uncompleted chunks is bounded by the chunk size. A chunk's
+                slot is reused only after its complete call returns.
+                @param process called once per chunk on a worker thread
+                @param complete called once per chunk in file order
+            */
+            void parse( ProcessFunction process, CompleteFunction complete );
+
+    }; // class FastQBlockReader
+
+} // namespace FastQBlockReader
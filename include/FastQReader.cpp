@@ -0,0 +1,268 @@
+/*! \file FastQReader.cpp
+    FastQReader Class Implementation.
+    \verbinclude FastQReader.cpp
+*/
+
+#include <string>
+#include <algorithm>                                  // min
+#include <fcntl.h>                                    // open
+#include <unistd.h>                                   // close
+#include <sys/mman.h>                                 // mmap
+#include <sys/stat.h>                                 // File size
+#include "FastQReader.h"                              // Declaration File
+
+namespace FastQReader
+{
+    static const size_t SCAN_WINDOW = 256 * 1024;     // Bytes scanned for newlines at once
+    static const size_t RELEASE_SIZE = 4 * 1024 * 1024;  // Mapped bytes read before releasing pages
+
+    //------------------------------Constructor---------------------------------//
+    FastQReader::FastQReader()
+    {
+        _fd = -1;
+        _data = NULL;
+        _size = 0;
+        _offset = 0;
+        _streaming = false;
+        _retain_buffers = true;
+        _released = 0;
+        FastQReader::resetScan();
+    }
+
+    //------------------------------Destructor----------------------------------//
+    FastQReader::~FastQReader()
+    {
+        FastQReader::close();
+    }
+
+    //----------------------------Open and Close--------------------------------//
+    bool FastQReader::open( const std::string& file_name )
+    {
+        struct stat file_stat;
+        void* mapped;
+
+        FastQReader::close();
+        _file_name = file_name;
+
+        if ( InputStream::InputStream::isStandardInput( file_name ) ||
+                        InputStream::InputStream::isCompressed( file_name ) )
+        {
+            _streaming = _stream.open( file_name );
+            return _streaming;
+        }
+
+        _fd = ::open( file_name.c_str(), O_RDONLY );
+        if ( _fd < 0 || fstat( _fd, &file_stat ) != 0 )
+        {
+            FastQReader::close();
+            return false;
+        }
+
+        _size = file_stat.st_size;
+
+        // mmap refuses zero-length mappings, an empty file simply has no records
+        if ( _size > 0 )
+        {
+            mapped = mmap( NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0 );
+            if ( mapped == MAP_FAILED )
+            {
+                FastQReader::close();
+                return false;
+            }
+            _data = static_cast<const char*>( mapped );
+            madvise( mapped, _size, MADV_SEQUENTIAL );
+        }
+
+        return true;
+    }
+
+    void FastQReader::setRetainBuffers( bool retain_buffers )
+    {
+        _retain_buffers = retain_buffers;
+    }
+
+    void FastQReader::openBuffer( const char* data, size_t size )
+    {
+        FastQReader::close();
+        _data = data;
+        _size = size;
+    }
+
+    void FastQReader::close()
+    {
+        // Only mappings made by open() are owned by the reader
+        if ( _data != NULL && _fd >= 0 )
+        {
+            munmap( const_cast<char*>( _data ), _size );
+        }
+        if ( _fd >= 0 )
+        {
+            ::close( _fd );
+        }
+        _fd = -1;
+        _data = NULL;
+        _size = 0;
+        _offset = 0;
+        _released = 0;
+        FastQReader::resetScan();
+
+        if ( _streaming )
+        {
+            _stream.close();
+            _buffer.clear();
+            _retained.clear();
+        }
+        _streaming = false;
+    }
+
+    //------------------------------Read Records--------------------------------//
+    void FastQReader::resetScan()
+    {
+        _newlines.clear();
+        _window_start = _offset;
+        _window_end = _offset;
+        _next_newline = 0;
+    }
+
+    bool FastQReader::scanWindow()
+    {
+        while ( _window_end < _size )
+        {
+            _window_start = _window_end;
+            _window_end = std::min( _window_start + SCAN_WINDOW, _size );
+            LineScanner::findNewlines( _data + _window_start, _window_end - _window_start,
+                                       _newlines );
+            _next_newline = 0;
+            if ( !_newlines.empty() )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string_view FastQReader::nextLine()
+    {
+        const char* line_start = _data + _offset;
+        size_t line_end;
+
+        // Last line of the file may not end with a newline
+        if ( _next_newline == _newlines.size() && !FastQReader::scanWindow() )
+        {
+            line_end = _size;
+            _offset = _size;
+            return std::string_view( line_start, line_end - ( line_start - _data ) );
+        }
+
+        line_end = _window_start + _newlines[_next_newline++];
+        _offset = line_end + 1;
+        return std::string_view( line_start, line_end - ( line_start - _data ) );
+    }
+
+    bool FastQReader::fillBuffer( size_t keep_from )
+    {
+        std::string block;
+        std::vector<char> next_buffer;
+
+        if ( !_streaming || !_stream.read( block ) )
+        {
+            return false;
+        }
+
+        // Earlier records may still point into the old block, a moved
+        // std::vector keeps its storage where a short std::string would not
+        next_buffer.reserve( _size - keep_from + block.size() );
+        next_buffer.insert( next_buffer.end(), _buffer.begin() + keep_from, _buffer.end() );
+        next_buffer.insert( next_buffer.end(), block.begin(), block.end() );
+        if ( !_buffer.empty() && _retain_buffers )
+        {
+            _retained.push_back( std::move( _buffer ) );
+        }
+        _buffer = std::move( next_buffer );
+
+        _data = _buffer.data();
+        _size = _buffer.size();
+        _offset = 0;
+        FastQReader::resetScan();
+        return true;
+    }
+
+    bool FastQReader::nextRecord( FastQ::FastQView& record )
+    {
+        size_t record_start;
+
+        if ( _offset >= _size && !FastQReader::fillBuffer( _offset ) )
+        {
+            return false;
+        }
+
+        // Pages of a mapped file behind the previous record are not viewed anymore
+        if ( _fd >= 0 && !_retain_buffers && _offset - _released >= RELEASE_SIZE )
+        {
+            FastQReader::releasePages( _offset );
+        }
+
+        // Missing lines of a truncated final record are left empty
+        while ( true )
+        {
+            record_start = _offset;
+            record.id = FastQReader::nextLine();
+            record.sequence = FastQReader::nextLine();
+            record.line3 = FastQReader::nextLine();
+            record.quality = FastQReader::nextLine();
+
+            // A record cut by the end of a block (no newline after its quality line)
+            // is parsed again with the next one
+            if ( !_streaming || record.quality.data() + record.quality.size() < _data + _size ||
+                            !FastQReader::fillBuffer( record_start ) )
+            {
+                return true;
+            }
+        }
+    }
+
+    void FastQReader::releasePages( size_t end )
+    {
+        size_t page_size = sysconf( _SC_PAGESIZE );
+
+        // The mapping starts on a page, the page holding end is still in use
+        end -= end % page_size;
+        if ( _data != NULL && _fd >= 0 && end > _released )
+        {
+            madvise( const_cast<char*>( _data ) + _released, end - _released, MADV_DONTNEED );
+            _released = end;
+        }
+    }
+
+    //-----------------------------Get Attributes-------------------------------//
+    bool FastQReader::fail() const
+    {
+        return _streaming && _stream.fail();
+    }
+
+    size_t FastQReader::getOffset() const
+    {
+        return _offset;
+    }
+
+    unsigned long long FastQReader::getInputOffset() const
+    {
+        return _streaming ? _stream.getInputOffset() : _offset;
+    }
+
+    bool FastQReader::isMapped() const
+    {
+        return _fd >= 0;
+    }
+
+    size_t FastQReader::getSize() const
+    {
+        return _size;
+    }
+
+    const char* FastQReader::getData() const
+    {
+        return _data;
+    }
+
+} // namespace FastQReader
@@ -0,0 +1,190 @@
+/*! \file FastQReader.h
+    FastQReader Class Declaration.
+    \verbinclude FastQReader.h
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "FastQ.h"                                    // FastQView
+#include "InputStream.h"                              // gzip and BGZF input
+#include "LineScanner.h"                              // Vectorized newline search
+
+namespace FastQReader
+{
+    /** \class FastQReader
+        \brief Zero-copy reader of fastq records from a memory-mapped file.
+
+        Records are returned as FastQ::FastQView objects pointing directly into
+        the mapped file, so no memory is allocated per record. Views remain valid
+        until the reader is closed or destroyed. Newlines are found a window at a
+        time by the vectorized LineScanner, so splitting lines is a table lookup.
+
+        Compressed files and standard input ("-") cannot be mapped, so they are
+        read in the background and parsed from blocks in memory. By default the
+        blocks are kept until the reader is closed, so views stay valid exactly
+        as for a mapped file. Without retained buffers, blocks are dropped and
+        pages of a mapped file already read are released, so memory stays
+        bounded however large the input is.
+    */
+    class FastQReader
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            std::string _file_name;                /**<Input file name. */
+            int _fd;                               /**<Input file descriptor, -1 for a buffer. */
+            const char* _data;                     /**<Start of the mapped file. */
+            size_t _size;                          /**<Size of the mapped file. */
+            size_t _offset;                        /**<Offset of the next record. */
+            std::vector<uint32_t> _newlines;       /**<Newlines of the window, from its start. */
+            size_t _window_start;                  /**<Offset of the scanned window. */
+            size_t _window_end;                    /**<Offset past the scanned window. */
+            size_t _next_newline;                  /**<Index of the next unread newline. */
+            bool _streaming;                       /**<Reading a compressed file. */
+            InputStream::InputStream _stream;      /**<Decompressor of a compressed file. */
+            std::vector<char> _buffer;             /**<Current decompressed block. */
+            std::vector<std::vector<char> > _retained;  /**<Previous blocks, still viewed, moved without copying their bytes. */
+            bool _retain_buffers;                  /**<Keep previous blocks until closed. */
+            size_t _released;                      /**<Mapped bytes whose pages were released. */
+
+            /**
+                \fn nextLine
+                \brief Returns the line at the current offset and advances past it.
+                @return Line, without the trailing newline
+            */
+            std::string_view nextLine();
+
+            /**
+                \fn scanWindow
+                \brief Finds the newlines of the next window that has any.
+                @return False if no newline is left in the buffer
+            */
+            bool scanWindow();
+
+            /**
+                \fn resetScan
+                \brief Restarts newline scanning at the current offset.
+            */
+            void resetScan();
+
+            /**
+                \fn fillBuffer
+                \brief Replaces the current block with its unread tail and the next block.
+                @param keep_from offset of the first byte to keep
+                @return False at the end of the compressed file
+            */
+            bool fillBuffer( size_t keep_from );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the FastQReader object.
+                Constructs the FastQReader with no open file.
+            */
+            FastQReader();
+
+            /** \fn Destructor */
+            ~FastQReader();
+
+            /**
+                \fn open
+                \brief Memory-maps a fastq file for reading.
+                Gzip and BGZF files are detected and decompressed instead.
+                @param file_name input fastq file, or "-" for standard input
+                @return True if the file could be opened
+            */
+            bool open( const std::string& file_name );
+
+            /**
+                \fn setRetainBuffers
+                \brief Sets whether blocks of a stream are kept until the reader is closed.
+                When off, memory stays bounded but a record's views are only valid
+                until the next call to nextRecord, and pages of a mapped file are
+                released behind the reader. On by default.
+                @param retain_buffers keep blocks until closed
+            */
+            void setRetainBuffers( bool retain_buffers );
+
+            /**
+                \fn openBuffer
+                \brief Reads records from a buffer that is owned elsewhere.
+                Used to parse one chunk of a larger mapped file.
+                @param data start of the buffer
+                @param size size of the buffer in bytes
+            */
+            void openBuffer( const char* data, size_t size );
+
+            /**
+                \fn close
+                \brief Unmaps and closes the current file.
+                All views returned by the reader are invalidated.
+            */
+            void close();
+
+            /**
+                \fn nextRecord
+                \brief Reads the next fastq record.
+                @param record view to fill with the record fields
+                @return False when there are no more records
+            */
+            bool nextRecord( FastQ::FastQView& record );
+
+            /**
+                \fn fail
+                \brief Returns true if a compressed input was corrupt or truncated.
+                @return Error state
+            */
+            bool fail() const;
+
+            /**
+                \fn getOffset
+                \brief Returns the byte offset of the next record.
+                @return Offset
+            */
+            size_t getOffset() const;
+
+            /**
+                \fn getInputOffset
+                \brief Returns how far the input file has been read, for progress.
+                Counts compressed bytes for gzip input, otherwise equals getOffset.
+                @return Offset in the input file
+            */
+            unsigned long long getInputOffset() const;
+
+            /**
+                \fn releasePages
+                \brief Releases the pages of a mapped file before an offset.
+                Views into the released range stay readable, their pages are read
+                again from the file if touched. Does nothing for streams.
+                @param end offset of the first byte still in use
+            */
+            void releasePages( size_t end );
+
+            /**
+                \fn isMapped
+                \brief Returns true if a file is memory-mapped, so record views are offsets into getData().
+                @return Mapped state
+            */
+            bool isMapped() const;
+
+            /**
+                \fn getSize
+                \brief Returns the size of the mapped file (or current block) in bytes.
+                @return Size
+            */
+            size_t getSize() const;
+
+            /**
+                \fn getData
+                \brief Returns the start of the mapped file (or current block).
+                @return Data
+            */
+            const char* getData() const;
+
+    }; // class FastQReader
+
+} // namespace FastQReader
@@ -0,0 +1,161 @@
+/*! \file FastQWriter.cpp
+    FastQWriter Class Implementation.
+    \verbinclude FastQWriter.cpp
+*/
+
+#include <string>
+#include <vector>
+#include <sys/uio.h>                                  // iovec
+#include "FastQWriter.h"                              // Declaration File
+
+namespace FastQWriter
+{
+    static const size_t NUM_SEGMENTS = 8;             // Segments per batch
+    static const size_t SEGMENT_SIZE = 128 * 1024;    // Soft size limit of a segment
+
+    //------------------------------Constructor---------------------------------//
+    FastQWriter::FastQWriter()
+    {
+        _segments.resize( NUM_SEGMENTS );
+        for ( size_t i = 0; i < NUM_SEGMENTS; i++ )
+        {
+            _segments[i].reserve( SEGMENT_SIZE + 1024 );
+        }
+        _segment = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    FastQWriter::~FastQWriter()
+    {
+        FastQWriter::close();
+    }
+
+    //-----------------------------Open and Close-------------------------------//
+    void FastQWriter::setNumThreads( int num_threads )
+    {
+        _output.setNumThreads( num_threads );
+    }
+
+    bool FastQWriter::open( const std::string& file_name )
+    {
+        for ( size_t i = 0; i < NUM_SEGMENTS; i++ )
+        {
+            _segments[i].clear();
+        }
+        _segment = 0;
+        return _output.open( file_name );
+    }
+
+    bool FastQWriter::close()
+    {
+        FastQWriter::flush();
+        return _output.close();
+    }
+
+    //-------------------------------Writing------------------------------------//
+    bool FastQWriter::append( const FastQ::FastQView& record )
+    {
+        std::string& segment = _segments[_segment];
+
+        segment.append( record.id );
+        segment.push_back( '\n' );
+        segment.append( record.sequence );
+        segment.push_back( '\n' );
+        segment.append( record.line3 );
+        segment.push_back( '\n' );
+        segment.append( record.quality );
+        segment.push_back( '\n' );
+
+        if ( segment.size() < SEGMENT_SIZE )
+        {
+            return false;
+        }
+
+        // The last segment stays current until the batch is flushed
+        if ( _segment + 1 < NUM_SEGMENTS )
+        {
+            _segment++;
+            return false;
+        }
+        return true;
+    }
+
+    void FastQWriter::write( const FastQ::FastQView& record )
+    {
+        if ( FastQWriter::append( record ) )
+        {
+            FastQWriter::flush();
+        }
+    }
+
+    void FastQWriter::flush()
+    {
+        struct iovec buffers[NUM_SEGMENTS];
+        int count = 0;
+
+        for ( size_t i = 0; i <= _segment; i++ )
+        {
+            if ( !_segments[i].empty() )
+            {
+                buffers[count].iov_base = &_segments[i][0];
+                buffers[count].iov_len = _segments[i].size();
+                count++;
+            }
+        }
+        if ( count > 0 )
+        {
+            _output.writeBuffers( buffers, count );
+        }
+
+        // Clearing keeps the capacity, so the segments are reused without allocating
+        for ( size_t i = 0; i <= _segment; i++ )
+        {
+            _segments[i].clear();
+        }
+        _segment = 0;
+    }
+
+    //--------------------------Paired Constructor------------------------------//
+    FastQPairedWriter::FastQPairedWriter()
+    {
+
+    }
+
+    FastQPairedWriter::~FastQPairedWriter()
+    {
+
+    }
+
+    //-------------------------------Paired Writing-----------------------------//
+    FastQWriter& FastQPairedWriter::getFirst()
+    {
+        return _first;
+    }
+
+    FastQWriter& FastQPairedWriter::getSecond()
+    {
+        return _second;
+    }
+
+    void FastQPairedWriter::write( const FastQ::FastQView& first,
+                                   const FastQ::FastQView& second )
+    {
+        bool first_full = _first.append( first );
+        bool second_full = _second.append( second );
+
+        if ( first_full || second_full )
+        {
+            _first.flush();
+            _second.flush();
+        }
+    }
+
+    bool FastQPairedWriter::close()
+    {
+        bool first_closed = _first.close();
+        bool second_closed = _second.close();
+
+        return first_closed && second_closed;
+    }
+
+} // namespace FastQWriter
@@ -0,0 +1,144 @@
+/*! \file FastQWriter.h
+    FastQWriter Class Declaration.
+    \verbinclude FastQWriter.h
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "FastQ.h"                                    // FastQView
+#include "OutputStream.h"                             // Buffered, optionally compressed output
+
+namespace FastQWriter
+{
+    /** \class FastQWriter
+        \brief Writes fastq records in large batches.
+
+        Records are formatted into a set of reusable segment buffers. A full
+        batch is handed to the output in one writev call, so writing costs one
+        system call per batch instead of a flush per line.
+    */
+    class FastQWriter
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            OutputStream::OutputStream _output;    /**<Output file. */
+            std::vector<std::string> _segments;    /**<Reusable formatting buffers. */
+            size_t _segment;                       /**<Segment being filled. */
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the FastQWriter object.
+                Constructs the FastQWriter with no open file.
+            */
+            FastQWriter();
+
+            /** \fn Destructor */
+            ~FastQWriter();
+
+            /**
+                \fn setNumThreads
+                \brief Sets the number of threads compressing ".gz" output, applied by the next open.
+                @param num_threads number of threads
+            */
+            void setNumThreads( int num_threads );
+
+            /**
+                \fn open
+                \brief Creates or truncates an output fastq file.
+                @param file_name output file, BGZF compressed if it ends in ".gz"
+                @return True if the file could be opened
+            */
+            bool open( const std::string& file_name );
+
+            /**
+                \fn append
+                \brief Formats a record into the current batch without writing it.
+                @param record record to format
+                @return True once the batch is full and should be flushed
+            */
+            bool append( const FastQ::FastQView& record );
+
+            /**
+                \fn write
+                \brief Formats a record, writing the batch when it is full.
+                @param record record to write
+            */
+            void write( const FastQ::FastQView& record );
+
+            /**
+                \fn flush
+                \brief Writes the current batch and empties the segments for reuse.
+            */
+            void flush();
+
+            /**
+                \fn close
+                \brief Writes the last batch and closes the file.
+                @return False if any write failed
+            */
+            bool close();
+
+    }; // class FastQWriter
+
+    /** \class FastQPairedWriter
+        \brief Writes the two mates of paired records to two fastq files.
+
+        Both files are flushed together whenever either batch is full, so the
+        mate files grow in step.
+    */
+    class FastQPairedWriter
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            FastQWriter _first;                    /**<First mate output. */
+            FastQWriter _second;                   /**<Second mate output. */
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the FastQPairedWriter object.
+                Constructs the FastQPairedWriter with no open files.
+            */
+            FastQPairedWriter();
+
+            /** \fn Destructor */
+            ~FastQPairedWriter();
+
+            /**
+                \fn getFirst
+                \brief Returns the first mate writer, to open it.
+                @return First mate writer
+            */
+            FastQWriter& getFirst();
+
+            /**
+                \fn getSecond
+                \brief Returns the second mate writer, to open it.
+                @return Second mate writer
+            */
+            FastQWriter& getSecond();
+
+            /**
+                \fn write
+                \brief Formats both mates, writing both batches when either is full.
+                @param first first mate record
+                @param second second mate record
+            */
+            void write( const FastQ::FastQView& first, const FastQ::FastQView& second );
+
+            /**
+                \fn close
+                \brief Writes the last batches and closes both files.
+                @return False if any write failed
+            */
+            bool close();
+
+    }; // class FastQPairedWriter
+
+} // namespace FastQWriter
@@ -0,0 +1,506 @@
+/*! \file InputStream.cpp
+    InputStream Class Implementation.
+    \verbinclude InputStream.cpp
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>                                 // bind
+#include <algorithm>                                  // min
+#include <cstring>                                    // memcpy
+#include <fcntl.h>                                    // open
+#include <unistd.h>                                   // read, close
+#include <zlib.h>                                     // inflate
+#include "InputStream.h"                              // Declaration File
+
+namespace InputStream
+{
+    static const size_t BLOCK_SIZE = 1024 * 1024;     // Decompressed gzip block size
+    static const size_t BGZF_BATCH_SIZE = 512 * 1024; // Compressed bytes per BGZF batch
+    static const size_t BGZF_HEADER_SIZE = 12;        // Header bytes before the extra field
+    static const size_t BGZF_FOOTER_SIZE = 8;         // CRC32 and ISIZE
+    static const size_t BGZF_MAX_ISIZE = 65536;       // Largest uncompressed BGZF block
+
+    // Little endian integers of the gzip header and footer
+    static unsigned int readLE16( const unsigned char* data )
+    {
+        return data[0] | ( data[1] << 8 );
+    }
+
+    static unsigned int readLE32( const unsigned char* data )
+    {
+        return data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) | ( ( unsigned int )data[3] << 24 );
+    }
+
+    // Returns the BSIZE subfield of a BGZF extra field, or -1 if there is none
+    static long findBgzfBlockSize( const unsigned char* extra, size_t extra_length )
+    {
+        size_t i = 0;
+        size_t subfield_length;
+
+        while ( i + 4 <= extra_length )
+        {
+            subfield_length = readLE16( extra + i + 2 );
+            if ( extra[i] == 'B' && extra[i + 1] == 'C' && subfield_length == 2 &&
+                            i + 6 <= extra_length )
+            {
+                return readLE16( extra + i + 4 ) + 1;
+            }
+            i += 4 + subfield_length;
+        }
+        return -1;
+    }
+
+    //------------------------------Constructor---------------------------------//
+    InputStream::InputStream()
+    {
+        _fd = -1;
+        _owns_fd = false;
+        _num_threads = std::thread::hardware_concurrency();
+        if ( _num_threads < 1 )
+        {
+            _num_threads = 1;
+        }
+        _bgzf = false;
+        _compressed = false;
+        _prefix_offset = 0;
+        _finished = false;
+        _error = false;
+        _input_offset = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    InputStream::~InputStream()
+    {
+        InputStream::close();
+    }
+
+    //-----------------------------Open and Close-------------------------------//
+    bool InputStream::isCompressed( const std::string& file_name )
+    {
+        unsigned char magic[2];
+        int fd = ::open( file_name.c_str(), O_RDONLY );
+        bool compressed;
+
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        compressed = ::read( fd, magic, 2 ) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+        ::close( fd );
+        return compressed;
+    }
+
+    bool InputStream::isStandardInput( const std::string& file_name )
+    {
+        return file_name == "-";
+    }
+
+    void InputStream::setNumThreads( int num_threads )
+    {
+        _num_threads = num_threads > 0 ? num_threads : 1;
+    }
+
+    bool InputStream::open( const std::string& file_name )
+    {
+        unsigned char header[BGZF_HEADER_SIZE + 6];
+        size_t header_size;
+
+        InputStream::close();
+        _finished = false;
+        _error = false;
+        _input_offset = 0;
+
+        _owns_fd = !InputStream::isStandardInput( file_name );
+        _fd = _owns_fd ? ::open( file_name.c_str(), O_RDONLY ) : STDIN_FILENO;
+        if ( _fd < 0 )
+        {
+            return false;
+        }
+
+        // Standard input cannot seek, so the header is kept and read again as data
+        _prefix.clear();
+        _prefix_offset = 0;
+        header_size = InputStream::readFully( ( char* )header, sizeof( header ) );
+        _prefix.assign( ( const char* )header, header_size );
+        _input_offset = 0;
+
+        // BGZF members carry their compressed size in a "BC" extra subfield
+        _compressed = header_size >= 2 && header[0] == 0x1f && header[1] == 0x8b;
+        _bgzf = _compressed && header_size == sizeof( header ) && header[2] == 8 &&
+                ( header[3] & 4 ) && header[12] == 'B' && header[13] == 'C';
+
+        _blocks.reopen();
+        _blocks.setCapacity( 2 * _num_threads + 2 );
+        _tasks.reopen();
+        _tasks.setCapacity( 4 * _num_threads + 4 );
+
+        if ( _bgzf )
+        {
+            for ( int i = 0; i < _num_threads; i++ )
+            {
+                _workers.push_back( std::thread( [this]()
+                {
+                    std::packaged_task<std::string()> task;
+                    while ( _tasks.pop( task ) )
+                    {
+                        task();
+                    }
+                } ) );
+            }
+            _reader_thread = std::thread( &InputStream::readBgzf, this );
+        }
+        else if ( _compressed )
+        {
+            _reader_thread = std::thread( &InputStream::readGzip, this );
+        }
+        else
+        {
+            _reader_thread = std::thread( &InputStream::readPlain, this );
+        }
+        return true;
+    }
+
+    void InputStream::close()
+    {
+        _blocks.close();
+        _tasks.close();
+        if ( _reader_thread.joinable() )
+        {
+            _reader_thread.join();
+        }
+        for ( size_t i = 0; i < _workers.size(); i++ )
+        {
+            _workers[i].join();
+        }
+        _workers.clear();
+        if ( _fd >= 0 && _owns_fd )
+        {
+            ::close( _fd );
+        }
+        _fd = -1;
+    }
+
+    //---------------------------Background Reading-----------------------------//
+    size_t InputStream::readFully( char* buffer, size_t size )
+    {
+        size_t total = 0;
+        ssize_t num_read;
+
+        // Bytes read while detecting the format come first
+        if ( _prefix_offset < _prefix.size() )
+        {
+            total = std::min( size, _prefix.size() - _prefix_offset );
+            memcpy( buffer, _prefix.data() + _prefix_offset, total );
+            _prefix_offset += total;
+        }
+
+        while ( total < size )
+        {
+            num_read = ::read( _fd, buffer + total, size - total );
+            if ( num_read <= 0 )
+            {
+                if ( num_read < 0 )
+                {
+                    _error = true;
+                }
+                break;
+            }
+            total += num_read;
+        }
+        _input_offset += total;
+        return total;
+    }
+
+    bool InputStream::pushBlock( std::string&& block )
+    {
+        std::promise<std::string> ready_block;
+
+        ready_block.set_value( std::move( block ) );
+        return _blocks.push( ready_block.get_future() );
+    }
+
+    void InputStream::readPlain()
+    {
+        std::string block( BLOCK_SIZE, '\0' );
+        size_t num_read;
+
+        while ( ( num_read = InputStream::readFully( &block[0], block.size() ) ) > 0 )
+        {
+            block.resize( num_read );
+            if ( !InputStream::pushBlock( std::move( block ) ) )
+            {
+                break;
+            }
+            block.assign( BLOCK_SIZE, '\0' );
+        }
+        _blocks.close();
+    }
+
+    void InputStream::readGzip()
+    {
+        z_stream stream = z_stream();
+        std::vector<char> input( BLOCK_SIZE );
+        std::string output( BLOCK_SIZE, '\0' );
+        size_t num_read;
+        bool in_member = true;                       // Inside an unfinished gzip member
+        int status;
+
+        // 15 + 32: maximum window with automatic gzip header detection
+        if ( inflateInit2( &stream, 15 + 32 ) != Z_OK )
+        {
+            _error = true;
+            _blocks.close();
+            return;
+        }
+        stream.next_out = ( Bytef* )&output[0];
+        stream.avail_out = output.size();
+
+        while ( true )
+        {
+            if ( stream.avail_in == 0 )
+            {
+                num_read = InputStream::readFully( &input[0], input.size() );
+                if ( num_read == 0 )
+                {
+                    break;
+                }
+                stream.next_in = ( Bytef* )&input[0];
+                stream.avail_in = num_read;
+
+                // Concatenated gzip members are inflated as one stream
+                if ( !in_member )
+                {
+                    inflateReset( &stream );
+                    in_member = true;
+                }
+            }
+
+            status = inflate( &stream, Z_NO_FLUSH );
+            if ( status == Z_STREAM_END )
+            {
+                in_member = false;
+                if ( stream.avail_in > 0 )
+                {
+                    inflateReset( &stream );
+                    in_member = true;
+                }
+            }
+            else if ( status != Z_OK && status != Z_BUF_ERROR )
+            {
+                _error = true;
+                break;
+            }
+
+            // Stop early if the consumer closed the stream
+            if ( stream.avail_out == 0 )
+            {
+                if ( !InputStream::pushBlock( std::move( output ) ) )
+                {
+                    break;
+                }
+                output.assign( BLOCK_SIZE, '\0' );
+                stream.next_out = ( Bytef* )&output[0];
+                stream.avail_out = output.size();
+            }
+        }
+
+        if ( in_member && stream.total_in > 0 )
+        {
+            _error = true;                           // Truncated final member
+        }
+
+        output.resize( output.size() - stream.avail_out );
+        if ( !output.empty() )
+        {
+            InputStream::pushBlock( std::move( output ) );
+        }
+        inflateEnd( &stream );
+        _blocks.close();
+    }
+
+    void InputStream::readBgzf()
+    {
+        std::string batch;
+        unsigned char header[BGZF_HEADER_SIZE];
+        std::vector<unsigned char> extra;
+        size_t header_start;
+        size_t num_read;
+        size_t extra_length;
+        long block_size;
+
+        while ( !_error )
+        {
+            // End of file between members is the only clean exit
+            header_start = batch.size();
+            num_read = InputStream::readFully( ( char* )header, BGZF_HEADER_SIZE );
+            if ( num_read < BGZF_HEADER_SIZE )
+            {
+                if ( num_read > 0 )
+                {
+                    _error = true;
+                }
+                break;
+            }
+
+            extra_length = readLE16( header + 10 );
+            extra.resize( extra_length );
+            if ( header[0] != 0x1f || header[1] != 0x8b || !( header[3] & 4 ) ||
+                            InputStream::readFully( ( char* )&extra[0], extra_length ) < extra_length )
+            {
+                _error = true;
+                break;
+            }
+
+            block_size = findBgzfBlockSize( &extra[0], extra_length );
+            if ( block_size < long( BGZF_HEADER_SIZE + extra_length + BGZF_FOOTER_SIZE ) )
+            {
+                _error = true;
+                break;
+            }
+
+            // Append the whole member to the batch
+            batch.append( ( char* )header, BGZF_HEADER_SIZE );
+            batch.append( ( char* )&extra[0], extra_length );
+            batch.resize( header_start + block_size );
+            if ( InputStream::readFully( &batch[header_start + BGZF_HEADER_SIZE + extra_length],
+                                         block_size - BGZF_HEADER_SIZE - extra_length ) <
+                            size_t( block_size ) - BGZF_HEADER_SIZE - extra_length )
+            {
+                _error = true;
+                break;
+            }
+
+            if ( batch.size() >= BGZF_BATCH_SIZE )
+            {
+                std::packaged_task<std::string()> task( std::bind( &InputStream::inflateBgzf,
+                                this, std::move( batch ) ) );
+                if ( !_blocks.push( task.get_future() ) || !_tasks.push( std::move( task ) ) )
+                {
+                    break;
+                }
+                batch.clear();
+            }
+        }
+
+        if ( !batch.empty() && !_error )
+        {
+            std::packaged_task<std::string()> task( std::bind( &InputStream::inflateBgzf,
+                            this, std::move( batch ) ) );
+            if ( _blocks.push( task.get_future() ) )
+            {
+                _tasks.push( std::move( task ) );
+            }
+        }
+        _tasks.close();
+        _blocks.close();
+    }
+
+    //----------------------------BGZF Inflating--------------------------------//
+    std::string InputStream::inflateBgzf( const std::string& batch )
+    {
+        const unsigned char* data = ( const unsigned char* )batch.data();
+        z_stream stream = z_stream();
+        std::string output;
+        size_t offset = 0;
+        size_t output_start;
+        size_t extra_length;
+        size_t block_size;
+        size_t data_start;
+        unsigned int expected_crc;
+        unsigned int uncompressed_size;
+
+        // Raw deflate, the gzip framing is parsed here
+        if ( inflateInit2( &stream, -15 ) != Z_OK )
+        {
+            _error = true;
+            return output;
+        }
+
+        while ( offset < batch.size() )
+        {
+            extra_length = readLE16( data + offset + 10 );
+            block_size = findBgzfBlockSize( data + offset + BGZF_HEADER_SIZE, extra_length );
+            data_start = offset + BGZF_HEADER_SIZE + extra_length;
+            expected_crc = readLE32( data + offset + block_size - 8 );
+            uncompressed_size = readLE32( data + offset + block_size - 4 );
+
+            // A corrupt ISIZE would otherwise zero-fill up to 4 GB before the CRC check
+            if ( uncompressed_size > BGZF_MAX_ISIZE )
+            {
+                _error = true;
+                output.clear();
+                break;
+            }
+
+            output_start = output.size();
+            output.resize( output_start + uncompressed_size );
+
+            inflateReset( &stream );
+            stream.next_in = ( Bytef* )( data + data_start );
+            stream.avail_in = offset + block_size - BGZF_FOOTER_SIZE - data_start;
+            stream.next_out = ( Bytef* )&output[output_start];
+            stream.avail_out = uncompressed_size;
+
+            if ( ( uncompressed_size > 0 && inflate( &stream, Z_FINISH ) != Z_STREAM_END ) ||
+                            stream.avail_out != 0 ||
+                            crc32( 0, ( const Bytef* )output.data() + output_start, uncompressed_size ) !=
+                            expected_crc )
+            {
+                _error = true;
+                output.clear();
+                break;
+            }
+            offset += block_size;
+        }
+
+        inflateEnd( &stream );
+        return output;
+    }
+
+    //------------------------------Read Blocks---------------------------------//
+    bool InputStream::read( std::string& block )
+    {
+        std::future<std::string> next_block;
+
+        if ( _finished )
+        {
+            return false;
+        }
+
+        // Empty blocks (ex. the BGZF end of file marker) are skipped
+        while ( !_error && _blocks.pop( next_block ) )
+        {
+            block = next_block.get();
+            if ( !block.empty() )
+            {
+                return true;
+            }
+        }
+
+        if ( _error )
+        {
+            std::cerr << "ERROR: Compressed input is corrupt or truncated." << std::endl;
+        }
+        _finished = true;
+        return false;
+    }
+
+    //-----------------------------Get Attributes-------------------------------//
+    bool InputStream::fail() const
+    {
+        return _error;
+    }
+
+    bool InputStream::isBgzf() const
+    {
+        return _bgzf;
+    }
+
+    unsigned long long InputStream::getInputOffset() const
+    {
+        return _input_offset;
+    }
+
+} // namespace InputStream
@@ -0,0 +1,137 @@
+/*! \file InputStream.h
+    InputStream Class Declaration.
+    \verbinclude InputStream.h
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>                                     // Ordered decompressed blocks
+#include <atomic>
+#include "BoundedQueue.h"                             // Blocking queues
+
+namespace InputStream
+{
+    /** \class InputStream
+        \brief Reads a gzip or BGZF compressed file as decompressed blocks.
+
+        Decompression runs on background threads and feeds the consumer through
+        a bounded queue, so inflating and parsing overlap. BGZF files are made of
+        independent blocks, which are inflated in parallel by a pool of workers
+        and returned in file order. Other gzip files are inflated by a single
+        background thread. The file name "-" reads standard input, which may be
+        compressed or plain text.
+    */
+    class InputStream
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            int _fd;                               /**<Input file descriptor. */
+            bool _owns_fd;                         /**<False for standard input. */
+            int _num_threads;                      /**<Number of inflating threads. */
+            bool _bgzf;                            /**<Input is BGZF compressed. */
+            bool _compressed;                      /**<Input is gzip or BGZF compressed. */
+            std::string _prefix;                   /**<Bytes read to detect the format. */
+            size_t _prefix_offset;                 /**<Prefix bytes already consumed. */
+            bool _finished;                        /**<read has returned false. */
+            std::atomic<bool> _error;              /**<Input is corrupt or truncated. */
+            std::atomic<unsigned long long> _input_offset;  /**<Compressed bytes read. */
+
+            /** Decompressed blocks in file order, each resolved by a worker. */
+            BoundedQueue::BoundedQueue<std::future<std::string> > _blocks;
+            /** Batches of BGZF blocks waiting for a worker. */
+            BoundedQueue::BoundedQueue<std::packaged_task<std::string()> > _tasks;
+
+            std::thread _reader_thread;            /**<Reads the compressed file. */
+            std::vector<std::thread> _workers;     /**<Inflate BGZF batches. */
+
+            size_t readFully( char* buffer, size_t size );
+            bool pushBlock( std::string&& block );
+            void readPlain();
+            void readGzip();
+            void readBgzf();
+            std::string inflateBgzf( const std::string& batch );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the InputStream object.
+                Constructs the InputStream with no open file and one thread per core.
+            */
+            InputStream();
+
+            /** \fn Destructor */
+            ~InputStream();
+
+            /**
+                \fn isCompressed
+                \brief Checks a file for the gzip magic number.
+                @param file_name input file
+                @return True if the file is gzip (or BGZF) compressed
+            */
+            static bool isCompressed( const std::string& file_name );
+
+            /**
+                \fn setNumThreads
+                \brief Sets the number of threads inflating BGZF blocks, applied by the next open.
+                @param num_threads number of threads
+            */
+            void setNumThreads( int num_threads );
+
+            /**
+                \fn open
+                \brief Opens a file and starts reading it in the background, decompressing if needed.
+                @param file_name input file, or "-" for standard input
+                @return True if the file could be opened
+            */
+            bool open( const std::string& file_name );
+
+            /**
+                \fn read
+                \brief Returns the next block of decompressed data.
+                @param block string to fill with the decompressed block
+                @return False at the end of the file or on error
+            */
+            bool read( std::string& block );
+
+            /**
+                \fn close
+                \brief Stops the background threads and closes the file.
+            */
+            void close();
+
+            /**
+                \fn fail
+                \brief Returns true if the input was corrupt or truncated.
+                @return Error state
+            */
+            bool fail() const;
+
+            /**
+                \fn isBgzf
+                \brief Returns true if the input is BGZF compressed.
+                @return BGZF state
+            */
+            bool isBgzf() const;
+
+            /**
+                \fn isStandardInput
+                \brief Checks if a file name stands for standard input.
+                @param file_name input file
+                @return True for "-"
+            */
+            static bool isStandardInput( const std::string& file_name );
+
+            /**
+                \fn getInputOffset
+                \brief Returns the number of compressed bytes read so far.
+                @return Offset in the compressed file
+            */
+            unsigned long long getInputOffset() const;
+
+    }; // class InputStream
+
+} // namespace InputStream
@@ -0,0 +1,238 @@
+/*! \file LineScanner.cpp
+    LineScanner Implementation.
+    \verbinclude LineScanner.cpp
+*/
+
+#include <vector>
+#include <cstring>                                    // memchr
+#include <atomic>
+#include "LineScanner.h"                              // Declaration File
+
+#if defined( __x86_64__ )
+#include <immintrin.h>                                // SSE2, AVX2 and AVX-512 intrinsics
+#endif
+
+namespace LineScanner
+{
+    static std::atomic<int> forced_level( -1 );      // Level set by setLevel, -1 for best
+
+    //---------------------------CPU Detection----------------------------------//
+    static Level detectBestLevel()
+    {
+#if defined( __x86_64__ )
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports( "avx512bw" ) )
+        {
+            return AVX512;
+        }
+        if ( __builtin_cpu_supports( "avx2" ) )
+        {
+            return AVX2;
+        }
+        return SSE2;
+#else
+        return SCALAR;
+#endif
+    }
+
+    Level getBestLevel()
+    {
+        static const Level best_level = detectBestLevel();
+        return best_level;
+    }
+
+    bool isSupported( Level level )
+    {
+        return level <= getBestLevel();
+    }
+
+    void setLevel( Level level )
+    {
+        if ( isSupported( level ) )
+        {
+            forced_level = level;
+        }
+    }
+
+    Level getLevel()
+    {
+        int level = forced_level;
+        return level < 0 ? getBestLevel() : Level( level );
+    }
+
+    const char* getLevelName( Level level )
+    {
+        switch ( level )
+        {
+            case SCALAR:
+                return "scalar";
+            case SSE2:
+                return "SSE2";
+            case AVX2:
+                return "AVX2";
+            case AVX512:
+                return "AVX-512";
+        }
+        return "unknown";
+    }
+
+    //-----------------------------Scalar Scan----------------------------------//
+    // Makes room for at least one more 64 byte block of newlines
+    static uint32_t* reserveBlock( std::vector<uint32_t>& positions, size_t count )
+    {
+        if ( count + 64 > positions.size() )
+        {
+            positions.resize( 2 * positions.size() + 64 );
+        }
+        return positions.data();
+    }
+
+    // Appends the offset of every set bit of a 64 byte block mask
+    static inline size_t emitMask( uint64_t mask, uint32_t base, uint32_t* out, size_t count )
+    {
+        while ( mask != 0 )
+        {
+            out[count++] = base + __builtin_ctzll( mask );
+            mask &= mask - 1;
+        }
+        return count;
+    }
+
+    // Scans the bytes after the last whole 64 byte block
+    static size_t scanTail( const char* data, size_t size, size_t offset,
+                            std::vector<uint32_t>& positions, size_t count )
+    {
+        uint32_t* out = reserveBlock( positions, count );
+
+        for ( ; offset < size; offset++ )
+        {
+            if ( data[offset] == '\n' )
+            {
+                out[count++] = offset;
+            }
+        }
+        return count;
+    }
+
+    static size_t scanScalar( const char* data, size_t size, std::vector<uint32_t>& positions )
+    {
+        const char* line_end;
+        size_t offset = 0;
+        size_t count = 0;
+        uint32_t* out = reserveBlock( positions, count );
+
+        while ( offset < size )
+        {
+            line_end = static_cast<const char*>( memchr( data + offset, '\n', size - offset ) );
+            if ( line_end == NULL )
+            {
+                break;
+            }
+            if ( count == positions.size() )
+            {
+                out = reserveBlock( positions, count );
+            }
+            offset = line_end - data;
+            out[count++] = offset;
+            offset++;
+        }
+        return count;
+    }
+
+    //-----------------------------Vector Scans---------------------------------//
+#if defined( __x86_64__ )
+    __attribute__( ( target( "sse2" ) ) )
+    static size_t scanSSE2( const char* data, size_t size, std::vector<uint32_t>& positions )
+    {
+        const __m128i newline = _mm_set1_epi8( '\n' );
+        size_t offset = 0;
+        size_t count = 0;
+        uint32_t* out;
+        uint64_t mask;
+
+        for ( ; offset + 64 <= size; offset += 64 )
+        {
+            out = reserveBlock( positions, count );
+            mask = uint64_t( uint16_t( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128(
+                                           ( const __m128i* )( data + offset ) ), newline ) ) ) );
+            mask |= uint64_t( uint16_t( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128(
+                                            ( const __m128i* )( data + offset + 16 ) ), newline ) ) ) ) << 16;
+            mask |= uint64_t( uint16_t( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128(
+                                            ( const __m128i* )( data + offset + 32 ) ), newline ) ) ) ) << 32;
+            mask |= uint64_t( uint16_t( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128(
+                                            ( const __m128i* )( data + offset + 48 ) ), newline ) ) ) ) << 48;
+            count = emitMask( mask, offset, out, count );
+        }
+        return scanTail( data, size, offset, positions, count );
+    }
+
+    __attribute__( ( target( "avx2" ) ) )
+    static size_t scanAVX2( const char* data, size_t size, std::vector<uint32_t>& positions )
+    {
+        const __m256i newline = _mm256_set1_epi8( '\n' );
+        size_t offset = 0;
+        size_t count = 0;
+        uint32_t* out;
+        uint64_t mask;
+
+        for ( ; offset + 64 <= size; offset += 64 )
+        {
+            out = reserveBlock( positions, count );
+            mask = uint64_t( uint32_t( _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256(
+                                           ( const __m256i* )( data + offset ) ), newline ) ) ) );
+            mask |= uint64_t( uint32_t( _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256(
+                                            ( const __m256i* )( data + offset + 32 ) ), newline ) ) ) ) << 32;
+            count = emitMask( mask, offset, out, count );
+        }
+        return scanTail( data, size, offset, positions, count );
+    }
+
+    __attribute__( ( target( "avx512f,avx512bw" ) ) )
+    static size_t scanAVX512( const char* data, size_t size, std::vector<uint32_t>& positions )
+    {
+        const __m512i newline = _mm512_set1_epi8( '\n' );
+        size_t offset = 0;
+        size_t count = 0;
+        uint32_t* out;
+        uint64_t mask;
+
+        for ( ; offset + 64 <= size; offset += 64 )
+        {
+            out = reserveBlock( positions, count );
+            mask = _mm512_cmpeq_epi8_mask( _mm512_loadu_si512( data + offset ), newline );
+            count = emitMask( mask, offset, out, count );
+        }
+        return scanTail( data, size, offset, positions, count );
+    }
+#endif
+
+    //-------------------------------Dispatch-----------------------------------//
+    void findNewlines( const char* data, size_t size, std::vector<uint32_t>& positions )
+    {
+        size_t count;
+
+        // Sized for short reads, grown while scanning if needed
+        positions.resize( size / 32 + 64 );
+
+        switch ( getLevel() )
+        {
+#if defined( __x86_64__ )
+            case AVX512:
+                count = scanAVX512( data, size, positions );
+                break;
+            case AVX2:
+                count = scanAVX2( data, size, positions );
+                break;
+            case SSE2:
+                count = scanSSE2( data, size, positions );
+                break;
+#endif
+            default:
+                count = scanScalar( data, size, positions );
+                break;
+        }
+
+        positions.resize( count );
+    }
+
+} // namespace LineScanner
@@ -0,0 +1,75 @@
+/*! \file LineScanner.h
+    LineScanner Declaration.
+    \verbinclude LineScanner.h
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace LineScanner
+{
+    /** \enum Level
+        \brief Instruction set used to scan for newlines.
+    */
+    enum Level
+    {
+        SCALAR,                                /**<memchr, any architecture. */
+        SSE2,                                  /**<16 bytes per compare, x86-64 baseline. */
+        AVX2,                                  /**<32 bytes per compare. */
+        AVX512                                 /**<64 bytes per compare, needs AVX-512BW. */
+    };
+
+    /**
+        \fn getBestLevel
+        \brief Returns the widest instruction set supported by the running CPU.
+        @return Level
+    */
+    Level getBestLevel();
+
+    /**
+        \fn isSupported
+        \brief Checks if the running CPU supports an instruction set.
+        @param level instruction set
+        @return True if supported
+    */
+    bool isSupported( Level level );
+
+    /**
+        \fn setLevel
+        \brief Forces the instruction set used by findNewlines, for benchmarks and tests.
+        Levels the CPU does not support are ignored.
+        @param level instruction set
+    */
+    void setLevel( Level level );
+
+    /**
+        \fn getLevel
+        \brief Returns the instruction set used by findNewlines.
+        @return Level, the best supported one unless setLevel was called
+    */
+    Level getLevel();
+
+    /**
+        \fn getLevelName
+        \brief Returns a printable name of an instruction set.
+        @param level instruction set
+        @return Name
+    */
+    const char* getLevelName( Level level );
+
+    /**
+        \fn findNewlines
+        \brief Finds every newline of a buffer in one vectorized sweep.
+
+        The positions form the record offset table of a fastq buffer: record r
+        spans the lines ending at newlines 4r to 4r + 3.
+        @param data start of the buffer
+        @param size size of the buffer in bytes, at most 4 GB
+        @param positions cleared, then filled with the offset of each newline
+    */
+    void findNewlines( const char* data, size_t size, std::vector<uint32_t>& positions );
+
+} // namespace LineScanner
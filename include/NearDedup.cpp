@@ -0,0 +1,335 @@
+/*! \file NearDedup.cpp
+    NearDedup Class Implementation.
+    \verbinclude NearDedup.cpp
+*/
+
+#include <algorithm>
+#include "NearDedup.h"                                // Declaration File
+#include "SeqHash.h"                                  // Segment hashes
+#include "QualityKernel.h"                            // Expected errors of best-quality
+
+namespace NearDedup
+{
+    static const size_t NO_MASK = ~( size_t )0;       // Seed without non-ACGT bases
+    static const size_t MAX_BUCKET = 64;               // Seeds indexed under one segment key
+    static const uint64_t LOW_BITS = 0x5555555555555555ULL;
+
+    // 2 bit code of a base, 4 for a base other than ACGT
+    static const struct CodeTable
+    {
+        uint8_t codes[256];
+
+        CodeTable()
+        {
+            for ( int i = 0; i < 256; i++ )
+            {
+                codes[i] = 4;
+            }
+            codes['A'] = codes['a'] = 0;
+            codes['C'] = codes['c'] = 1;
+            codes['G'] = codes['g'] = 2;
+            codes['T'] = codes['t'] = 3;
+        }
+    } CODE_TABLE;
+
+    // The high bits pick the home slot of any table size, as in SeqHash
+    static inline size_t findHomeSlot( uint64_t key, size_t num_slots )
+    {
+        return ( unsigned __int128 )key * num_slots >> 64;
+    }
+
+    //------------------------------Constructor---------------------------------//
+    NearDedup::NearDedup( int max_mismatches )
+    {
+        _max_mismatches = std::max( max_mismatches, 0 );
+        _keep_policy = ShardedDedup::KEEP_LAST;
+        _phred_offset = 33;
+        _index_size = 0;
+        _num_near = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    NearDedup::~NearDedup()
+    {
+
+    }
+
+    //------------------------------Configuration-------------------------------//
+    void NearDedup::setKeepPolicy( ShardedDedup::KeepPolicy keep_policy, int phred_offset )
+    {
+        _keep_policy = keep_policy;
+        _phred_offset = phred_offset;
+    }
+
+    void NearDedup::setBinQualities( bool bin_qualities, int phred_offset )
+    {
+        _records.setBinQualities( bin_qualities, phred_offset );
+    }
+
+    //-------------------------------Encoding-----------------------------------//
+    // Base i sits in bits 2 * (i % 32) of word i / 32, its mask bit is the low
+    // one of the pair, so the tail of the last word is zero in every read. The
+    // bases are also spelled back as ACGT or N, the form segments are hashed in
+    bool NearDedup::encodeRead( std::string_view sequence )
+    {
+        size_t num_words = ( sequence.size() + 31 ) / 32;
+        bool has_masks = false;
+        uint64_t code;
+
+        _read_codes.assign( num_words, 0 );
+        _read_masks.assign( num_words, 0 );
+        _read_bases.resize( sequence.size() );
+        for ( size_t i = 0; i < sequence.size(); i++ )
+        {
+            code = CODE_TABLE.codes[( unsigned char )sequence[i]];
+            _read_bases[i] = "ACGTN"[code];
+            if ( code == 4 )
+            {
+                _read_masks[i / 32] |= ( uint64_t )1 << ( 2 * ( i % 32 ) );
+                has_masks = true;
+                continue;
+            }
+            _read_codes[i / 32] |= code << ( 2 * ( i % 32 ) );
+        }
+        return has_masks;
+    }
+
+    // Segments split the read evenly, the key also holds the read length and
+    // the segment index, so only segments at the same place can match; the
+    // segment after the last is the whole read. Hashing the encoded bases keeps
+    // the lookup as case-insensitive as countMismatches
+    uint64_t NearDedup::getSegmentKey( int segment ) const
+    {
+        std::string_view bases = _read_bases;
+        size_t length = bases.size();
+        size_t begin = length * segment / ( _max_mismatches + 1 );
+        size_t end = length * ( segment + 1 ) / ( _max_mismatches + 1 );
+        SeqHash::Hash128 hash;
+
+        if ( segment > _max_mismatches )
+        {
+            begin = 0;
+            end = length;
+        }
+        hash = SeqHash::hashSequence( bases.substr( begin, end - begin ) );
+
+        return ( hash.high ^ ( ( length * ( _max_mismatches + 1 ) + segment ) * 0x9e3779b97f4a7c15ULL ) ) | 1;
+    }
+
+    //------------------------------Verification--------------------------------//
+    // XOR leaves a nonzero pair of bits at each substitution, folding each pair
+    // onto its low bit counts them with one popcount per 32 bases
+    size_t NearDedup::countMismatches( const Cluster& cluster, bool read_has_masks ) const
+    {
+        const uint64_t* seed_codes = _codes.data() + cluster.codes;
+        const uint64_t* seed_masks = cluster.masks == NO_MASK ? nullptr : _masks.data() + cluster.masks;
+        size_t mismatches = 0;
+        uint64_t difference;
+
+        for ( size_t i = 0; i < _read_codes.size(); i++ )
+        {
+            difference = _read_codes[i] ^ seed_codes[i];
+            difference = ( difference | ( difference >> 1 ) ) & LOW_BITS;
+            if ( seed_masks != nullptr || read_has_masks )
+            {
+                uint64_t seed_mask = seed_masks != nullptr ? seed_masks[i] : 0;
+
+                // Non-ACGT bases match each other and nothing else
+                difference = ( difference & ~( seed_mask & _read_masks[i] ) ) | ( seed_mask ^ _read_masks[i] );
+            }
+            mismatches += __builtin_popcountll( difference );
+            if ( mismatches > ( size_t )_max_mismatches )
+            {
+                break;
+            }
+        }
+        return mismatches;
+    }
+
+    //--------------------------------Index-------------------------------------//
+    void NearDedup::growIndex()
+    {
+        std::vector<IndexSlot> old_index;
+        size_t slot;
+
+        old_index.swap( _index );
+        _index.resize( old_index.empty() ? 1024 : old_index.size() + old_index.size() / 2, IndexSlot() );
+
+        for ( size_t i = 0; i < old_index.size(); i++ )
+        {
+            if ( old_index[i].key == 0 )
+            {
+                continue;
+            }
+            for ( slot = findHomeSlot( old_index[i].key, _index.size() ); _index[slot].key != 0;
+                            slot = slot + 1 == _index.size() ? 0 : slot + 1 );
+            _index[slot] = old_index[i];
+        }
+    }
+
+    void NearDedup::addIndexKey( uint64_t key, uint32_t cluster )
+    {
+        size_t slot;
+
+        if ( _index_size >= _index.size() / 5 * 4 )
+        {
+            growIndex();
+        }
+        for ( slot = findHomeSlot( key, _index.size() ); _index[slot].key != 0;
+                        slot = slot + 1 == _index.size() ? 0 : slot + 1 );
+        _index[slot].key = key;
+        _index[slot].cluster = cluster;
+        _index_size++;
+    }
+
+    //-------------------------------Inserting----------------------------------//
+    void NearDedup::insert( const FastQ::FastQView& record )
+    {
+        std::string_view sequence = record.sequence;
+        int num_segments = _max_mismatches == 0 ? 1 : _max_mismatches + 2;
+        bool has_masks = encodeRead( sequence );
+        size_t best_cluster = _clusters.size();
+        size_t best_mismatches = 0;
+        size_t mismatches;
+        size_t slot;
+        std::string quality_buffer;
+        uint64_t record_errors = 0;
+        PackedSeq::Ref added;
+        bool keep_new;
+
+        // Every seed sharing a segment is a candidate, the earliest within k
+        // wins; with mismatches allowed the whole read is a key as well, so a
+        // seed always stays reachable by its exact copies
+        _candidates.clear();
+        _keys.resize( num_segments );
+        _bucket_sizes.assign( num_segments, 0 );
+        for ( int segment = 0; segment < num_segments; segment++ )
+        {
+            _keys[segment] = NearDedup::getSegmentKey( segment );
+            if ( _index.empty() )
+            {
+                continue;
+            }
+            for ( slot = findHomeSlot( _keys[segment], _index.size() ); _index[slot].key != 0;
+                            slot = slot + 1 == _index.size() ? 0 : slot + 1 )
+            {
+                if ( _index[slot].key == _keys[segment] )
+                {
+                    _bucket_sizes[segment]++;
+                    _candidates.push_back( _index[slot].cluster );
+                }
+            }
+        }
+        std::sort( _candidates.begin(), _candidates.end() );
+        _candidates.erase( std::unique( _candidates.begin(), _candidates.end() ), _candidates.end() );
+        for ( uint32_t candidate : _candidates )
+        {
+            if ( _clusters[candidate].length != sequence.size() )
+            {
+                continue;
+            }
+            mismatches = NearDedup::countMismatches( _clusters[candidate], has_masks );
+            if ( mismatches <= ( size_t )_max_mismatches )
+            {
+                best_cluster = candidate;
+                best_mismatches = mismatches;
+                break;
+            }
+        }
+
+        added = _records.add( record );
+        if ( _keep_policy == ShardedDedup::KEEP_BEST_QUALITY )
+        {
+            record_errors = QualityKernel::sumErrorProbabilities(
+                                _records.getQualityLine( added, quality_buffer ), _phred_offset );
+        }
+
+        // A new seed: its codes and the segments not yet shared too widely
+        if ( best_cluster == _clusters.size() )
+        {
+            Cluster cluster;
+
+            cluster.codes = _codes.size();
+            cluster.masks = has_masks ? _masks.size() : NO_MASK;
+            cluster.length = sequence.size();
+            cluster.kept = added;
+            cluster.kept_errors = record_errors;
+            _codes.insert( _codes.end(), _read_codes.begin(), _read_codes.end() );
+            if ( has_masks )
+            {
+                _masks.insert( _masks.end(), _read_masks.begin(), _read_masks.end() );
+            }
+            _clusters.push_back( cluster );
+            for ( int segment = 0; segment < num_segments; segment++ )
+            {
+                if ( _bucket_sizes[segment] < MAX_BUCKET || segment > _max_mismatches )
+                {
+                    NearDedup::addIndexKey( _keys[segment], _clusters.size() - 1 );
+                }
+            }
+            return;
+        }
+
+        if ( best_mismatches > 0 )
+        {
+            _num_near++;
+        }
+        Cluster& cluster = _clusters[best_cluster];
+        if ( _keep_policy == ShardedDedup::KEEP_BEST_QUALITY )
+        {
+            keep_new = record_errors < cluster.kept_errors;
+        }
+        else
+        {
+            keep_new = _keep_policy == ShardedDedup::KEEP_LAST;
+        }
+        if ( keep_new )
+        {
+            cluster.kept = _records.replace( cluster.kept, added );
+            cluster.kept_errors = record_errors;
+        }
+        else
+        {
+            _records.discard( added );
+        }
+    }
+
+    //--------------------------------Output------------------------------------//
+    void NearDedup::writeSorted( WriteFunction write )
+    {
+        std::vector<PackedSeq::Ref> sorted;
+        std::string record_buffer;
+        FastQ::FastQView record;
+
+        sorted.reserve( _clusters.size() );
+        for ( size_t i = 0; i < _clusters.size(); i++ )
+        {
+            sorted.push_back( _clusters[i].kept );
+        }
+        std::sort( sorted.begin(), sorted.end(), PackedSeq::SequenceLess() );
+        for ( size_t i = 0; i < sorted.size(); i++ )
+        {
+            _records.getRecord( sorted[i], record_buffer, record );
+            write( record );
+        }
+    }
+
+    //------------------------------Attributes----------------------------------//
+    size_t NearDedup::size() const
+    {
+        return _clusters.size();
+    }
+
+    unsigned long long NearDedup::getNumNear() const
+    {
+        return _num_near;
+    }
+
+    unsigned long long NearDedup::getMemoryUsage() const
+    {
+        return _records.getArena().getUsedMemory() + _clusters.capacity() * sizeof( Cluster ) +
+               ( _codes.capacity() + _masks.capacity() ) * sizeof( uint64_t ) +
+               _index.capacity() * sizeof( IndexSlot );
+    }
+
+} // namespace NearDedup
@@ -0,0 +1,157 @@
+/*! \file NearDedup.h
+    NearDedup Class Declaration.
+    \verbinclude NearDedup.h
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "FastQ.h"                                    // FastQView
+#include "PackedSeq.h"                                // Kept records
+#include "ShardedDedup.h"                             // KeepPolicy
+
+namespace NearDedup
+{
+    /** \class NearDedup
+        \brief Clusters reads whose sequences differ by at most k substitutions.
+
+        Reads are clustered greedily in input order: a read joins the earliest
+        cluster whose seed, its first read, has the same length and at most k
+        mismatches, or seeds a new cluster. Seeds are found through the
+        pigeonhole principle: a seed split into k + 1 segments shares at least
+        one whole segment, at the same position, with any read within k
+        mismatches. Each segment of a seed is indexed by its hash, so a read
+        looks up k + 1 keys and compares only the seeds found there, on 2 bit
+        codes 32 bases per word, stopping past k. A segment shared by more
+        than MAX_BUCKET seeds, ex. low complexity sequence, is not indexed
+        again, which keeps the work per read bounded; the whole read is always
+        indexed, so exact copies still find their seed. Bases are compared
+        case-insensitively and non-ACGT bases match only each other. Each
+        cluster keeps one record by the keep policy.
+    */
+    class NearDedup
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \struct Cluster
+                \brief A seed and the record kept for its cluster.
+            */
+            struct Cluster
+            {
+                size_t codes;                  /**<Offset of the seed's 2 bit codes. */
+                size_t masks;                  /**<Offset of its non-ACGT mask, or NO_MASK. */
+                uint32_t length;               /**<Seed length. */
+                PackedSeq::Ref kept;           /**<Record kept for the cluster. */
+                uint64_t kept_errors;          /**<Expected errors of kept, best-quality only. */
+            };
+
+            /** \struct IndexSlot
+                \brief A segment key and a cluster seeded with it, empty while key is 0.
+            */
+            struct IndexSlot
+            {
+                uint64_t key;
+                uint32_t cluster;
+            };
+
+            int _max_mismatches;
+            ShardedDedup::KeepPolicy _keep_policy;
+            int _phred_offset;
+            PackedSeq::PackedSeq _records;     /**<Kept records. */
+            std::vector<Cluster> _clusters;    /**<Clusters, in seeding order. */
+            std::vector<uint64_t> _codes;      /**<2 bit codes of every seed. */
+            std::vector<uint64_t> _masks;      /**<Non-ACGT masks of the seeds that have them. */
+            std::vector<IndexSlot> _index;     /**<Segment keys, open addressing, repeated keys allowed. */
+            size_t _index_size;                /**<Used index slots. */
+            unsigned long long _num_near;      /**<Reads joined to a seed they differ from. */
+
+            // Read being inserted, encoded once
+            std::vector<uint64_t> _read_codes;
+            std::vector<uint64_t> _read_masks;
+            std::string _read_bases;           /**<Bases as ACGT or N, hashed into segment keys. */
+            std::vector<uint64_t> _keys;
+            std::vector<size_t> _bucket_sizes;
+            std::vector<uint32_t> _candidates;
+
+            bool encodeRead( std::string_view sequence );
+            uint64_t getSegmentKey( int segment ) const;
+            size_t countMismatches( const Cluster& cluster, bool read_has_masks ) const;
+            void addIndexKey( uint64_t key, uint32_t cluster );
+            void growIndex();
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /** \typedef WriteFunction
+                \brief Receives kept records in sequence order.
+            */
+            typedef std::function<void( const FastQ::FastQView& record )> WriteFunction;
+
+            /**
+                \fn Constructor
+                \brief Constructs an empty NearDedup.
+                @param max_mismatches mismatches allowed between a read and a seed
+            */
+            explicit NearDedup( int max_mismatches );
+
+            /** \fn Destructor */
+            ~NearDedup();
+
+            /**
+                \fn setKeepPolicy
+                \brief Sets which read of a cluster is kept, before any insert.
+                @param keep_policy policy
+                @param phred_offset quality encoding for best-quality, 33 or 64
+            */
+            void setKeepPolicy( ShardedDedup::KeepPolicy keep_policy, int phred_offset = 33 );
+
+            /**
+                \fn setBinQualities
+                \brief Bins the qualities of kept records, see PackedSeq::setBinQualities.
+                @param bin_qualities bin and pack qualities
+                @param phred_offset quality encoding, 33 or 64
+            */
+            void setBinQualities( bool bin_qualities, int phred_offset );
+
+            /**
+                \fn insert
+                \brief Adds a read to its cluster, or seeds a new one.
+                @param record read
+            */
+            void insert( const FastQ::FastQView& record );
+
+            /**
+                \fn writeSorted
+                \brief Writes the kept record of every cluster, sorted by sequence.
+                @param write receives each record
+            */
+            void writeSorted( WriteFunction write );
+
+            /**
+                \fn size
+                \brief Returns the number of clusters.
+                @return Clusters
+            */
+            size_t size() const;
+
+            /**
+                \fn getNumNear
+                \brief Returns the number of reads joined to a seed with a different sequence.
+                @return Reads
+            */
+            unsigned long long getNumNear() const;
+
+            /**
+                \fn getMemoryUsage
+                \brief Returns the bytes used by kept records, seeds and the segment index.
+                @return Bytes
+            */
+            unsigned long long getMemoryUsage() const;
+
+    }; // class NearDedup
+
+} // namespace NearDedup
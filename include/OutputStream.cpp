@@ -0,0 +1,363 @@
+/*! \file OutputStream.cpp
+    OutputStream Class Implementation.
+    \verbinclude OutputStream.cpp
+*/
+
+#include <string>
+#include <vector>
+#include <algorithm>                                  // min
+#include <functional>                                 // bind
+#include <fcntl.h>                                    // open
+#include <climits>                                    // IOV_MAX
+#include <unistd.h>                                   // write, close
+#include <zlib.h>                                     // deflate
+#include "OutputStream.h"                             // Declaration File
+
+namespace OutputStream
+{
+    static const size_t BGZF_BLOCK_SIZE = 0xff00;     // Uncompressed bytes per BGZF block
+    static const size_t BATCH_SIZE = 16 * BGZF_BLOCK_SIZE;  // Bytes per write or batch
+    static const size_t BGZF_HEADER_SIZE = 18;        // Header with the BC extra subfield
+    static const size_t BGZF_FOOTER_SIZE = 8;         // CRC32 and ISIZE
+
+    // Empty block marking the end of a BGZF file
+    static const unsigned char BGZF_EOF[28] =
+    {
+        0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+        0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+
+    // Little endian integers of the gzip header and footer
+    static void writeLE16( unsigned char* data, unsigned int value )
+    {
+        data[0] = value & 0xff;
+        data[1] = ( value >> 8 ) & 0xff;
+    }
+
+    static void writeLE32( unsigned char* data, unsigned int value )
+    {
+        writeLE16( data, value & 0xffff );
+        writeLE16( data + 2, value >> 16 );
+    }
+
+    //------------------------------Constructor---------------------------------//
+    OutputStream::OutputStream()
+    {
+        _fd = -1;
+        _owns_fd = false;
+        _num_threads = std::thread::hardware_concurrency();
+        if ( _num_threads < 1 )
+        {
+            _num_threads = 1;
+        }
+        _level = Z_DEFAULT_COMPRESSION;
+        _compressed = false;
+        _error = false;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    OutputStream::~OutputStream()
+    {
+        OutputStream::close();
+    }
+
+    //-----------------------------Open and Close-------------------------------//
+    bool OutputStream::isCompressedName( const std::string& file_name )
+    {
+        return ( file_name.size() > 3 && file_name.compare( file_name.size() - 3, 3, ".gz" ) == 0 ) ||
+               ( file_name.size() > 4 && file_name.compare( file_name.size() - 4, 4, ".bgz" ) == 0 );
+    }
+
+    bool OutputStream::isStandardOutput( const std::string& file_name )
+    {
+        return file_name == "-";
+    }
+
+    void OutputStream::setNumThreads( int num_threads )
+    {
+        _num_threads = num_threads > 0 ? num_threads : 1;
+    }
+
+    void OutputStream::setCompressionLevel( int level )
+    {
+        _level = level >= 1 && level <= 9 ? level : Z_DEFAULT_COMPRESSION;
+    }
+
+    bool OutputStream::open( const std::string& file_name )
+    {
+        OutputStream::close();
+        _error = false;
+
+        _owns_fd = !OutputStream::isStandardOutput( file_name );
+        _fd = _owns_fd ? ::open( file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666 ) :
+              STDOUT_FILENO;
+        if ( _fd < 0 )
+        {
+            return false;
+        }
+
+        _buffer.clear();
+        _buffer.reserve( BATCH_SIZE + BGZF_BLOCK_SIZE );
+        _compressed = OutputStream::isCompressedName( file_name );
+
+        if ( _compressed )
+        {
+            _blocks.reopen();
+            _blocks.setCapacity( 2 * _num_threads + 2 );
+            _tasks.reopen();
+            _tasks.setCapacity( 2 * _num_threads + 2 );
+
+            for ( int i = 0; i < _num_threads; i++ )
+            {
+                _workers.push_back( std::thread( [this]()
+                {
+                    std::packaged_task<std::string()> task;
+                    while ( _tasks.pop( task ) )
+                    {
+                        task();
+                    }
+                } ) );
+            }
+            _writer_thread = std::thread( &OutputStream::writeBlocks, this );
+        }
+        return true;
+    }
+
+    bool OutputStream::close()
+    {
+        if ( _fd < 0 )
+        {
+            return !_error;
+        }
+
+        OutputStream::flushBuffer();
+
+        if ( _compressed )
+        {
+            std::promise<std::string> eof_block;
+            eof_block.set_value( std::string( ( const char* )BGZF_EOF, sizeof( BGZF_EOF ) ) );
+            _blocks.push( eof_block.get_future() );
+
+            // Closed queues are drained before the threads exit
+            _tasks.close();
+            _blocks.close();
+            _writer_thread.join();
+            for ( size_t i = 0; i < _workers.size(); i++ )
+            {
+                _workers[i].join();
+            }
+            _workers.clear();
+        }
+
+        if ( _owns_fd && ::close( _fd ) != 0 )
+        {
+            _error = true;
+        }
+        _fd = -1;
+        return !_error;
+    }
+
+    //-------------------------------Writing------------------------------------//
+    bool OutputStream::writeFully( const char* data, size_t size )
+    {
+        ssize_t num_written;
+
+        while ( size > 0 )
+        {
+            num_written = ::write( _fd, data, size );
+            if ( num_written < 0 )
+            {
+                _error = true;
+                return false;
+            }
+            data += num_written;
+            size -= num_written;
+        }
+        return true;
+    }
+
+    bool OutputStream::writevFully( struct iovec* buffers, int count )
+    {
+        ssize_t num_written;
+
+        while ( count > 0 )
+        {
+            num_written = ::writev( _fd, buffers, std::min( count, IOV_MAX ) );
+            if ( num_written < 0 )
+            {
+                _error = true;
+                return false;
+            }
+
+            // Skip the buffers written, and the written part of a partial one
+            while ( count > 0 && size_t( num_written ) >= buffers->iov_len )
+            {
+                num_written -= buffers->iov_len;
+                buffers++;
+                count--;
+            }
+            if ( count > 0 )
+            {
+                buffers->iov_base = ( char* )buffers->iov_base + num_written;
+                buffers->iov_len -= num_written;
+            }
+        }
+        return true;
+    }
+
+    void OutputStream::write( std::string_view data )
+    {
+        _buffer.append( data );
+        if ( _buffer.size() >= BATCH_SIZE )
+        {
+            OutputStream::flushBuffer();
+        }
+    }
+
+    void OutputStream::writeLine( std::string_view line )
+    {
+        _buffer.append( line );
+        _buffer.push_back( '\n' );
+        if ( _buffer.size() >= BATCH_SIZE )
+        {
+            OutputStream::flushBuffer();
+        }
+    }
+
+    void OutputStream::writeBuffers( const struct iovec* buffers, int count )
+    {
+        std::vector<struct iovec> remaining( buffers, buffers + count );
+
+        if ( _fd < 0 )
+        {
+            return;
+        }
+
+        if ( _compressed )
+        {
+            for ( int i = 0; i < count; i++ )
+            {
+                OutputStream::write( std::string_view( ( const char* )buffers[i].iov_base,
+                                                       buffers[i].iov_len ) );
+            }
+            return;
+        }
+
+        // Earlier data is written first to keep the output in order
+        OutputStream::flushBuffer();
+        OutputStream::writevFully( remaining.data(), count );
+    }
+
+    void OutputStream::flushBuffer()
+    {
+        if ( _buffer.empty() || _fd < 0 )
+        {
+            return;
+        }
+
+        if ( !_compressed )
+        {
+            OutputStream::writeFully( _buffer.data(), _buffer.size() );
+            _buffer.clear();
+            return;
+        }
+
+        // The future is queued first so batches are written in submission order
+        std::packaged_task<std::string()> task( std::bind( &OutputStream::deflateBgzf, this,
+                                                std::move( _buffer ) ) );
+        if ( _blocks.push( task.get_future() ) )
+        {
+            _tasks.push( std::move( task ) );
+        }
+        _buffer = std::string();
+        _buffer.reserve( BATCH_SIZE + BGZF_BLOCK_SIZE );
+    }
+
+    void OutputStream::writeBlocks()
+    {
+        std::future<std::string> next_block;
+        std::string block;
+
+        // Keep draining after an error so the producer never blocks
+        while ( _blocks.pop( next_block ) )
+        {
+            block = next_block.get();
+            if ( !_error )
+            {
+                OutputStream::writeFully( block.data(), block.size() );
+            }
+        }
+    }
+
+    //----------------------------BGZF Deflating--------------------------------//
+    std::string OutputStream::deflateBgzf( const std::string& batch )
+    {
+        z_stream stream = z_stream();
+        std::string output;
+        unsigned char* block;
+        size_t offset = 0;
+        size_t input_size;
+        size_t block_start;
+        size_t block_size;
+
+        // Raw deflate, the gzip framing is written here
+        if ( deflateInit2( &stream, _level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+        {
+            _error = true;
+            return output;
+        }
+
+        while ( offset < batch.size() )
+        {
+            input_size = std::min( BGZF_BLOCK_SIZE, batch.size() - offset );
+            block_start = output.size();
+            output.resize( block_start + BGZF_HEADER_SIZE + deflateBound( &stream,
+                           input_size ) + BGZF_FOOTER_SIZE );
+
+            deflateReset( &stream );
+            stream.next_in = ( Bytef* )( batch.data() + offset );
+            stream.avail_in = input_size;
+            stream.next_out = ( Bytef* )&output[block_start + BGZF_HEADER_SIZE];
+            stream.avail_out = output.size() - block_start - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+            if ( deflate( &stream, Z_FINISH ) != Z_STREAM_END )
+            {
+                _error = true;
+                break;
+            }
+
+            block_size = BGZF_HEADER_SIZE + stream.total_out + BGZF_FOOTER_SIZE;
+            block = ( unsigned char* )&output[block_start];
+
+            // gzip header with the BC subfield holding the block size
+            block[0] = 0x1f;
+            block[1] = 0x8b;
+            block[2] = 8;                            // Deflate
+            block[3] = 4;                            // FEXTRA
+            writeLE32( block + 4, 0 );               // MTIME
+            block[8] = 0;                            // XFL
+            block[9] = 0xff;                         // Unknown OS
+            writeLE16( block + 10, 6 );              // XLEN
+            block[12] = 'B';
+            block[13] = 'C';
+            writeLE16( block + 14, 2 );
+            writeLE16( block + 16, block_size - 1 );
+
+            writeLE32( block + block_size - 8, crc32( 0, ( const Bytef* )batch.data() + offset,
+                                                      input_size ) );
+            writeLE32( block + block_size - 4, input_size );
+
+            output.resize( block_start + block_size );
+            offset += input_size;
+        }
+
+        deflateEnd( &stream );
+        return output;
+    }
+
+    //-----------------------------Get Attributes-------------------------------//
+    bool OutputStream::fail() const
+    {
+        return _error;
+    }
+
+} // namespace OutputStream
@@ -0,0 +1,145 @@
+/*! \file OutputStream.h
+    OutputStream Class Declaration.
+    \verbinclude OutputStream.h
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <future>                                     // Ordered compressed batches
+#include <atomic>
+#include <sys/uio.h>                                  // iovec
+#include "BoundedQueue.h"                             // Blocking queues
+
+namespace OutputStream
+{
+    /** \class OutputStream
+        \brief Buffered output file, BGZF compressed when the name ends in ".gz".
+
+        Plain output is collected in a large buffer and written with one system
+        call per buffer. Compressed output is cut into batches of independent
+        BGZF blocks, which a pool of workers deflates in parallel while a writer
+        thread appends them to the file in order. BGZF is valid gzip, so the
+        output can be read by any gzip tool.
+    */
+    class OutputStream
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            int _fd;                               /**<Output file descriptor. */
+            bool _owns_fd;                         /**<False for standard output. */
+            int _num_threads;                      /**<Number of deflating threads. */
+            int _level;                            /**<zlib compression level. */
+            bool _compressed;                      /**<Output is BGZF compressed. */
+            std::atomic<bool> _error;              /**<A write failed. */
+            std::string _buffer;                   /**<Data not yet written or compressed. */
+
+            /** Compressed batches in file order, each resolved by a worker. */
+            BoundedQueue::BoundedQueue<std::future<std::string> > _blocks;
+            /** Batches waiting for a worker. */
+            BoundedQueue::BoundedQueue<std::packaged_task<std::string()> > _tasks;
+
+            std::thread _writer_thread;            /**<Writes compressed batches in order. */
+            std::vector<std::thread> _workers;     /**<Deflate batches. */
+
+            bool writeFully( const char* data, size_t size );
+            bool writevFully( struct iovec* buffers, int count );
+            void flushBuffer();
+            void writeBlocks();
+            std::string deflateBgzf( const std::string& batch );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the OutputStream object.
+                Constructs the OutputStream with no open file, one thread per core
+                and the default compression level.
+            */
+            OutputStream();
+
+            /** \fn Destructor */
+            ~OutputStream();
+
+            /**
+                \fn isCompressedName
+                \brief Checks if a file name asks for compressed output.
+                @param file_name output file
+                @return True if the name ends in ".gz" or ".bgz"
+            */
+            static bool isCompressedName( const std::string& file_name );
+
+            /**
+                \fn isStandardOutput
+                \brief Checks if a file name stands for standard output.
+                @param file_name output file
+                @return True for "-"
+            */
+            static bool isStandardOutput( const std::string& file_name );
+
+            /**
+                \fn setNumThreads
+                \brief Sets the number of threads deflating blocks, applied by the next open.
+                @param num_threads number of threads
+            */
+            void setNumThreads( int num_threads );
+
+            /**
+                \fn setCompressionLevel
+                \brief Sets the zlib compression level, 1 (fastest) to 9 (smallest).
+                @param level compression level
+            */
+            void setCompressionLevel( int level );
+
+            /**
+                \fn open
+                \brief Creates or truncates an output file.
+                @param file_name output file, compressed if isCompressedName, or "-" for standard output
+                @return True if the file could be opened
+            */
+            bool open( const std::string& file_name );
+
+            /**
+                \fn write
+                \brief Appends data to the output.
+                @param data data to append
+            */
+            void write( std::string_view data );
+
+            /**
+                \fn writeLine
+                \brief Appends a line and its newline to the output.
+                @param line line to append, without the newline
+            */
+            void writeLine( std::string_view line );
+
+            /**
+                \fn writeBuffers
+                \brief Appends several buffers to the output in one call.
+                Plain output is written straight from the buffers with writev, so
+                callers can format into buffers of their own without another copy.
+                @param buffers buffers to append, in order
+                @param count number of buffers
+            */
+            void writeBuffers( const struct iovec* buffers, int count );
+
+            /**
+                \fn close
+                \brief Writes all buffered data and closes the file.
+                @return False if any write failed
+            */
+            bool close();
+
+            /**
+                \fn fail
+                \brief Returns true if a write failed.
+                @return Error state
+            */
+            bool fail() const;
+
+    }; // class OutputStream
+
+} // namespace OutputStream
@@ -0,0 +1,473 @@
+/*! \file PackedSeq.cpp
+    PackedSeq Class Implementation.
+    \verbinclude PackedSeq.cpp
+*/
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>                                  // min
+#include <cstring>                                    // memcpy, memcmp
+#include "PackedSeq.h"                                // Declaration File
+
+namespace PackedSeq
+{
+    static const size_t BLOCK_SIZE = 4 * 1024 * 1024; // Record storage block size
+    static const size_t EXCEPTION_SIZE = 5;           // Position and base of an exception
+    static const uint8_t EXCEPTION_CODE = 4;          // Base that is not A, C, G or T
+    static const char BASES[4] = { 'A', 'C', 'G', 'T' };
+    static const int QUALITY_BINS[4] = { 2, 12, 23, 37 };  // Phred score of each bin
+
+    // Lengths stored at the start of every record
+    struct Header
+    {
+        uint32_t id_length;
+        uint32_t line3_length;
+        uint32_t sequence_length;
+        uint32_t quality_length;
+        uint32_t num_exceptions;
+        uint32_t binned;
+    };
+
+    //-----------------------------Code Tables----------------------------------//
+    // Symbols of the four codes packed in each byte value
+    static void buildUnpackTable( const char symbols[4], char table[256][4] )
+    {
+        for ( int byte = 0; byte < 256; byte++ )
+        {
+            for ( int j = 0; j < 4; j++ )
+            {
+                table[byte][j] = symbols[( byte >> ( 6 - 2 * j ) ) & 3];
+            }
+        }
+    }
+
+    struct CodeTables
+    {
+        uint8_t base_codes[256];                      // 2 bit code of each character
+        uint8_t quality_codes[256];                   // Bin of each Phred score
+        char bases[256][4];                           // Bases of each packed byte
+
+        CodeTables()
+        {
+            buildUnpackTable( BASES, bases );
+            memset( base_codes, EXCEPTION_CODE, sizeof( base_codes ) );
+            base_codes[( uint8_t )'A'] = 0;
+            base_codes[( uint8_t )'C'] = 1;
+            base_codes[( uint8_t )'G'] = 2;
+            base_codes[( uint8_t )'T'] = 3;
+
+            for ( int score = 0; score < 256; score++ )
+            {
+                quality_codes[score] = score < 3 ? 0 : score < 15 ? 1 : score < 31 ? 2 : 3;
+            }
+        }
+    };
+
+    static const CodeTables CODE_TABLES;
+
+    static inline size_t packedSize( size_t length )
+    {
+        return ( length + 3 ) / 4;
+    }
+
+    static inline Header readHeader( Ref record )
+    {
+        Header header;
+        memcpy( &header, record, sizeof( header ) );
+        return header;
+    }
+
+    // Bases come first, next to the lengths, as comparisons only read them
+    static inline const uint8_t* getPackedBases( Ref record, const Header& header )
+    {
+        return ( const uint8_t* )( record + sizeof( Header ) );
+    }
+
+    static inline const char* getExceptions( Ref record, const Header& header )
+    {
+        return ( const char* )getPackedBases( record, header ) + packedSize( header.sequence_length );
+    }
+
+    static inline const char* getIdText( Ref record, const Header& header )
+    {
+        return getExceptions( record, header ) + header.num_exceptions * EXCEPTION_SIZE;
+    }
+
+    static inline const char* getLine3( Ref record, const Header& header )
+    {
+        return getIdText( record, header ) + header.id_length;
+    }
+
+    static inline const char* getQuality( Ref record, const Header& header )
+    {
+        return getLine3( record, header ) + header.line3_length;
+    }
+
+    static size_t getRecordSize( Ref record )
+    {
+        Header header = readHeader( record );
+        size_t quality_size = header.binned ? packedSize( header.quality_length ) :
+                              header.quality_length;
+
+        return getQuality( record, header ) + quality_size - record;
+    }
+
+    // Packs 2 bit codes, four per byte with the first in the high bits
+    static void packCodes( const char* text, size_t length, const uint8_t* codes,
+                           uint8_t offset, uint8_t* packed )
+    {
+        size_t full_bytes = length / 4;
+        size_t i;
+
+        for ( i = 0; i < full_bytes; i++ )
+        {
+            packed[i] = ( codes[uint8_t( text[4 * i] - offset )] & 3 ) << 6 |
+                        ( codes[uint8_t( text[4 * i + 1] - offset )] & 3 ) << 4 |
+                        ( codes[uint8_t( text[4 * i + 2] - offset )] & 3 ) << 2 |
+                        ( codes[uint8_t( text[4 * i + 3] - offset )] & 3 );
+        }
+        if ( length % 4 != 0 )
+        {
+            packed[full_bytes] = 0;
+            for ( i = 4 * full_bytes; i < length; i++ )
+            {
+                packed[full_bytes] |= ( codes[uint8_t( text[i] - offset )] & 3 ) << ( 6 - 2 * ( i % 4 ) );
+            }
+        }
+    }
+
+    // Unpacks four symbols per byte, with a table from buildUnpackTable
+    static void unpackCodes( const uint8_t* packed, size_t length, const char table[256][4],
+                             char* text )
+    {
+        size_t i;
+
+        for ( i = 0; i + 4 <= length; i += 4 )
+        {
+            memcpy( text + i, table[packed[i / 4]], 4 );
+        }
+        for ( ; i < length; i++ )
+        {
+            text[i] = table[packed[i / 4]][i % 4];
+        }
+    }
+
+    static void unpackSequence( Ref record, const Header& header, char* sequence )
+    {
+        const char* exceptions = getExceptions( record, header );
+        uint32_t position;
+
+        unpackCodes( getPackedBases( record, header ), header.sequence_length, CODE_TABLES.bases,
+                     sequence );
+        for ( uint32_t i = 0; i < header.num_exceptions; i++ )
+        {
+            memcpy( &position, exceptions + i * EXCEPTION_SIZE, sizeof( position ) );
+            sequence[position] = exceptions[i * EXCEPTION_SIZE + sizeof( position )];
+        }
+    }
+
+    //------------------------------Constructor---------------------------------//
+    PackedSeq::PackedSeq() : _arena( BLOCK_SIZE )
+    {
+        _last = NULL;
+        PackedSeq::setBinQualities( false, 33 );
+    }
+
+    //------------------------------Destructor----------------------------------//
+    PackedSeq::~PackedSeq()
+    {
+
+    }
+
+    //-------------------------------Storage------------------------------------//
+    void PackedSeq::setBinQualities( bool bin_qualities, int phred_offset )
+    {
+        char symbols[4];
+
+        _bin_qualities = bin_qualities;
+        _phred_offset = phred_offset;
+        for ( int i = 0; i < 4; i++ )
+        {
+            symbols[i] = _phred_offset + QUALITY_BINS[i];
+        }
+        buildUnpackTable( symbols, _quality_symbols );
+    }
+
+    Ref PackedSeq::add( const FastQ::FastQView& record )
+    {
+        Header header;
+        size_t size;
+        char* start;
+        char* exceptions;
+        uint32_t position;
+
+        header.id_length = record.id.size();
+        header.line3_length = record.line3.size();
+        header.sequence_length = record.sequence.size();
+        header.quality_length = record.quality.size();
+        header.num_exceptions = 0;
+        header.binned = _bin_qualities;
+        for ( char base : record.sequence )
+        {
+            header.num_exceptions += CODE_TABLES.base_codes[( uint8_t )base] == EXCEPTION_CODE;
+        }
+
+        size = sizeof( header ) + header.id_length + header.line3_length +
+               packedSize( header.sequence_length ) + header.num_exceptions * EXCEPTION_SIZE +
+               ( _bin_qualities ? packedSize( header.quality_length ) : header.quality_length );
+        start = _arena.allocate( size, 1 );         // Records are read with memcpy, unaligned
+
+        memcpy( start, &header, sizeof( header ) );
+        memcpy( ( char* )getIdText( start, header ), record.id.data(), header.id_length );
+        memcpy( ( char* )getLine3( start, header ), record.line3.data(), header.line3_length );
+        packCodes( record.sequence.data(), header.sequence_length, CODE_TABLES.base_codes, 0,
+                   ( uint8_t* )getPackedBases( start, header ) );
+
+        exceptions = ( char* )getExceptions( start, header );
+        for ( position = 0; header.num_exceptions > 0 && position < header.sequence_length; position++ )
+        {
+            if ( CODE_TABLES.base_codes[( uint8_t )record.sequence[position]] == EXCEPTION_CODE )
+            {
+                memcpy( exceptions, &position, sizeof( position ) );
+                exceptions[sizeof( position )] = record.sequence[position];
+                exceptions += EXCEPTION_SIZE;
+            }
+        }
+
+        if ( _bin_qualities )
+        {
+            packCodes( record.quality.data(), header.quality_length, CODE_TABLES.quality_codes,
+                       _phred_offset, ( uint8_t* )getQuality( start, header ) );
+        }
+        else
+        {
+            memcpy( ( char* )getQuality( start, header ), record.quality.data(), header.quality_length );
+        }
+
+        _last = start;
+        return start;
+    }
+
+    Ref PackedSeq::replace( Ref old_record, Ref new_record )
+    {
+        // Fields must line up, views of the old id stay valid
+        if ( new_record != _last || memcmp( old_record, new_record, sizeof( Header ) ) != 0 )
+        {
+            return new_record;
+        }
+        memcpy( ( char* )old_record, new_record, getRecordSize( new_record ) );
+        PackedSeq::discard( new_record );
+        return old_record;
+    }
+
+    void PackedSeq::discard( Ref record )
+    {
+        if ( record == NULL || record != _last )
+        {
+            return;
+        }
+        _arena.deallocate( ( char* )record, getRecordSize( record ) );
+        _last = NULL;
+    }
+
+    void PackedSeq::clear()
+    {
+        _arena.clear();
+        _last = NULL;
+    }
+
+    const Arena::Arena& PackedSeq::getArena() const
+    {
+        return _arena;
+    }
+
+    //-------------------------------Access-------------------------------------//
+    void PackedSeq::getRecord( Ref record, std::string& buffer, FastQ::FastQView& view ) const
+    {
+        Header header = readHeader( record );
+        const char* quality = getQuality( record, header );
+
+        buffer.resize( header.sequence_length + ( header.binned ? header.quality_length : 0 ) );
+        unpackSequence( record, header, &buffer[0] );
+
+        view.id = std::string_view( getIdText( record, header ), header.id_length );
+        view.line3 = std::string_view( getLine3( record, header ), header.line3_length );
+        view.sequence = std::string_view( buffer.data(), header.sequence_length );
+        if ( header.binned )
+        {
+            unpackCodes( ( const uint8_t* )quality, header.quality_length, _quality_symbols,
+                         &buffer[header.sequence_length] );
+            view.quality = std::string_view( buffer.data() + header.sequence_length,
+                                             header.quality_length );
+        }
+        else
+        {
+            view.quality = std::string_view( quality, header.quality_length );
+        }
+    }
+
+    std::string_view PackedSeq::getQualityLine( Ref record, std::string& buffer ) const
+    {
+        Header header = readHeader( record );
+        const char* quality = getQuality( record, header );
+
+        if ( !header.binned )
+        {
+            return std::string_view( quality, header.quality_length );
+        }
+        buffer.resize( header.quality_length );
+        unpackCodes( ( const uint8_t* )quality, header.quality_length, _quality_symbols, &buffer[0] );
+        return std::string_view( buffer.data(), header.quality_length );
+    }
+
+    std::string_view PackedSeq::getId( Ref record )
+    {
+        Header header = readHeader( record );
+        return std::string_view( getIdText( record, header ), header.id_length );
+    }
+
+    size_t PackedSeq::getLength( Ref record )
+    {
+        return readHeader( record ).sequence_length;
+    }
+
+    //-----------------------------Comparison-----------------------------------//
+    static inline int getCode( const uint8_t* bases, size_t position )
+    {
+        return ( bases[position / 4] >> ( 6 - 2 * ( position % 4 ) ) ) & 3;
+    }
+
+    // Compares the codes of two packed sequences from start up to end
+    static int compareCodes( const uint8_t* first, const uint8_t* second, size_t start, size_t end )
+    {
+        int order;
+
+        // Both sequences share the same layout, so whole bytes compare directly
+        for ( ; start < end && start % 4 != 0; start++ )
+        {
+            if ( ( order = getCode( first, start ) - getCode( second, start ) ) != 0 )
+            {
+                return order;
+            }
+        }
+        if ( end / 4 > start / 4 )
+        {
+            if ( ( order = memcmp( first + start / 4, second + start / 4, end / 4 - start / 4 ) ) != 0 )
+            {
+                return order;
+            }
+            start = end / 4 * 4;
+        }
+        for ( ; start < end; start++ )
+        {
+            if ( ( order = getCode( first, start ) - getCode( second, start ) ) != 0 )
+            {
+                return order;
+            }
+        }
+        return 0;
+    }
+
+    static inline uint32_t getExceptionPosition( const char* exceptions, uint32_t index,
+                                                 uint32_t num_exceptions )
+    {
+        uint32_t position = UINT32_MAX;
+
+        if ( index < num_exceptions )
+        {
+            memcpy( &position, exceptions + index * EXCEPTION_SIZE, sizeof( position ) );
+        }
+        return position;
+    }
+
+    // Compares the common part of two sequences with exceptions
+    static int compareWithExceptions( Ref first, const Header& first_header, Ref second,
+                                      const Header& second_header, uint32_t common )
+    {
+        const uint8_t* first_bases = getPackedBases( first, first_header );
+        const uint8_t* second_bases = getPackedBases( second, second_header );
+        const char* first_exceptions = getExceptions( first, first_header );
+        const char* second_exceptions = getExceptions( second, second_header );
+        uint32_t first_index = 0;
+        uint32_t second_index = 0;
+        uint32_t first_next = getExceptionPosition( first_exceptions, 0, first_header.num_exceptions );
+        uint32_t second_next = getExceptionPosition( second_exceptions, 0, second_header.num_exceptions );
+        uint32_t position = 0;
+        uint32_t next;
+        uint8_t first_base;
+        uint8_t second_base;
+        int order;
+
+        // Packed runs between exceptions sort as the text does
+        while ( position < common )
+        {
+            next = std::min( std::min( first_next, second_next ), common );
+            if ( ( order = compareCodes( first_bases, second_bases, position, next ) ) != 0 )
+            {
+                return order;
+            }
+            if ( next == common )
+            {
+                break;
+            }
+
+            first_base = BASES[getCode( first_bases, next )];
+            if ( first_next == next )
+            {
+                first_base = first_exceptions[first_index * EXCEPTION_SIZE + sizeof( uint32_t )];
+                first_next = getExceptionPosition( first_exceptions, ++first_index,
+                                                   first_header.num_exceptions );
+            }
+            second_base = BASES[getCode( second_bases, next )];
+            if ( second_next == next )
+            {
+                second_base = second_exceptions[second_index * EXCEPTION_SIZE + sizeof( uint32_t )];
+                second_next = getExceptionPosition( second_exceptions, ++second_index,
+                                                    second_header.num_exceptions );
+            }
+            if ( first_base != second_base )
+            {
+                return int( first_base ) - int( second_base );
+            }
+            position = next + 1;
+        }
+        return 0;
+    }
+
+    int PackedSeq::compareSequences( Ref first, Ref second, bool prefix_last )
+    {
+        Header first_header = readHeader( first );
+        Header second_header = readHeader( second );
+        uint32_t common = std::min( first_header.sequence_length, second_header.sequence_length );
+        const uint8_t* first_bases = getPackedBases( first, first_header );
+        const uint8_t* second_bases = getPackedBases( second, second_header );
+        int shift = 8 - 2 * ( common % 4 );
+        int order;
+
+        if ( first_header.num_exceptions == 0 && second_header.num_exceptions == 0 )
+        {
+            // Whole bytes, then the bases in common of the last byte
+            order = memcmp( first_bases, second_bases, common / 4 );
+            if ( order == 0 && common % 4 != 0 )
+            {
+                order = int( first_bases[common / 4] >> shift ) - int( second_bases[common / 4] >> shift );
+            }
+        }
+        else
+        {
+            order = compareWithExceptions( first, first_header, second, second_header, common );
+        }
+        if ( order != 0 )
+        {
+            return order;
+        }
+
+        // One sequence is a prefix of the other
+        order = int( first_header.sequence_length > second_header.sequence_length ) -
+                int( first_header.sequence_length < second_header.sequence_length );
+        return prefix_last ? -order : order;
+    }
+
+} // namespace PackedSeq
@@ -0,0 +1,204 @@
+/*! \file PackedSeq.h
+    PackedSeq Class Declaration.
+    \verbinclude PackedSeq.h
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <utility>                                    // pair, swap
+#include <cstddef>
+#include <cstdint>
+#include "FastQ.h"                                    // FastQView
+#include "Arena.h"                                    // Record storage blocks
+
+namespace PackedSeq
+{
+    /** \typedef Ref
+        \brief Handle of a record stored in a PackedSeq, stable until the PackedSeq is cleared.
+    */
+    typedef const char* Ref;
+
+    /** \class PackedSeq
+        \brief Compact in-memory storage for fastq records.
+
+        Sequences are stored at 2 bits per base, A, C, G and T coded 0 to 3 with
+        the first base in the high bits of each byte, so packed sequences sort
+        with memcmp in the same order as their text. N and any other IUPAC code
+        or lowercase base is coded as A and kept in a short exception list.
+        Qualities are stored as text or, optionally, binned to four levels and
+        packed at 2 bits per base as well. Records are laid out back to back in
+        large blocks, so storing one costs no allocation of its own and the
+        returned Ref stays valid while more records are added.
+    */
+    class PackedSeq
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            Arena::Arena _arena;                   /**<Record storage. */
+            Ref _last;                             /**<Most recently added record. */
+            bool _bin_qualities;                   /**<Qualities are binned and packed. */
+            char _phred_offset;                    /**<Quality encoding of binned qualities. */
+            char _quality_symbols[256][4];         /**<Binned qualities of each packed byte. */
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the PackedSeq object.
+                Constructs an empty PackedSeq keeping qualities as text.
+            */
+            PackedSeq();
+
+            /** \fn Destructor */
+            ~PackedSeq();
+
+            /**
+                \fn setBinQualities
+                \brief Bins qualities of records added afterwards to Phred 2, 12, 23 and 37.
+                Binning is lossy, it quarters the memory used by qualities.
+                @param bin_qualities bin and pack qualities
+                @param phred_offset quality encoding, 33 or 64
+            */
+            void setBinQualities( bool bin_qualities, int phred_offset );
+
+            /**
+                \fn add
+                \brief Packs and stores a copy of a record.
+                @param record record to store
+                @return Handle of the stored record
+            */
+            Ref add( const FastQ::FastQView& record );
+
+            /**
+                \fn replace
+                \brief Replaces a stored record with the most recently added one.
+                When both have fields of the same lengths the newest record is
+                copied over the old one and its own space is reused, so replacing a
+                duplicate read usually does not grow the storage.
+                @param old_record record to replace
+                @param new_record record returned by the last call to add
+                @return Handle of the record to keep, old_record or new_record
+            */
+            Ref replace( Ref old_record, Ref new_record );
+
+            /**
+                \fn discard
+                \brief Frees the most recently added record, ex. a duplicate that is not kept.
+                @param record record returned by the last call to add
+            */
+            void discard( Ref record );
+
+            /**
+                \fn getRecord
+                \brief Unpacks a stored record.
+                @param record stored record
+                @param buffer holds the unpacked sequence (and binned quality)
+                @param view set to the record, valid until buffer changes
+            */
+            void getRecord( Ref record, std::string& buffer, FastQ::FastQView& view ) const;
+
+            /**
+                \fn getQualityLine
+                \brief Returns the quality line of a stored record, without unpacking its sequence.
+                @param record stored record
+                @param buffer holds the unpacked binned quality
+                @return View of the quality, valid until buffer changes
+            */
+            std::string_view getQualityLine( Ref record, std::string& buffer ) const;
+
+            /**
+                \fn getId
+                \brief Returns the identifier of a stored record, without unpacking it.
+                @param record stored record
+                @return View of the identifier, valid until the PackedSeq is cleared
+            */
+            static std::string_view getId( Ref record );
+
+            /**
+                \fn getLength
+                \brief Returns the sequence length of a stored record.
+                @param record stored record
+                @return Length
+            */
+            static size_t getLength( Ref record );
+
+            /**
+                \fn compareSequences
+                \brief Compares the sequences of two stored records in text order.
+                @param first stored record
+                @param second stored record
+                @param prefix_last sort a sequence after the longer ones it is a prefix of
+                @return Negative, zero or positive like std::string::compare
+            */
+            static int compareSequences( Ref first, Ref second, bool prefix_last = false );
+
+            /**
+                \fn getArena
+                \brief Returns the storage of the records, for its memory and allocation counters.
+                @return Arena
+            */
+            const Arena::Arena& getArena() const;
+
+            /**
+                \fn clear
+                \brief Frees all stored records, invalidating their handles.
+            */
+            void clear();
+
+    }; // class PackedSeq
+
+    /** \struct SequenceLess
+        \brief Orders stored records by sequence, as std::string would.
+    */
+    struct SequenceLess
+    {
+        bool operator()( Ref first, Ref second ) const
+        {
+            return PackedSeq::compareSequences( first, second ) < 0;
+        }
+    };
+
+    /** \struct PairedSequenceLess
+        \brief Orders stored mate pairs by first then second sequence.
+        Sorts as the joined key first + "}{" + second would, the order used to
+        write paired-end duplicates.
+    */
+    struct PairedSequenceLess
+    {
+        bool operator()( const std::pair<Ref, Ref>& first, const std::pair<Ref, Ref>& second ) const
+        {
+            int first_order = PackedSeq::compareSequences( first.first, second.first, true );
+
+            if ( first_order != 0 )
+            {
+                return first_order < 0;
+            }
+            return PackedSeq::compareSequences( first.second, second.second ) < 0;
+        }
+    };
+
+    /** \struct CanonicalPairLess
+        \brief Orders stored mate pairs as PairedSequenceLess, each with its lesser sequence first.
+        The order of paired-end duplicates when swapped mates are duplicates.
+    */
+    struct CanonicalPairLess
+    {
+        bool operator()( std::pair<Ref, Ref> first, std::pair<Ref, Ref> second ) const
+        {
+            if ( PackedSeq::compareSequences( first.second, first.first ) < 0 )
+            {
+                std::swap( first.first, first.second );
+            }
+            if ( PackedSeq::compareSequences( second.second, second.first ) < 0 )
+            {
+                std::swap( second.first, second.second );
+            }
+            return PairedSequenceLess()( first, second );
+        }
+    };
+
+} // namespace PackedSeq
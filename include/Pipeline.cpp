@@ -0,0 +1,592 @@
+/*! \file Pipeline.cpp
+    Pipeline Class Implementation.
+    \verbinclude Pipeline.cpp
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>                                    // Set Precision
+#include "Pipeline.h"                                 // Declaration File
+#include "FastQReader.h"                              // Paired and intersect input
+#include "FastQBlockReader.h"                         // Parallel single-end input
+#include "FastQWriter.h"                              // Batched fastq output
+#include "QualityKernel.h"                            // Vectorized quality threshold counting
+
+namespace Pipeline
+{
+    //--------------------------------Stages------------------------------------//
+    static const char* STAGE_NAMES[] = { "qc", "dedup", "stats", "intersect" };
+
+    bool parseStages( const std::string& list, std::vector<StageType>& stages )
+    {
+        std::istringstream names( list );
+        std::string name;
+        int stage;
+
+        stages.clear();
+        while ( std::getline( names, name, ',' ) )
+        {
+            for ( stage = QUALITY_FILTER; stage <= INTERSECT; stage++ )
+            {
+                if ( name == STAGE_NAMES[stage] )
+                {
+                    break;
+                }
+            }
+            if ( stage > INTERSECT )
+            {
+                return false;
+            }
+            for ( size_t i = 0; i < stages.size(); i++ )
+            {
+                if ( stages[i] == stage )
+                {
+                    return false;
+                }
+            }
+            stages.push_back( StageType( stage ) );
+        }
+        return !stages.empty();
+    }
+
+    const char* getStageName( StageType stage )
+    {
+        return STAGE_NAMES[stage];
+    }
+
+    //--------------------------------Batch-------------------------------------//
+    void Batch::clear()
+    {
+        first.clear();
+        second.clear();
+        stats_first.clear();
+        stats_second.clear();
+    }
+
+    void Batch::keep( const std::vector<bool>& keep_record )
+    {
+        size_t num_kept = 0;
+
+        for ( size_t i = 0; i < first.size(); i++ )
+        {
+            if ( keep_record[i] )
+            {
+                first[num_kept] = first[i];
+                if ( !second.empty() )
+                {
+                    second[num_kept] = second[i];
+                }
+                num_kept++;
+            }
+        }
+        first.resize( num_kept );
+        if ( !second.empty() )
+        {
+            second.resize( num_kept );
+        }
+    }
+
+    // Writes a two line stats file, the format shared by the modules
+    static bool writeStatsFile( const std::string& file_name, const char* header,
+                                unsigned long long total, unsigned long long kept, bool percent_sign )
+    {
+        std::ofstream stats_file( file_name.c_str() );
+
+        stats_file << "Total_Sequences\t" << header << std::endl;
+        stats_file << total << "\t" << kept << "\t" << std::setprecision( 4 ) <<
+                   kept / ( float )total * 100 << ( percent_sign ? "%" : "" ) << std::endl;
+        return !stats_file.fail();
+    }
+
+    //----------------------------Quality Filter--------------------------------//
+    QualityFilter::QualityFilter()
+    {
+        _phred_offset = 33;
+        _min_quality = 0;
+        _proportion = 0;
+        _min_length = 0;
+        _num_input = 0;
+        _num_kept = 0;
+    }
+
+    void QualityFilter::setSettings( int phred_offset, int min_quality, float proportion,
+                                     int min_length )
+    {
+        _phred_offset = phred_offset;
+        _min_quality = min_quality;
+        _proportion = proportion;
+        _min_length = min_length;
+    }
+
+    bool QualityFilter::passes( const FastQ::FastQView& record ) const
+    {
+        int bases_above_threshold;
+
+        if ( record.getLength() < _min_length )
+        {
+            return false;
+        }
+        bases_above_threshold = QualityKernel::countAboveThreshold(
+                                    record.quality.substr( 0, record.getLength() ), _phred_offset + _min_quality );
+        return bases_above_threshold >= record.getLength() * _proportion;
+    }
+
+    void QualityFilter::apply( Batch& batch )
+    {
+        std::vector<bool> keep_record( batch.first.size() );
+
+        for ( size_t i = 0; i < batch.first.size(); i++ )
+        {
+            keep_record[i] = QualityFilter::passes( batch.first[i] ) &&
+                             ( batch.second.empty() || QualityFilter::passes( batch.second[i] ) );
+        }
+        _num_input += batch.first.size();
+        batch.keep( keep_record );
+        _num_kept += batch.first.size();
+    }
+
+    bool QualityFilter::writeStats( const std::string& file_name, bool paired ) const
+    {
+        return writeStatsFile( file_name, "Filtered_Sequences\tPercent_Filtered", _num_input,
+                               _num_kept, !paired );
+    }
+
+    //------------------------------Deduplicator--------------------------------//
+    Deduplicator::Deduplicator()
+    {
+        _num_input = 0;
+    }
+
+    void Deduplicator::apply( Batch& batch )
+    {
+        std::vector<bool> keep_record( batch.first.size() );
+
+        for ( size_t i = 0; i < batch.first.size(); i++ )
+        {
+            // Mates are hashed together as RemoveDuplicatesPairedEnd --stream does
+            keep_record[i] = batch.second.empty() ? _seen.insertSequence( batch.first[i].sequence ) :
+                             _seen.insertHash( SeqHash::hashPair( batch.first[i].sequence,
+                                               batch.second[i].sequence ) );
+        }
+        _num_input += batch.first.size();
+        batch.keep( keep_record );
+    }
+
+    bool Deduplicator::writeStats( const std::string& file_name ) const
+    {
+        return writeStatsFile( file_name, "Unique_Sequences\tPercent_Unique", _num_input,
+                               _seen.size(), false );
+    }
+
+    //-------------------------------Read Stats---------------------------------//
+    void ReadStats::format( const std::vector<FastQ::FastQView>& records, std::string& rows )
+    {
+        std::ostringstream stats;
+
+        // Average quality is not calculated per read, as in FastQStats
+        for ( size_t i = 0; i < records.size(); i++ )
+        {
+            stats << records[i].id << '\t' << records[i].getLength() << '\t' << records[i].getGC() <<
+                  '\t' << 0 << '\n';
+        }
+        rows += stats.str();
+    }
+
+    void ReadStats::apply( Batch& batch )
+    {
+        ReadStats::format( batch.first, batch.stats_first );
+        ReadStats::format( batch.second, batch.stats_second );
+    }
+
+    //-------------------------------Intersector--------------------------------//
+    Intersector::Intersector()
+    {
+        _num_first = 0;
+        _num_second = 0;
+        _num_paired = 0;
+    }
+
+    bool Intersector::load( const std::string& file_name )
+    {
+        FastQReader::FastQReader reader;
+        FastQ::FastQView record;
+        PackedSeq::Ref stored;
+        std::pair<MateMap::iterator, bool> inserted;
+
+        reader.setRetainBuffers( false );
+        if ( !reader.open( file_name ) )
+        {
+            std::cerr << "ERROR: Cannot open input second fastq file: " << file_name << std::endl;
+            return false;
+        }
+
+        while ( reader.nextRecord( record ) )
+        {
+            stored = _mates.add( record );
+            inserted = _mate_ids.insert( std::make_pair( FastQ::getReadName( PackedSeq::PackedSeq::getId( stored ) ),
+                                         std::make_pair( stored, PackedSeq::Ref( NULL ) ) ) );
+
+            // Repeated id, the last record is kept
+            if ( !inserted.second )
+            {
+                inserted.first->second.first = _mates.replace( inserted.first->second.first, stored );
+            }
+            _num_second++;
+        }
+        _next_pair = _mate_ids.begin();
+        return !reader.fail();
+    }
+
+    void Intersector::addFirst( const FastQ::FastQView& first )
+    {
+        MateMap::iterator it = _mate_ids.find( FastQ::getReadName( first.id ) );
+        PackedSeq::Ref stored;
+
+        _num_first++;
+        if ( it == _mate_ids.end() )
+        {
+            return;
+        }
+
+        // Repeated id, the last record is kept
+        stored = _firsts.add( first );
+        it->second.second = it->second.second == NULL ? stored : _firsts.replace( it->second.second, stored );
+    }
+
+    bool Intersector::nextPair( FastQ::FastQView& first, FastQ::FastQView& mate )
+    {
+        for ( ; _next_pair != _mate_ids.end(); ++_next_pair )
+        {
+            if ( _next_pair->second.second != NULL )
+            {
+                _firsts.getRecord( _next_pair->second.second, _first_buffer, first );
+                _mates.getRecord( _next_pair->second.first, _mate_buffer, mate );
+                ++_next_pair;
+                _num_paired++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Intersector::writeStats( const std::string& file_name ) const
+    {
+        return writeStatsFile( file_name, "Paired_Sequences\tPercent_Paired",
+                               _num_first + _num_second, _num_paired, false );
+    }
+
+    //------------------------------Constructor---------------------------------//
+    Pipeline::Pipeline()
+    {
+        _num_parallel = 0;
+        _num_threads = 1;
+        _num_input = 0;
+        _num_output = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    Pipeline::~Pipeline()
+    {
+
+    }
+
+    //------------------------------Attributes----------------------------------//
+    bool Pipeline::setStages( const std::vector<StageType>& stages )
+    {
+        _stages = stages;
+
+        for ( size_t i = 1; i < _stages.size(); i++ )
+        {
+            if ( _stages[i] == INTERSECT )
+            {
+                return false;
+            }
+        }
+
+        // Stages before the first dedup see records independently of each other
+        for ( _num_parallel = 0; _num_parallel < _stages.size() &&
+                        _stages[_num_parallel] != DEDUP; _num_parallel++ );
+        return true;
+    }
+
+    void Pipeline::setNumThreads( int num_threads )
+    {
+        _num_threads = num_threads > 0 ? num_threads : 1;
+    }
+
+    QualityFilter& Pipeline::getQualityFilter()
+    {
+        return _quality_filter;
+    }
+
+    bool Pipeline::hasStage( StageType stage ) const
+    {
+        for ( size_t i = 0; i < _stages.size(); i++ )
+        {
+            if ( _stages[i] == stage )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned long long Pipeline::getNumInput() const
+    {
+        return _num_input;
+    }
+
+    unsigned long long Pipeline::getNumOutput() const
+    {
+        return _num_output;
+    }
+
+    //--------------------------------Running-----------------------------------//
+    void Pipeline::applyStages( Batch& batch, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end && !batch.first.empty(); i++ )
+        {
+            switch ( _stages[i] )
+            {
+                case QUALITY_FILTER:
+                    _quality_filter.apply( batch );
+                    break;
+                case DEDUP:
+                    _deduplicator.apply( batch );
+                    break;
+                case READ_STATS:
+                    _read_stats.apply( batch );
+                    break;
+                case INTERSECT:
+                    break;
+            }
+        }
+    }
+
+    bool Pipeline::run( const std::string& input_first, const std::string& input_second,
+                        const std::string& output_first, const std::string& output_second,
+                        const std::string& stats_prefix )
+    {
+        bool paired = !input_second.empty();
+        bool success;
+
+        if ( hasStage( INTERSECT ) && !paired )
+        {
+            std::cerr << "ERROR: The intersect stage needs two input fastq files." << std::endl;
+            return false;
+        }
+
+        // Per-read stats are written while records flow, the other stats at the end
+        if ( hasStage( READ_STATS ) )
+        {
+            if ( !_stats_first.open( stats_prefix + ( paired ? ".reads_1.tsv" : ".reads.tsv" ) ) ||
+                            ( paired && !_stats_second.open( stats_prefix + ".reads_2.tsv" ) ) )
+            {
+                std::cerr << "ERROR: Cannot open output stats file: " << stats_prefix << std::endl;
+                return false;
+            }
+            _stats_first.write( "Name\tLength\tGC.Content\tAverage.Quality\n" );
+            if ( paired )
+            {
+                _stats_second.write( "Name\tLength\tGC.Content\tAverage.Quality\n" );
+            }
+        }
+
+        success = paired ? runPaired( input_first, input_second, output_first, output_second ) :
+                  runSingle( input_first, output_first );
+        if ( !success )
+        {
+            return false;
+        }
+
+        if ( hasStage( READ_STATS ) && ( !_stats_first.close() || ( paired &&
+                                         !_stats_second.close() ) ) )
+        {
+            std::cerr << "ERROR: Cannot write output stats file: " << stats_prefix << std::endl;
+            return false;
+        }
+        if ( ( hasStage( QUALITY_FILTER ) &&
+                        !_quality_filter.writeStats( stats_prefix + ".qc.stats", paired ) ) ||
+                        ( hasStage( DEDUP ) && !_deduplicator.writeStats( stats_prefix + ".dedup.stats" ) ) ||
+                        ( hasStage( INTERSECT ) &&
+                          !_intersector.writeStats( stats_prefix + ".intersect.stats" ) ) )
+        {
+            std::cerr << "ERROR: Cannot write stats file: " << stats_prefix << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool Pipeline::runSingle( const std::string& input, const std::string& output )
+    {
+        FastQBlockReader::FastQBlockReader reader;
+        FastQWriter::FastQWriter writer;
+        std::vector<Batch> batches;
+        std::vector<size_t> batch_num_input;          // Records parsed into each batch slot
+
+        // Records are written before their chunk is released
+        reader.setNumThreads( _num_threads );
+        reader.setRetainBuffers( false );
+        if ( !reader.open( input ) )
+        {
+            std::cerr << "ERROR: Cannot open input fastq file: " << input << std::endl;
+            return false;
+        }
+        writer.setNumThreads( _num_threads );
+        if ( !writer.open( output ) )
+        {
+            std::cerr << "ERROR: Cannot open output fastq file: " << output << std::endl;
+            return false;
+        }
+        _progress_log.initLogBytes( input );
+
+        batches.resize( reader.getNumSlots() );
+        batch_num_input.resize( reader.getNumSlots(), 0 );
+        reader.parse(
+            // Worker thread: parse a chunk and run the stages that need no shared state
+            [&]( size_t chunk_index, FastQReader::FastQReader& chunk_reader )
+        {
+            Batch& batch = batches[chunk_index % reader.getNumSlots()];
+            FastQ::FastQView record;
+
+            batch.clear();
+            while ( chunk_reader.nextRecord( record ) )
+            {
+                batch.first.push_back( record );
+            }
+            batch_num_input[chunk_index % reader.getNumSlots()] = batch.first.size();
+            applyStages( batch, 0, _num_parallel );
+        },
+        // Calling thread: run the remaining stages and write, in file order
+        [&]( size_t chunk_index )
+        {
+            Batch& batch = batches[chunk_index % reader.getNumSlots()];
+
+            // Counted on the calling thread, the workers only fill their own slot
+            _num_input += batch_num_input[chunk_index % reader.getNumSlots()];
+            applyStages( batch, _num_parallel, _stages.size() );
+            for ( size_t i = 0; i < batch.first.size(); i++ )
+            {
+                writer.write( batch.first[i] );
+            }
+            _num_output += batch.first.size();
+            if ( hasStage( READ_STATS ) )
+            {
+                _stats_first.write( batch.stats_first );
+            }
+            batch.clear();
+            _progress_log.updateLogBytes( reader.getChunk( chunk_index ).input_end );
+        } );
+
+        if ( reader.fail() )
+        {
+            return false;
+        }
+        _progress_log.completeLog( _num_input );
+
+        if ( !writer.close() )
+        {
+            std::cerr << "ERROR: Cannot write output fastq file: " << output << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool Pipeline::runPaired( const std::string& input_first, const std::string& input_second,
+                              const std::string& output_first, const std::string& output_second )
+    {
+        FastQReader::FastQReader reader_first;
+        FastQReader::FastQReader reader_second;
+        FastQWriter::FastQPairedWriter writer;
+        FastQ::FastQView record_first;
+        FastQ::FastQView record_second;
+        bool intersect = hasStage( INTERSECT );
+        Batch batch;
+
+        // Pairs are processed one at a time, so no view outlives the next read
+        reader_first.setRetainBuffers( false );
+        reader_second.setRetainBuffers( false );
+        if ( intersect )
+        {
+            std::cout << "Storing second reads for the intersect stage." << std::endl;
+            if ( !_intersector.load( input_second ) )
+            {
+                return false;
+            }
+        }
+        else if ( !reader_second.open( input_second ) )
+        {
+            std::cerr << "ERROR: Cannot open input second fastq file: " << input_second << std::endl;
+            return false;
+        }
+        if ( !reader_first.open( input_first ) )
+        {
+            std::cerr << "ERROR: Cannot open input first fastq file: " << input_first << std::endl;
+            return false;
+        }
+        if ( !writer.getFirst().open( output_first ) || !writer.getSecond().open( output_second ) )
+        {
+            std::cerr << "ERROR: Cannot open output fastq files: " << output_first << " and " <<
+                      output_second << std::endl;
+            return false;
+        }
+        _progress_log.initLogBytes( input_first );
+
+        // A repeated first read name is paired at its last read, so pairs are
+        // only known once the first file is read
+        if ( intersect )
+        {
+            while ( reader_first.nextRecord( record_first ) )
+            {
+                _num_input++;
+                _progress_log.updateLogBytes( reader_first.getInputOffset() );
+                _intersector.addFirst( record_first );
+            }
+        }
+
+        // Pairs come from the intersect stage, or from both files in step
+        while ( intersect ? _intersector.nextPair( record_first, record_second ) :
+                        reader_first.nextRecord( record_first ) )
+        {
+            if ( !intersect )
+            {
+                _num_input++;
+                _progress_log.updateLogBytes( reader_first.getInputOffset() );
+                if ( !reader_second.nextRecord( record_second ) )
+                {
+                    record_second = FastQ::FastQView();
+                }
+            }
+
+            batch.clear();
+            batch.first.push_back( record_first );
+            batch.second.push_back( record_second );
+            applyStages( batch, 0, _stages.size() );
+            if ( !batch.first.empty() )
+            {
+                writer.write( batch.first[0], batch.second[0] );
+                _num_output++;
+            }
+            if ( hasStage( READ_STATS ) )
+            {
+                _stats_first.write( batch.stats_first );
+                _stats_second.write( batch.stats_second );
+            }
+        }
+        _progress_log.completeLog( _num_input );
+        if ( reader_first.fail() || reader_second.fail() )
+        {
+            return false;
+        }
+
+        if ( !writer.close() )
+        {
+            std::cerr << "ERROR: Cannot write output fastq files: " << output_first << " and " <<
+                      output_second << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+} // namespace Pipeline
@@ -0,0 +1,313 @@
+/*! \file Pipeline.h
+    Pipeline Class Declaration.
+    \verbinclude Pipeline.h
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <cstddef>
+#include "FastQ.h"                                    // FastQView
+#include "PackedSeq.h"                                // Stored mates of the intersect stage
+#include "SeqHash.h"                                  // Sequences kept by the dedup stage
+#include "OutputStream.h"                             // Per-read stats output
+#include "ProgressLog.h"                              // ProgressLog Class
+
+namespace Pipeline
+{
+    /** \enum StageType
+        \brief Processing stages, applied to every record in the order given.
+    */
+    enum StageType
+    {
+        QUALITY_FILTER,                        /**<"qc", as QualityControl. */
+        DEDUP,                                 /**<"dedup", as RemoveDuplicates --stream. */
+        READ_STATS,                            /**<"stats", as FastQStats. */
+        INTERSECT                              /**<"intersect", as FastQIntersect, pairs only. */
+    };
+
+    /**
+        \fn parseStages
+        \brief Parses a comma separated stage list, ex. "qc,dedup,stats".
+        @param list stage names
+        @param stages cleared, then filled with the stages in order
+        @return False if a name is unknown or repeated
+    */
+    bool parseStages( const std::string& list, std::vector<StageType>& stages );
+
+    /**
+        \fn getStageName
+        \brief Returns the name of a stage, as given in a stage list.
+        @param stage stage
+        @return Name
+    */
+    const char* getStageName( StageType stage );
+
+    /** \struct Batch
+        \brief Records flowing through the stages together, with their mates.
+        Stages drop records from the batch, the records left at the end are written.
+    */
+    struct Batch
+    {
+        std::vector<FastQ::FastQView> first;   /**<Records, or first mates. */
+        std::vector<FastQ::FastQView> second;  /**<Second mates, empty for single-end input. */
+        std::string stats_first;               /**<Per-read stats rows of first. */
+        std::string stats_second;              /**<Per-read stats rows of second. */
+
+        /** \fn clear \brief Empties the batch, keeping its capacity. */
+        void clear();
+
+        /**
+            \fn keep
+            \brief Drops the records not marked to keep, preserving order.
+            @param keep_record one flag per record
+        */
+        void keep( const std::vector<bool>& keep_record );
+    };
+
+    /** \class QualityFilter
+        \brief Keeps reads (pairs) with enough bases at or above a quality threshold.
+        Thread safe, so it runs on the parsing threads.
+    */
+    class QualityFilter
+    {
+        private:
+            int _phred_offset;                 /**<Quality encoding. */
+            int _min_quality;                  /**<Minimum base quality. */
+            float _proportion;                 /**<Proportion of bases that must pass. */
+            int _min_length;                   /**<Minimum read length. */
+            std::atomic<unsigned long long> _num_input;  /**<Records (pairs) seen. */
+            std::atomic<unsigned long long> _num_kept;   /**<Records (pairs) kept. */
+
+            bool passes( const FastQ::FastQView& record ) const;
+
+        public:
+            QualityFilter();
+
+            /**
+                \fn setSettings
+                \brief Sets the filter, as the QualityControl options.
+                @param phred_offset quality encoding, 33 or 64
+                @param min_quality minimum base quality (-q)
+                @param proportion proportion of bases at or above min_quality (-p)
+                @param min_length minimum read length (-l)
+            */
+            void setSettings( int phred_offset, int min_quality, float proportion, int min_length );
+
+            /** \fn apply \brief Drops the reads (pairs) that fail the filter. */
+            void apply( Batch& batch );
+
+            /**
+                \fn writeStats
+                \brief Writes the QualityControl stats file.
+                @param file_name stats file
+                @param paired write the QualityControlPairedEnd format
+                @return False if the file cannot be written
+            */
+            bool writeStats( const std::string& file_name, bool paired ) const;
+    };
+
+    /** \class Deduplicator
+        \brief Keeps the first read (pair) of each sequence, in input order.
+        Not thread safe, runs in file order on the calling thread.
+    */
+    class Deduplicator
+    {
+        private:
+            SeqHash::SeqHash _seen;            /**<Fingerprints of the sequences (mate pairs) kept. */
+            unsigned long long _num_input;     /**<Records (pairs) seen. */
+
+        public:
+            Deduplicator();
+
+            /** \fn apply \brief Drops the reads (pairs) whose sequence was kept before. */
+            void apply( Batch& batch );
+
+            /**
+                \fn writeStats
+                \brief Writes the RemoveDuplicates stats file.
+                @param file_name stats file
+                @return False if the file cannot be written
+            */
+            bool writeStats( const std::string& file_name ) const;
+    };
+
+    /** \class ReadStats
+        \brief Formats the length and GC content of every read, as FastQStats.
+        Thread safe, so it runs on the parsing threads when no dedup stage precedes it.
+    */
+    class ReadStats
+    {
+        public:
+            /**
+                \fn format
+                \brief Appends one FastQStats row per record.
+                @param records records
+                @param rows formatted rows
+            */
+            static void format( const std::vector<FastQ::FastQView>& records, std::string& rows );
+
+            /** \fn apply \brief Formats the stats rows of the batch, no read is dropped. */
+            void apply( Batch& batch );
+    };
+
+    /** \class Intersector
+        \brief Pairs first and second reads by read name, as FastQIntersect.
+        The second file is stored packed, then the first reads with a mate are
+        stored as they are streamed. The last read of a repeated name is kept
+        in either file, and pairs are returned in read name order, so the pairs
+        and their order are those FastQIntersect writes.
+    */
+    class Intersector
+    {
+        private:
+            typedef std::map<std::string_view, std::pair<PackedSeq::Ref, PackedSeq::Ref> > MateMap;
+
+            PackedSeq::PackedSeq _mates;       /**<Second reads. */
+            PackedSeq::PackedSeq _firsts;      /**<First reads that have a mate. */
+            MateMap _mate_ids;                 /**<Second read and first read, NULL until seen, by read name. */
+            MateMap::iterator _next_pair;      /**<Next pair returned by nextPair. */
+            std::string _first_buffer;         /**<Unpacked first read. */
+            std::string _mate_buffer;          /**<Unpacked mate. */
+            unsigned long long _num_first;     /**<First reads seen. */
+            unsigned long long _num_second;    /**<Second reads stored. */
+            unsigned long long _num_paired;    /**<Pairs found. */
+
+        public:
+            Intersector();
+
+            /**
+                \fn load
+                \brief Stores the second reads, the last read of a repeated read name is kept.
+                @param file_name second fastq file
+                @return False if the file cannot be read
+            */
+            bool load( const std::string& file_name );
+
+            /**
+                \fn addFirst
+                \brief Stores a first read if it has a mate, replacing an earlier read of the same name.
+                @param first first read
+            */
+            void addFirst( const FastQ::FastQView& first );
+
+            /**
+                \fn nextPair
+                \brief Returns the next pair in read name order, once every first read is added.
+                @param first set to the first read, valid until the next call
+                @param mate set to the mate, valid until the next call
+                @return False once every pair was returned
+            */
+            bool nextPair( FastQ::FastQView& first, FastQ::FastQView& mate );
+
+            /**
+                \fn writeStats
+                \brief Writes the FastQIntersect stats file.
+                @param file_name stats file
+                @return False if the file cannot be written
+            */
+            bool writeStats( const std::string& file_name ) const;
+    };
+
+    /** \class Pipeline
+        \brief Runs a list of stages over a single parse of the input.
+
+        Records are passed between stages as views, nothing is written between
+        stages. Single-end input is parsed in chunks on worker threads, which
+        also run the stages before the first dedup stage; the remaining stages
+        run in file order and the records left are written in input order. Each
+        stage writes the stats file of the module it replaces.
+    */
+    class Pipeline
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            std::vector<StageType> _stages;    /**<Stages in order. */
+            size_t _num_parallel;              /**<Leading stages run on worker threads. */
+            int _num_threads;                  /**<Number of parsing threads. */
+            QualityFilter _quality_filter;
+            Deduplicator _deduplicator;
+            ReadStats _read_stats;
+            Intersector _intersector;
+            OutputStream::OutputStream _stats_first;   /**<Per-read stats of first reads. */
+            OutputStream::OutputStream _stats_second;  /**<Per-read stats of second reads. */
+            ProgressLog::ProgressLog _progress_log;
+            unsigned long long _num_input;     /**<Records (pairs) read. */
+            unsigned long long _num_output;    /**<Records (pairs) written. */
+
+            bool hasStage( StageType stage ) const;
+            void applyStages( Batch& batch, size_t begin, size_t end );
+            bool runSingle( const std::string& input, const std::string& output );
+            bool runPaired( const std::string& input_first, const std::string& input_second,
+                            const std::string& output_first, const std::string& output_second );
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs the Pipeline object with no stages and one thread.
+            */
+            Pipeline();
+
+            /** \fn Destructor */
+            ~Pipeline();
+
+            /**
+                \fn setStages
+                \brief Sets the stages, an intersect stage must come first.
+                @param stages stages in order
+                @return False if the stage order is invalid
+            */
+            bool setStages( const std::vector<StageType>& stages );
+
+            /**
+                \fn setNumThreads
+                \brief Sets the number of parsing threads for single-end input.
+                @param num_threads number of threads
+            */
+            void setNumThreads( int num_threads );
+
+            /**
+                \fn getQualityFilter
+                \brief Returns the quality filter stage, to set its options.
+                @return Quality filter
+            */
+            QualityFilter& getQualityFilter();
+
+            /**
+                \fn run
+                \brief Runs the stages and writes the remaining records and every stats file.
+                Stats files are named stats_prefix.qc.stats, .dedup.stats, .intersect.stats
+                and .reads.tsv (.reads_1.tsv and .reads_2.tsv for pairs).
+                @param input_first fastq file, or first mates
+                @param input_second second mates, empty for single-end input
+                @param output_first output fastq file, or first mates
+                @param output_second second mates, empty for single-end input
+                @param stats_prefix prefix of the stats files
+                @return False after printing an error
+            */
+            bool run( const std::string& input_first, const std::string& input_second,
+                      const std::string& output_first, const std::string& output_second,
+                      const std::string& stats_prefix );
+
+            /**
+                \fn getNumInput
+                \brief Returns the number of records (pairs) read.
+                @return Records
+            */
+            unsigned long long getNumInput() const;
+
+            /**
+                \fn getNumOutput
+                \brief Returns the number of records (pairs) written.
+                @return Records
+            */
+            unsigned long long getNumOutput() const;
+
+    }; // class Pipeline
+
+} // namespace Pipeline
@@ -5,6 +5,7 @@
 
 #include <iostream>
 #include <map>                                        // Associative array
+#include <sys/stat.h>                                 // File size
 #include "ProgressLog.h"                              // Declaration File
 #include "TextColor.h"                                // Unix shell colored output
 #include "Utilities.h"                                // to_string compiler fix
@@ -16,6 +17,9 @@ namespace ProgressLog
     {
         _total_num_records = 0;
         _processed_num_records = 0;
+        _total_num_bytes = 0;
+        _processed_num_bytes = 0;
+        _percent_processed = 0;
         ProgressLog::initPercentBoolMap();
     }
 
@@ -39,6 +43,18 @@ namespace ProgressLog
         _total_num_records = total_records;
     }
 
+    bool ProgressLog::initLogBytes( const std::string& file_name )
+    {
+        struct stat file_stat;
+
+        if ( stat( file_name.c_str(), &file_stat ) != 0 )
+        {
+            return false;
+        }
+        _total_num_bytes = file_stat.st_size;
+        return true;
+    }
+
     void ProgressLog::initPercentBoolMap()
     {
         _percent_bool_map[0] = false;
@@ -62,6 +78,29 @@ namespace ProgressLog
         ProgressLog::updatePercentBoolMap();
     }
 
+    void ProgressLog::updateLogBytes( unsigned long long processed_bytes )
+    {
+        _processed_num_bytes = processed_bytes;
+
+        // Unknown size (ex. standard input), only completeLog reports progress
+        if ( _total_num_bytes == 0 )
+        {
+            return;
+        }
+        _percent_processed = ( _processed_num_bytes / double( _total_num_bytes ) ) * 100;
+        ProgressLog::updatePercentBoolMap();
+    }
+
+    void ProgressLog::completeLog( unsigned long long total_records )
+    {
+        _total_num_records = total_records;
+        _processed_num_records = total_records;
+        _percent_processed = 100;
+        ProgressLog::updatePercentBoolMap();
+        std::cout << "Processed " << Utilities::to_string( total_records ) << " sequences." <<
+                        std::endl;
+    }
+
     void ProgressLog::updatePercentBoolMap()
     {
         for ( int i = 0; i < 101; i += 10 )
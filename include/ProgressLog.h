@@ -16,8 +16,10 @@ namespace ProgressLog
     {
             //-------------------------------PRIVATE---------------------------------//
         private:
-            int _total_num_records;
-            int _processed_num_records;
+            unsigned long long _total_num_records;
+            unsigned long long _processed_num_records;
+            unsigned long long _total_num_bytes;      /**<File size for byte progress. */
+            unsigned long long _processed_num_bytes;  /**<Offset for byte progress. */
             int _percent_processed;
             TextColor::TextColor _palette;
 
@@ -42,10 +44,33 @@ namespace ProgressLog
 
             void initLog( int total_records );
 
+            /**
+                \fn initLogBytes
+                \brief Initializes a progress log measured in bytes of the input file.
+                Avoids a counting pass over the file before processing.
+                @param file_name input file, whose size is read with stat
+                @return False if the file size cannot be read
+            */
+            bool initLogBytes( const std::string& file_name );
+
             void printPercentBoolMap();
 
             void incrementLog( int processed_records );
 
+            /**
+                \fn updateLogBytes
+                \brief Updates a byte progress log with the current offset in the input file.
+                @param processed_bytes offset of the reader in the input file
+            */
+            void updateLogBytes( unsigned long long processed_bytes );
+
+            /**
+                \fn completeLog
+                \brief Completes the log and reports the exact number of records processed.
+                @param total_records number of records that were processed
+            */
+            void completeLog( unsigned long long total_records );
+
     }; // class ProgressLog
 
 
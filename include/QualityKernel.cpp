@@ -0,0 +1,300 @@
+/*! \file QualityKernel.cpp
+    QualityKernel Implementation.
+    \verbinclude QualityKernel.cpp
+*/
+
+#include <string_view>
+#include <atomic>
+#include <cmath>
+#include "QualityKernel.h"                            // Declaration File
+
+#if defined( __x86_64__ )
+#include <immintrin.h>                                // SSE2, AVX2 and AVX-512 intrinsics
+#endif
+
+namespace QualityKernel
+{
+    static std::atomic<int> forced_level( -1 );      // Level set by setLevel, -1 for best
+    static const int MAX_PHRED = 93;                  // Highest score in the error table
+
+    // Error probability of each Phred score, in units of 1 / ERROR_SCALE
+    struct ErrorTable
+    {
+        int32_t probabilities[MAX_PHRED + 1];
+
+        ErrorTable()
+        {
+            for ( int score = 0; score <= MAX_PHRED; score++ )
+            {
+                probabilities[score] = int32_t( std::llround( std::pow( 10.0, -score / 10.0 ) *
+                                                ERROR_SCALE ) );
+            }
+        }
+    };
+
+    static const ErrorTable ERROR_TABLE;
+
+    //-------------------------------Levels-------------------------------------//
+    void setLevel( LineScanner::Level level )
+    {
+        if ( LineScanner::isSupported( level ) )
+        {
+            forced_level = level;
+        }
+    }
+
+    LineScanner::Level getLevel()
+    {
+        int level = forced_level;
+        return level < 0 ? LineScanner::getBestLevel() : LineScanner::Level( level );
+    }
+
+    //-----------------------------Scalar Count---------------------------------//
+    // Characters are compared as signed chars, as the modules always did
+    static size_t countScalar( const char* quality, size_t size, size_t offset, int threshold )
+    {
+        size_t count = 0;
+
+        for ( ; offset < size; offset++ )
+        {
+            count += quality[offset] >= threshold;
+        }
+        return count;
+    }
+
+    //-----------------------------Vector Counts--------------------------------//
+#if defined( __x86_64__ )
+    // Passing lanes are -1, so subtracting the compare counts them per lane. A
+    // lane overflows after 255 blocks, so lanes are summed with sad every 255 blocks.
+    __attribute__( ( target( "sse2" ) ) )
+    static size_t countSSE2( const char* quality, size_t size, char bound )
+    {
+        const __m128i bounds = _mm_set1_epi8( bound );
+        const __m128i zero = _mm_setzero_si128();
+        size_t vector_end = size & ~size_t( 15 );
+        size_t block_end;
+        size_t offset = 0;
+        size_t count = 0;
+        __m128i lanes;
+
+        while ( offset < vector_end )
+        {
+            lanes = zero;
+            block_end = offset + 255 * 16 < vector_end ? offset + 255 * 16 : vector_end;
+            for ( ; offset < block_end; offset += 16 )
+            {
+                lanes = _mm_sub_epi8( lanes, _mm_cmpgt_epi8( _mm_loadu_si128(
+                                          ( const __m128i* )( quality + offset ) ), bounds ) );
+            }
+            lanes = _mm_sad_epu8( lanes, zero );
+            count += _mm_cvtsi128_si32( lanes ) + _mm_extract_epi16( lanes, 4 );
+        }
+        return count + countScalar( quality, size, offset, int( bound ) + 1 );
+    }
+
+    __attribute__( ( target( "avx2,popcnt" ) ) )
+    static size_t countAVX2( const char* quality, size_t size, char bound )
+    {
+        const __m256i bounds = _mm256_set1_epi8( bound );
+        const __m256i zero = _mm256_setzero_si256();
+        size_t vector_end = size & ~size_t( 31 );
+        size_t block_end;
+        size_t offset = 0;
+        size_t count = 0;
+        __m256i lanes;
+        __m128i sums;
+
+        while ( offset < vector_end )
+        {
+            lanes = zero;
+            block_end = offset + 255 * 32 < vector_end ? offset + 255 * 32 : vector_end;
+            for ( ; offset < block_end; offset += 32 )
+            {
+                lanes = _mm256_sub_epi8( lanes, _mm256_cmpgt_epi8( _mm256_loadu_si256(
+                                             ( const __m256i* )( quality + offset ) ), bounds ) );
+            }
+            lanes = _mm256_sad_epu8( lanes, zero );
+            sums = _mm_add_epi64( _mm256_castsi256_si128( lanes ), _mm256_extracti128_si256( lanes, 1 ) );
+            count += _mm_cvtsi128_si32( sums ) + _mm_extract_epi16( sums, 4 );
+        }
+
+        // Short reads spend much of their time in the tail, take 16 bytes first
+        if ( offset + 16 <= size )
+        {
+            count += __builtin_popcount( _mm_movemask_epi8( _mm_cmpgt_epi8( _mm_loadu_si128(
+                                             ( const __m128i* )( quality + offset ) ),
+                                         _mm256_castsi256_si128( bounds ) ) ) );
+            offset += 16;
+        }
+        return count + countScalar( quality, size, offset, int( bound ) + 1 );
+    }
+
+    __attribute__( ( target( "avx512f,avx512bw,popcnt" ) ) )
+    static size_t countAVX512( const char* quality, size_t size, char bound )
+    {
+        const __m512i bounds = _mm512_set1_epi8( bound );
+        size_t offset = 0;
+        size_t count = 0;
+
+        for ( ; offset + 64 <= size; offset += 64 )
+        {
+            count += __builtin_popcountll( _mm512_cmpgt_epi8_mask( _mm512_loadu_si512(
+                                               quality + offset ), bounds ) );
+        }
+
+        // The tail is one masked load instead of a scalar loop
+        if ( offset < size )
+        {
+            __mmask64 tail = ( __mmask64( 1 ) << ( size - offset ) ) - 1;
+            count += __builtin_popcountll( _mm512_mask_cmpgt_epi8_mask( tail,
+                                           _mm512_maskz_loadu_epi8( tail, quality + offset ), bounds ) );
+        }
+        return count;
+    }
+#endif
+
+    //-----------------------------Error Sums-----------------------------------//
+    // Characters are read as signed chars, as in the counts
+    static uint64_t sumErrorsScalar( const char* quality, size_t size, size_t offset,
+                                     int phred_offset )
+    {
+        uint64_t sum = 0;
+        int score;
+
+        for ( ; offset < size; offset++ )
+        {
+            score = quality[offset] - phred_offset;
+            score = score < 0 ? 0 : score > MAX_PHRED ? MAX_PHRED : score;
+            sum += ERROR_TABLE.probabilities[score];
+        }
+        return sum;
+    }
+
+#if defined( __x86_64__ )
+    // A lane holds at most 2^24 per base, so lanes are widened every 255 blocks
+    __attribute__( ( target( "avx2" ) ) )
+    static uint64_t sumErrorsAVX2( const char* quality, size_t size, int phred_offset )
+    {
+        const __m256i offsets = _mm256_set1_epi32( phred_offset );
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i max_scores = _mm256_set1_epi32( MAX_PHRED );
+        size_t vector_end = size & ~size_t( 7 );
+        size_t block_end;
+        size_t offset = 0;
+        __m256i lanes;
+        __m256i scores;
+        __m256i sums = zero;
+        uint64_t partial[4];
+
+        while ( offset < vector_end )
+        {
+            lanes = zero;
+            block_end = offset + 255 * 8 < vector_end ? offset + 255 * 8 : vector_end;
+            for ( ; offset < block_end; offset += 8 )
+            {
+                scores = _mm256_cvtepi8_epi32( _mm_loadl_epi64( ( const __m128i* )( quality + offset ) ) );
+                scores = _mm256_min_epi32( _mm256_max_epi32( _mm256_sub_epi32( scores, offsets ), zero ),
+                                           max_scores );
+                lanes = _mm256_add_epi32( lanes, _mm256_i32gather_epi32( ERROR_TABLE.probabilities,
+                                          scores, 4 ) );
+            }
+            sums = _mm256_add_epi64( sums, _mm256_cvtepu32_epi64( _mm256_castsi256_si128( lanes ) ) );
+            sums = _mm256_add_epi64( sums, _mm256_cvtepu32_epi64( _mm256_extracti128_si256( lanes, 1 ) ) );
+        }
+        _mm256_storeu_si256( ( __m256i* )partial, sums );
+        return partial[0] + partial[1] + partial[2] + partial[3] +
+               sumErrorsScalar( quality, size, offset, phred_offset );
+    }
+
+    // The masked forms avoid the undefined vectors of the unmasked intrinsics
+    __attribute__( ( target( "avx512f,avx512bw" ) ) )
+    static uint64_t sumErrorsAVX512( const char* quality, size_t size, int phred_offset )
+    {
+        const __m512i offsets = _mm512_set1_epi32( phred_offset );
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i max_scores = _mm512_set1_epi32( MAX_PHRED );
+        const __m512i low_halves = _mm512_set1_epi64( 0xffffffff );
+        const __mmask16 all_lanes = 0xffff;
+        size_t vector_end = size & ~size_t( 15 );
+        size_t block_end;
+        size_t offset = 0;
+        __m512i lanes;
+        __m512i scores;
+        __m512i sums = zero;
+        uint64_t partial[8];
+        uint64_t sum = 0;
+
+        while ( offset < vector_end )
+        {
+            lanes = zero;
+            block_end = offset + 255 * 16 < vector_end ? offset + 255 * 16 : vector_end;
+            for ( ; offset < block_end; offset += 16 )
+            {
+                scores = _mm512_maskz_cvtepi8_epi32( all_lanes, _mm_loadu_si128(
+                                                         ( const __m128i* )( quality + offset ) ) );
+                scores = _mm512_maskz_min_epi32( all_lanes, _mm512_maskz_max_epi32( all_lanes,
+                                                 _mm512_sub_epi32( scores, offsets ), zero ), max_scores );
+                lanes = _mm512_add_epi32( lanes, _mm512_mask_i32gather_epi32( zero, all_lanes, scores,
+                                          ERROR_TABLE.probabilities, 4 ) );
+            }
+            // Even and odd lanes widened in place, without extracts
+            sums = _mm512_add_epi64( sums, _mm512_and_si512( lanes, low_halves ) );
+            sums = _mm512_add_epi64( sums, _mm512_maskz_srli_epi64( 0xff, lanes, 32 ) );
+        }
+        _mm512_storeu_si512( partial, sums );
+        for ( int i = 0; i < 8; i++ )
+        {
+            sum += partial[i];
+        }
+        return sum + sumErrorsScalar( quality, size, offset, phred_offset );
+    }
+#endif
+
+    //-------------------------------Dispatch-----------------------------------//
+    size_t countAboveThreshold( std::string_view quality, int threshold )
+    {
+        char bound;
+
+        // Thresholds outside the char range pass every base or none
+        if ( threshold <= -128 )
+        {
+            return quality.size();
+        }
+        if ( threshold > 127 )
+        {
+            return 0;
+        }
+        bound = char( threshold - 1 );
+
+        switch ( getLevel() )
+        {
+#if defined( __x86_64__ )
+            case LineScanner::AVX512:
+                return countAVX512( quality.data(), quality.size(), bound );
+            case LineScanner::AVX2:
+                return countAVX2( quality.data(), quality.size(), bound );
+            case LineScanner::SSE2:
+                return countSSE2( quality.data(), quality.size(), bound );
+#endif
+            default:
+                return countScalar( quality.data(), quality.size(), 0, threshold );
+        }
+    }
+
+    // SSE2 has no gather, it sums with the scalar loop
+    uint64_t sumErrorProbabilities( std::string_view quality, int phred_offset )
+    {
+        switch ( getLevel() )
+        {
+#if defined( __x86_64__ )
+            case LineScanner::AVX512:
+                return sumErrorsAVX512( quality.data(), quality.size(), phred_offset );
+            case LineScanner::AVX2:
+                return sumErrorsAVX2( quality.data(), quality.size(), phred_offset );
+#endif
+            default:
+                return sumErrorsScalar( quality.data(), quality.size(), 0, phred_offset );
+        }
+    }
+
+} // namespace QualityKernel
@@ -0,0 +1,58 @@
+/*! \file QualityKernel.h
+    QualityKernel Declaration.
+    \verbinclude QualityKernel.h
+*/
+
+#pragma once
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include "LineScanner.h"                              // Instruction set levels
+
+namespace QualityKernel
+{
+    /** Units of sumErrorProbabilities per expected error, 2^24 */
+    const uint64_t ERROR_SCALE = 1 << 24;
+
+    /**
+        \fn setLevel
+        \brief Forces the instruction set used by countAboveThreshold, for benchmarks and tests.
+        Levels the CPU does not support are ignored.
+        @param level instruction set
+    */
+    void setLevel( LineScanner::Level level );
+
+    /**
+        \fn getLevel
+        \brief Returns the instruction set used by countAboveThreshold.
+        @return Level, the best supported one unless setLevel was called
+    */
+    LineScanner::Level getLevel();
+
+    /**
+        \fn countAboveThreshold
+        \brief Counts the quality characters at or above a threshold in one vectorized sweep.
+
+        A base passes a quality filter when quality - phred_offset >= min_quality,
+        that is when its character is at least phred_offset + min_quality.
+        @param quality quality line of a read
+        @param threshold lowest passing character, ex. 33 + 20 for Phred 20 in Phred+33
+        @return Number of passing bases
+    */
+    size_t countAboveThreshold( std::string_view quality, int threshold );
+
+    /**
+        \fn sumErrorProbabilities
+        \brief Sums the error probability 10^(-Q/10) of every base, a read's expected errors.
+
+        Probabilities come from a table of Phred 0 to 93 in fixed point, looked
+        up with AVX2 or AVX-512 gathers, so sums are exact integers and the same
+        at every instruction set. Scores below 0 count as 0, above 93 as 93.
+        @param quality quality line of a read
+        @param phred_offset quality encoding, 33 or 64
+        @return Expected errors in units of 1 / ERROR_SCALE
+    */
+    uint64_t sumErrorProbabilities( std::string_view quality, int phred_offset );
+
+} // namespace QualityKernel
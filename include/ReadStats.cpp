@@ -0,0 +1,372 @@
+/*! \file ReadStats.cpp
+    ReadStats Class Implementation.
+    \verbinclude ReadStats.cpp
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include "ReadStats.h"                                // Declaration File
+#include "SeqHash.h"                                  // Sequence fingerprints
+
+namespace ReadStats
+{
+    // Column of a base in the base counts, 4 for a base other than ACGT
+    static const struct CodeTable
+    {
+        uint8_t codes[256];
+
+        CodeTable()
+        {
+            for ( int i = 0; i < 256; i++ )
+            {
+                codes[i] = 4;
+            }
+            codes['A'] = codes['a'] = 0;
+            codes['C'] = codes['c'] = 1;
+            codes['G'] = codes['g'] = 2;
+            codes['T'] = codes['t'] = 3;
+        }
+    } CODE_TABLE;
+
+    // Lower bounds of the duplication levels, as in FastQC
+    static const uint64_t DUPLICATION_LEVELS[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 50, 100, 500, 1000, 5000, 10000 };
+    static const int NUM_DUPLICATION_LEVELS = sizeof( DUPLICATION_LEVELS ) / sizeof( DUPLICATION_LEVELS[0] );
+
+    static inline double getPercent( uint64_t count, uint64_t total )
+    {
+        return total == 0 ? 0 : count * 100.0 / total;
+    }
+
+    // Nearest-rank percentile of the scores of a position, from its histogram:
+    // the smallest score at or above percent of the scores
+    static int getPercentile( const uint64_t* counts, uint64_t total, int percent )
+    {
+        uint64_t rank = ( total * percent + 99 ) / 100 - 1;
+        uint64_t seen = 0;
+
+        for ( int quality = 0; quality < ReadStats::NUM_QUALITIES; quality++ )
+        {
+            seen += counts[quality];
+            if ( seen > rank )
+            {
+                return quality;
+            }
+        }
+        return ReadStats::NUM_QUALITIES - 1;
+    }
+
+    //------------------------------Constructor---------------------------------//
+    ReadStats::ReadStats( int phred_offset )
+    {
+        _phred_offset = phred_offset;
+        _num_reads = 0;
+        _num_bases = 0;
+        _num_gc_bases = 0;
+        _min_length = 0;
+        _max_length = 0;
+        _gc_counts.resize( 101, 0 );
+        _mean_quality_counts.resize( NUM_QUALITIES, 0 );
+        _sample_threshold = ~( uint64_t )0;
+        _max_sampled = MAX_SAMPLED;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    ReadStats::~ReadStats()
+    {
+
+    }
+
+    void ReadStats::setMaxSampled( size_t max_sampled )
+    {
+        _max_sampled = std::max<size_t>( 1, max_sampled );
+    }
+
+    //-------------------------------Counting-----------------------------------//
+    void ReadStats::growPositions( size_t length )
+    {
+        _quality_counts.resize( length * NUM_QUALITIES, 0 );
+        _base_counts.resize( length * NUM_BASES, 0 );
+        _length_counts.resize( length + 1, 0 );
+    }
+
+    void ReadStats::shrinkSample()
+    {
+        // Halving keeps the thresholds of every accumulator on the same
+        // sequence, so merged samples end at the same threshold
+        while ( _sampled_counts.size() > _max_sampled )
+        {
+            _sample_threshold >>= 1;
+            for ( auto it = _sampled_counts.begin(); it != _sampled_counts.end(); )
+            {
+                it = it->first > _sample_threshold ? _sampled_counts.erase( it ) : std::next( it );
+            }
+        }
+    }
+
+    void ReadStats::add( const FastQ::FastQView& record )
+    {
+        size_t length = record.sequence.size();
+        size_t num_qualities = std::min( length, record.quality.size() );
+        uint64_t* quality_counts;
+        uint64_t* base_counts;
+        uint64_t quality_sum = 0;
+        uint64_t gc = 0;
+        uint64_t fingerprint;
+        int quality;
+
+        if ( length >= _length_counts.size() )
+        {
+            ReadStats::growPositions( length );
+        }
+        _min_length = _num_reads == 0 ? length : std::min( _min_length, length );
+        _max_length = std::max( _max_length, length );
+        _num_reads++;
+        _num_bases += length;
+        _length_counts[length]++;
+
+        base_counts = _base_counts.data();
+        for ( size_t i = 0; i < length; i++, base_counts += NUM_BASES )
+        {
+            uint8_t code = CODE_TABLE.codes[( uint8_t )record.sequence[i]];
+
+            base_counts[code]++;
+            gc += code == 1 || code == 2;
+        }
+        quality_counts = _quality_counts.data();
+        for ( size_t i = 0; i < num_qualities; i++, quality_counts += NUM_QUALITIES )
+        {
+            quality = std::clamp( ( int )( uint8_t )record.quality[i] - _phred_offset, 0, NUM_QUALITIES - 1 );
+            quality_counts[quality]++;
+            quality_sum += quality;
+        }
+        _num_gc_bases += gc;
+
+        if ( length > 0 )
+        {
+            _gc_counts[( gc * 100 + length / 2 ) / length]++;
+            _mean_quality_counts[num_qualities == 0 ? 0 : quality_sum / num_qualities]++;
+        }
+
+        fingerprint = SeqHash::hashSequence( record.sequence ).high;
+        if ( fingerprint <= _sample_threshold )
+        {
+            _sampled_counts[fingerprint]++;
+            ReadStats::shrinkSample();
+        }
+    }
+
+    //--------------------------------Merging-----------------------------------//
+    void ReadStats::merge( const ReadStats& other )
+    {
+        if ( other._num_reads == 0 )
+        {
+            return;
+        }
+        if ( other._length_counts.size() > _length_counts.size() )
+        {
+            ReadStats::growPositions( other._length_counts.size() - 1 );
+        }
+        _min_length = _num_reads == 0 ? other._min_length : std::min( _min_length, other._min_length );
+        _max_length = std::max( _max_length, other._max_length );
+        _num_reads += other._num_reads;
+        _num_bases += other._num_bases;
+        _num_gc_bases += other._num_gc_bases;
+
+        for ( size_t i = 0; i < other._quality_counts.size(); i++ )
+        {
+            _quality_counts[i] += other._quality_counts[i];
+        }
+        for ( size_t i = 0; i < other._base_counts.size(); i++ )
+        {
+            _base_counts[i] += other._base_counts[i];
+        }
+        for ( size_t i = 0; i < other._length_counts.size(); i++ )
+        {
+            _length_counts[i] += other._length_counts[i];
+        }
+        for ( size_t i = 0; i < _gc_counts.size(); i++ )
+        {
+            _gc_counts[i] += other._gc_counts[i];
+        }
+        for ( size_t i = 0; i < _mean_quality_counts.size(); i++ )
+        {
+            _mean_quality_counts[i] += other._mean_quality_counts[i];
+        }
+
+        // Both samples are cut to the lower threshold before they are added
+        _sample_threshold = std::min( _sample_threshold, other._sample_threshold );
+        for ( auto it = _sampled_counts.begin(); it != _sampled_counts.end(); )
+        {
+            it = it->first > _sample_threshold ? _sampled_counts.erase( it ) : std::next( it );
+        }
+        for ( const auto& sampled : other._sampled_counts )
+        {
+            if ( sampled.first <= _sample_threshold )
+            {
+                _sampled_counts[sampled.first] += sampled.second;
+            }
+        }
+        ReadStats::shrinkSample();
+    }
+
+    //-------------------------------Reporting----------------------------------//
+    std::string ReadStats::getQualityReport() const
+    {
+        std::ostringstream report;
+        const uint64_t* counts;
+        uint64_t total;
+        uint64_t sum;
+
+        report << std::fixed << std::setprecision( 2 );
+        report << ">>Per base sequence quality\n";
+        report << "#Base\tMean\tMedian\tLower Quartile\tUpper Quartile\t10th Percentile\t90th Percentile\n";
+        for ( size_t position = 0; position < _max_length; position++ )
+        {
+            counts = _quality_counts.data() + position * NUM_QUALITIES;
+            total = 0;
+            sum = 0;
+            for ( int quality = 0; quality < NUM_QUALITIES; quality++ )
+            {
+                total += counts[quality];
+                sum += counts[quality] * quality;
+            }
+            if ( total == 0 )
+            {
+                continue;
+            }
+            report << position + 1 << '\t' << sum / ( double )total << '\t' << getPercentile( counts, total, 50 ) <<
+                   '\t' << getPercentile( counts, total, 25 ) << '\t' << getPercentile( counts, total, 75 ) <<
+                   '\t' << getPercentile( counts, total, 10 ) << '\t' << getPercentile( counts, total, 90 ) << '\n';
+        }
+        report << ">>END_MODULE\n";
+
+        report << ">>Per sequence quality scores\n";
+        report << "#Quality\tCount\n";
+        for ( int quality = 0; quality < NUM_QUALITIES; quality++ )
+        {
+            if ( _mean_quality_counts[quality] != 0 )
+            {
+                report << quality << '\t' << _mean_quality_counts[quality] << '\n';
+            }
+        }
+        report << ">>END_MODULE\n";
+        return report.str();
+    }
+
+    std::string ReadStats::getContentReport() const
+    {
+        std::ostringstream report;
+        const uint64_t* counts;
+        uint64_t total;
+
+        report << std::fixed << std::setprecision( 2 );
+        report << ">>Per base sequence content\n";
+        report << "#Base\tG\tA\tT\tC\n";
+        for ( size_t position = 0; position < _max_length; position++ )
+        {
+            counts = _base_counts.data() + position * NUM_BASES;
+            total = counts[0] + counts[1] + counts[2] + counts[3];
+            report << position + 1 << '\t' << getPercent( counts[2], total ) << '\t' <<
+                   getPercent( counts[0], total ) << '\t' << getPercent( counts[3], total ) << '\t' <<
+                   getPercent( counts[1], total ) << '\n';
+        }
+        report << ">>END_MODULE\n";
+
+        report << ">>Per sequence GC content\n";
+        report << "#GC Content\tCount\n";
+        for ( size_t percent = 0; percent < _gc_counts.size(); percent++ )
+        {
+            report << percent << '\t' << _gc_counts[percent] << '\n';
+        }
+        report << ">>END_MODULE\n";
+
+        report << ">>Per base N content\n";
+        report << "#Base\tN-Count\n";
+        for ( size_t position = 0; position < _max_length; position++ )
+        {
+            counts = _base_counts.data() + position * NUM_BASES;
+            total = counts[0] + counts[1] + counts[2] + counts[3] + counts[4];
+            report << position + 1 << '\t' << getPercent( counts[4], total ) << '\n';
+        }
+        report << ">>END_MODULE\n";
+
+        report << ">>Sequence Length Distribution\n";
+        report << "#Length\tCount\n";
+        for ( size_t length = _min_length; length <= _max_length && length < _length_counts.size(); length++ )
+        {
+            if ( _length_counts[length] != 0 )
+            {
+                report << length << '\t' << _length_counts[length] << '\n';
+            }
+        }
+        report << ">>END_MODULE\n";
+        return report.str();
+    }
+
+    std::string ReadStats::getDuplicationReport() const
+    {
+        std::ostringstream report;
+        uint64_t distinct_counts[NUM_DUPLICATION_LEVELS] = { 0 };
+        uint64_t read_counts[NUM_DUPLICATION_LEVELS] = { 0 };
+        uint64_t num_sampled_reads = 0;
+        int level;
+
+        for ( const auto& sampled : _sampled_counts )
+        {
+            level = std::upper_bound( DUPLICATION_LEVELS, DUPLICATION_LEVELS + NUM_DUPLICATION_LEVELS,
+                                      sampled.second ) - DUPLICATION_LEVELS - 1;
+            distinct_counts[level]++;
+            read_counts[level] += sampled.second;
+            num_sampled_reads += sampled.second;
+        }
+
+        report << std::fixed << std::setprecision( 2 );
+        report << ">>Sequence Duplication Levels\n";
+        report << "#Total Deduplicated Percentage\t" << getPercent( _sampled_counts.size(),
+                num_sampled_reads ) << '\n';
+        report << "#Duplication Level\tPercentage of deduplicated\tPercentage of total\n";
+        for ( level = 0; level < NUM_DUPLICATION_LEVELS; level++ )
+        {
+            if ( level >= 9 )
+            {
+                report << '>';
+            }
+            report << DUPLICATION_LEVELS[level] << '\t' << getPercent( distinct_counts[level],
+                    _sampled_counts.size() ) << '\t' << getPercent( read_counts[level], num_sampled_reads ) << '\n';
+        }
+        report << ">>END_MODULE\n";
+        return report.str();
+    }
+
+    std::string ReadStats::getReport( const std::string& file_name ) const
+    {
+        std::ostringstream report;
+
+        report << "##NGSX FastQStats\n";
+        report << ">>Basic Statistics\n";
+        report << "#Measure\tValue\n";
+        report << "Filename\t" << file_name << '\n';
+        report << "Encoding\tPhred+" << _phred_offset << '\n';
+        report << "Total Sequences\t" << _num_reads << '\n';
+        report << "Total Bases\t" << _num_bases << '\n';
+        report << "Sequence length\t" << _min_length;
+        if ( _max_length != _min_length )
+        {
+            report << '-' << _max_length;
+        }
+        report << '\n';
+        report << "%GC\t" << ( _num_bases == 0 ? 0 : ( _num_gc_bases * 100 + _num_bases / 2 ) / _num_bases ) << '\n';
+        report << ">>END_MODULE\n";
+
+        return report.str() + ReadStats::getQualityReport() + ReadStats::getContentReport() +
+               ReadStats::getDuplicationReport();
+    }
+
+    //------------------------------Attributes----------------------------------//
+    unsigned long long ReadStats::getNumReads() const
+    {
+        return _num_reads;
+    }
+
+} // namespace ReadStats
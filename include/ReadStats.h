@@ -0,0 +1,114 @@
+/*! \file ReadStats.h
+    ReadStats Class Declaration.
+    \verbinclude ReadStats.h
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "FastQ.h"                                    // FastQView
+
+namespace ReadStats
+{
+    /** \class ReadStats
+        \brief Accumulates FastQC-style aggregate statistics of fastq records in one pass.
+
+        Keeps per-position quality and base counts, and histograms of read
+        length, GC content and mean quality, in flat arrays of counts that
+        grow with the longest read. Accumulators filled on separate threads
+        are combined with merge, which adds the counts, so the report does
+        not depend on how the records were split.
+
+        Duplication levels are estimated from the sequences whose fingerprint
+        is at most a sampling threshold, every copy of a sampled sequence is
+        counted. When more than the maximum number of distinct sequences are
+        sampled the threshold is halved, dropping the sequences above it. The
+        sample ends at the largest threshold that holds the distinct
+        sequences below it, whichever accumulators saw them.
+    */
+    class ReadStats
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            int _phred_offset;
+            unsigned long long _num_reads;
+            unsigned long long _num_bases;
+            unsigned long long _num_gc_bases;
+            size_t _min_length;
+            size_t _max_length;
+            std::vector<uint64_t> _quality_counts;       /**<Reads by position and Phred score. */
+            std::vector<uint64_t> _base_counts;          /**<Reads by position and base, A C G T N. */
+            std::vector<uint64_t> _length_counts;        /**<Reads by length. */
+            std::vector<uint64_t> _gc_counts;            /**<Reads by GC percent, 0 to 100. */
+            std::vector<uint64_t> _mean_quality_counts;  /**<Reads by mean Phred score. */
+            std::unordered_map<uint64_t, uint64_t> _sampled_counts;  /**<Copies of each sampled sequence. */
+            uint64_t _sample_threshold;                  /**<Largest sampled fingerprint. */
+            size_t _max_sampled;                         /**<Distinct sequences sampled before halving. */
+
+            void growPositions( size_t length );
+            void shrinkSample();
+            std::string getQualityReport() const;
+            std::string getContentReport() const;
+            std::string getDuplicationReport() const;
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            static const int NUM_QUALITIES = 94;         /**<Phred 0 to 93, other scores are clamped. */
+            static const int NUM_BASES = 5;
+            static const size_t MAX_SAMPLED = 1 << 17;
+
+            /**
+                \fn Constructor
+                \brief Constructs an empty ReadStats.
+                @param phred_offset quality encoding, 33 or 64
+            */
+            ReadStats( int phred_offset = 33 );
+
+            /** \fn Destructor */
+            ~ReadStats();
+
+            /**
+                \fn setMaxSampled
+                \brief Sets the distinct sequences sampled for duplication levels, before any add.
+                Accumulators that are merged must use the same value.
+                @param max_sampled distinct sequences
+            */
+            void setMaxSampled( size_t max_sampled );
+
+            /**
+                \fn add
+                \brief Counts a record.
+                @param record record view
+            */
+            void add( const FastQ::FastQView& record );
+
+            /**
+                \fn merge
+                \brief Adds the counts of another accumulator with the same encoding.
+                @param other accumulator, left unchanged
+            */
+            void merge( const ReadStats& other );
+
+            /**
+                \fn getReport
+                \brief Formats the statistics as FastQC style ">>" modules of tab separated tables.
+                @param file_name input file named in the basic statistics
+                @return Report
+            */
+            std::string getReport( const std::string& file_name ) const;
+
+            /**
+                \fn getNumReads
+                \brief Returns the number of records counted.
+                @return Records
+            */
+            unsigned long long getNumReads() const;
+
+    }; // class ReadStats
+
+} // namespace ReadStats
@@ -0,0 +1,169 @@
+/*! \file RecordIndex.cpp
+    RecordIndex Class Implementation.
+    \verbinclude RecordIndex.cpp
+*/
+
+#include <cstring>                                    // memchr
+#include "RecordIndex.h"                              // Declaration File
+#include "SeqHash.h"                                  // Read name hashes
+
+namespace RecordIndex
+{
+    // Offset past the line starting at offset, its newline included
+    static inline uint64_t skipLine( const char* data, size_t size, uint64_t offset )
+    {
+        const char* newline = static_cast<const char*>( memchr( data + offset, '\n', size - offset ) );
+
+        return newline == NULL ? size : newline - data + 1;
+    }
+
+    // The high bits pick the home slot of any table size, as in SeqHash
+    static inline size_t findHomeSlot( uint64_t fingerprint, size_t num_slots )
+    {
+        return ( unsigned __int128 )fingerprint * num_slots >> 64;
+    }
+
+    void readRecordAt( const char* data, size_t size, uint64_t offset, FastQReader::FastQReader& reader,
+                       FastQ::FastQView& record )
+    {
+        uint64_t end = offset;
+
+        // Only the four lines of the record are handed to the reader, so it
+        // does not scan ahead
+        for ( int line = 0; line < 4 && end < size; line++ )
+        {
+            end = skipLine( data, size, end );
+        }
+        reader.openBuffer( data + offset, end - offset );
+        reader.nextRecord( record );
+    }
+
+    //------------------------------Constructor---------------------------------//
+    RecordIndex::RecordIndex()
+    {
+        _data = NULL;
+        _file_size = 0;
+        _size = 0;
+        _max_size = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    RecordIndex::~RecordIndex()
+    {
+
+    }
+
+    void RecordIndex::setData( const char* data, size_t size )
+    {
+        _data = data;
+        _file_size = size;
+    }
+
+    //--------------------------------Probing-----------------------------------//
+    size_t RecordIndex::findSlot( std::string_view name, uint64_t fingerprint )
+    {
+        size_t slot;
+
+        for ( slot = findHomeSlot( fingerprint, _slots.size() ); _slots[slot].fingerprint != 0;
+                        slot = slot + 1 == _slots.size() ? 0 : slot + 1 )
+        {
+            // Equal fingerprints are checked against the name in the file
+            if ( _slots[slot].fingerprint == fingerprint &&
+                            FastQ::getReadName( RecordIndex::getId( slot ) ) == name )
+            {
+                return slot;
+            }
+        }
+        return slot;
+    }
+
+    void RecordIndex::grow()
+    {
+        std::vector<Slot> old_slots;
+        size_t slot;
+
+        old_slots.swap( _slots );
+        _slots.resize( old_slots.empty() ? 1024 : old_slots.size() + old_slots.size() / 2, Slot() );
+        _max_size = _slots.size() / 5 * 4;
+
+        for ( size_t i = 0; i < old_slots.size(); i++ )
+        {
+            if ( old_slots[i].fingerprint == 0 )
+            {
+                continue;
+            }
+            for ( slot = findHomeSlot( old_slots[i].fingerprint, _slots.size() ); _slots[slot].fingerprint != 0;
+                            slot = slot + 1 == _slots.size() ? 0 : slot + 1 );
+            _slots[slot] = old_slots[i];
+        }
+    }
+
+    //-------------------------------Inserting----------------------------------//
+    void RecordIndex::insert( const FastQ::FastQView& record )
+    {
+        std::string_view name = FastQ::getReadName( record.id );
+        uint64_t fingerprint = SeqHash::hashSequence( name ).high | 1;
+        size_t slot;
+
+        if ( _size == _max_size )
+        {
+            RecordIndex::grow();
+        }
+        slot = RecordIndex::findSlot( name, fingerprint );
+        if ( _slots[slot].fingerprint == 0 )
+        {
+            _slots[slot].fingerprint = fingerprint;
+            _size++;
+        }
+        _slots[slot].offset = record.id.data() - _data;
+    }
+
+    //-------------------------------Searching----------------------------------//
+    size_t RecordIndex::find( std::string_view id )
+    {
+        std::string_view name = FastQ::getReadName( id );
+        size_t slot;
+
+        if ( _size == 0 )
+        {
+            return NOT_FOUND;
+        }
+        slot = RecordIndex::findSlot( name, SeqHash::hashSequence( name ).high | 1 );
+        return _slots[slot].fingerprint == 0 ? NOT_FOUND : slot;
+    }
+
+    std::string_view RecordIndex::getId( size_t slot ) const
+    {
+        uint64_t offset = _slots[slot].offset;
+        uint64_t end = skipLine( _data, _file_size, offset );
+
+        // Without the newline, which the last line of a file may lack
+        if ( end > offset && _data[end - 1] == '\n' )
+        {
+            end--;
+        }
+        return std::string_view( _data + offset, end - offset );
+    }
+
+    void RecordIndex::getRecord( size_t slot, FastQ::FastQView& record )
+    {
+        readRecordAt( _data, _file_size, _slots[slot].offset, _record_reader, record );
+    }
+
+    //------------------------------Attributes----------------------------------//
+    size_t RecordIndex::getNumSlots() const
+    {
+        return _slots.size();
+    }
+
+    size_t RecordIndex::size() const
+    {
+        return _size;
+    }
+
+    size_t RecordIndex::getMemoryUsage() const
+    {
+        return _slots.capacity() * sizeof( Slot );
+    }
+
+} // namespace RecordIndex
@@ -0,0 +1,138 @@
+/*! \file RecordIndex.h
+    RecordIndex Class Declaration.
+    \verbinclude RecordIndex.h
+*/
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "FastQ.h"                                    // FastQView
+#include "FastQReader.h"                              // Records parsed again from their offset
+
+namespace RecordIndex
+{
+    /**
+        \fn readRecordAt
+        \brief Parses the record starting at an offset of a fastq file in memory.
+        @param data start of the file, ex. FastQReader::getData of a mapped file
+        @param size size of the file
+        @param offset offset of the record's id line
+        @param reader reader reused for each record
+        @param record set to the record
+    */
+    void readRecordAt( const char* data, size_t size, uint64_t offset, FastQReader::FastQReader& reader,
+                       FastQ::FastQView& record );
+
+    /** \class RecordIndex
+        \brief Open-addressing index from read name to the record's offset in a mapped fastq file.
+
+        Records are keyed by FastQ::getReadName of their id, so both mates of
+        a pair find each other. Each 16 byte slot holds the high half of the
+        MurmurHash3 of a read name and the offset of its record, so the records
+        themselves stay in the file, which pages them in again when they are
+        read back. Equal fingerprints are verified against the name in the
+        file. A name seen again moves to its latest record. Slots are probed
+        linearly and the table grows by half when it is 80% full.
+    */
+    class RecordIndex
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \struct Slot
+                \brief An indexed record, empty while fingerprint is 0.
+            */
+            struct Slot
+            {
+                uint64_t fingerprint;          /**<High half of the name hash, never 0 when used. */
+                uint64_t offset;               /**<Offset of the record in the file. */
+            };
+
+            const char* _data;                 /**<Start of the indexed file. */
+            size_t _file_size;                 /**<Size of the indexed file. */
+            std::vector<Slot> _slots;          /**<Table, any size, never full. */
+            size_t _size;                      /**<Used slots. */
+            size_t _max_size;                  /**<Used slots before the table grows. */
+            FastQReader::FastQReader _record_reader;  /**<Parses records read back. */
+
+            size_t findSlot( std::string_view name, uint64_t fingerprint );
+            void grow();
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            static const size_t NOT_FOUND = ~( size_t )0;
+
+            /**
+                \fn Constructor
+                \brief Constructs an empty RecordIndex, no slot is allocated until the first insert.
+            */
+            RecordIndex();
+
+            /** \fn Destructor */
+            ~RecordIndex();
+
+            /**
+                \fn setData
+                \brief Sets the mapped file whose records are indexed, before any insert.
+                @param data start of the file, FastQReader::getData
+                @param size size of the file, FastQReader::getSize
+            */
+            void setData( const char* data, size_t size );
+
+            /**
+                \fn insert
+                \brief Indexes a record of the file, or moves its read name to this record.
+                @param record view into the file
+            */
+            void insert( const FastQ::FastQView& record );
+
+            /**
+                \fn find
+                \brief Looks up the read name of an id.
+                @param id id line, as FastQView::id, or a read name
+                @return Slot of the read name, NOT_FOUND if it is not indexed
+            */
+            size_t find( std::string_view id );
+
+            /**
+                \fn getId
+                \brief Returns the id line of the record in a slot, viewing the file.
+                @param slot slot returned by find
+                @return Id
+            */
+            std::string_view getId( size_t slot ) const;
+
+            /**
+                \fn getRecord
+                \brief Parses the record in a slot again, viewing the file.
+                @param slot slot returned by find
+                @param record set to the record
+            */
+            void getRecord( size_t slot, FastQ::FastQView& record );
+
+            /**
+                \fn getNumSlots
+                \brief Returns the number of slots, an upper bound of find results.
+                @return Slots
+            */
+            size_t getNumSlots() const;
+
+            /**
+                \fn size
+                \brief Returns the number of indexed read names.
+                @return Read names
+            */
+            size_t size() const;
+
+            /**
+                \fn getMemoryUsage
+                \brief Returns the bytes used by the table.
+                @return Bytes
+            */
+            size_t getMemoryUsage() const;
+
+    }; // class RecordIndex
+
+} // namespace RecordIndex
@@ -0,0 +1,351 @@
+/*! \file SeqHash.cpp
+    SeqHash Class Implementation.
+    \verbinclude SeqHash.cpp
+*/
+
+#include <cstring>
+#include <utility>                                    // swap
+#include "SeqHash.h"                                  // Declaration File
+
+namespace SeqHash
+{
+    //--------------------------------Hashing-----------------------------------//
+    static inline uint64_t rotateLeft( uint64_t x, int bits )
+    {
+        return ( x << bits ) | ( x >> ( 64 - bits ) );
+    }
+
+    static inline uint64_t finalMix( uint64_t k )
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // MurmurHash3 with both 64-bit halves seeded, the reference seeds them with the same 32 bits
+    static Hash128 hashWithSeed( std::string_view sequence, uint64_t h1, uint64_t h2 )
+    {
+        const uint64_t c1 = 0x87c37b91114253d5ULL;
+        const uint64_t c2 = 0x4cf5ad432745937fULL;
+        const char* data = sequence.data();
+        size_t length = sequence.size();
+        size_t num_blocks = length / 16;
+        uint64_t k1;
+        uint64_t k2;
+        char tail[16];
+        Hash128 hash;
+
+        for ( size_t i = 0; i < num_blocks; i++ )
+        {
+            memcpy( &k1, data + i * 16, 8 );
+            memcpy( &k2, data + i * 16 + 8, 8 );
+
+            k1 *= c1;
+            k1 = rotateLeft( k1, 31 );
+            k1 *= c2;
+            h1 ^= k1;
+            h1 = rotateLeft( h1, 27 );
+            h1 += h2;
+            h1 = h1 * 5 + 0x52dce729;
+
+            k2 *= c2;
+            k2 = rotateLeft( k2, 33 );
+            k2 *= c1;
+            h2 ^= k2;
+            h2 = rotateLeft( h2, 31 );
+            h2 += h1;
+            h2 = h2 * 5 + 0x38495ab5;
+        }
+
+        // The last bytes, zero padded, which gives the reference tail mixing
+        memset( tail, 0, sizeof( tail ) );
+        memcpy( tail, data + num_blocks * 16, length % 16 );
+        memcpy( &k1, tail, 8 );
+        memcpy( &k2, tail + 8, 8 );
+        if ( length % 16 > 8 )
+        {
+            k2 *= c2;
+            k2 = rotateLeft( k2, 33 );
+            k2 *= c1;
+            h2 ^= k2;
+        }
+        if ( length % 16 > 0 )
+        {
+            k1 *= c1;
+            k1 = rotateLeft( k1, 31 );
+            k1 *= c2;
+            h1 ^= k1;
+        }
+
+        h1 ^= length;
+        h2 ^= length;
+        h1 += h2;
+        h2 += h1;
+        h1 = finalMix( h1 );
+        h2 = finalMix( h2 );
+        h1 += h2;
+        h2 += h1;
+
+        hash.high = h1;
+        hash.low = h2;
+        return hash;
+    }
+
+    Hash128 hashSequence( std::string_view sequence )
+    {
+        return hashWithSeed( sequence, 0, 0 );
+    }
+
+    Hash128 hashPair( std::string_view first, std::string_view second, bool canonical )
+    {
+        Hash128 first_hash;
+
+        if ( canonical && second < first )
+        {
+            std::swap( first, second );
+        }
+
+        // The first mate's hash seeds the second's, both lengths are mixed in,
+        // so no separator is needed between the mates
+        first_hash = hashSequence( first );
+        return hashWithSeed( second, first_hash.high, first_hash.low );
+    }
+
+    // The high bits pick the home slot of any table size
+    static inline size_t findHomeSlot( uint64_t fingerprint, size_t num_slots )
+    {
+        return ( unsigned __int128 )fingerprint * num_slots >> 64;
+    }
+
+    // Grows a table of either slot type by half, fingerprints give the home
+    // slots, so no sequence is hashed again
+    template <class Slot>
+    static void growTable( std::vector<Slot>& slots, size_t& max_size )
+    {
+        std::vector<Slot> old_slots;
+        size_t slot;
+
+        old_slots.swap( slots );
+        slots.resize( old_slots.empty() ? 1024 : old_slots.size() + old_slots.size() / 2, Slot() );
+        max_size = slots.size() / 5 * 4;
+
+        for ( size_t i = 0; i < old_slots.size(); i++ )
+        {
+            if ( old_slots[i].fingerprint == 0 )
+            {
+                continue;
+            }
+            for ( slot = findHomeSlot( old_slots[i].fingerprint, slots.size() ); slots[slot].fingerprint != 0;
+                            slot = slot + 1 == slots.size() ? 0 : slot + 1 );
+            slots[slot] = old_slots[i];
+        }
+    }
+
+    //------------------------------Constructor---------------------------------//
+    SeqHash::SeqHash()
+    {
+        _size = 0;
+        _max_size = 0;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    SeqHash::~SeqHash()
+    {
+
+    }
+
+    //--------------------------------Probing-----------------------------------//
+    size_t SeqHash::findSlot( uint64_t fingerprint ) const
+    {
+        return findHomeSlot( fingerprint, _slots.size() );
+    }
+
+    void SeqHash::grow()
+    {
+        growTable( _slots, _max_size );
+    }
+
+    //-------------------------------Inserting----------------------------------//
+    bool SeqHash::insertSequence( std::string_view sequence )
+    {
+        return SeqHash::insertHash( hashSequence( sequence ) );
+    }
+
+    bool SeqHash::insertHash( Hash128 hash )
+    {
+        size_t slot;
+
+        if ( _size == _max_size )
+        {
+            grow();
+        }
+        hash.high |= 1;
+        for ( slot = findSlot( hash.high ); _slots[slot].fingerprint != 0;
+                        slot = slot + 1 == _slots.size() ? 0 : slot + 1 )
+        {
+            if ( _slots[slot].fingerprint == hash.high && _slots[slot].check == hash.low )
+            {
+                return false;
+            }
+        }
+        _slots[slot].fingerprint = hash.high;
+        _slots[slot].check = hash.low;
+        _size++;
+        return true;
+    }
+
+    PackedSeq::Ref* SeqHash::insertRecord( std::string_view sequence, PackedSeq::Ref record,
+                                           bool& inserted )
+    {
+        return SeqHash::insertRecord( hashSequence( sequence ), record, inserted );
+    }
+
+    PackedSeq::Ref* SeqHash::insertRecord( const Hash128& hash, PackedSeq::Ref record,
+                                           bool& inserted )
+    {
+        uint64_t fingerprint = hash.high | 1;
+        size_t slot;
+
+        if ( _size == _max_size )
+        {
+            grow();
+        }
+        for ( slot = findSlot( fingerprint ); _slots[slot].fingerprint != 0;
+                        slot = slot + 1 == _slots.size() ? 0 : slot + 1 )
+        {
+            // Equal fingerprints are checked against the stored sequence
+            if ( _slots[slot].fingerprint == fingerprint &&
+                            PackedSeq::PackedSeq::compareSequences( _slots[slot].record, record ) == 0 )
+            {
+                inserted = false;
+                return &_slots[slot].record;
+            }
+        }
+        _slots[slot].fingerprint = fingerprint;
+        _slots[slot].record = record;
+        _size++;
+        inserted = true;
+        return &_slots[slot].record;
+    }
+
+    //------------------------------Attributes----------------------------------//
+    void SeqHash::getRecords( std::vector<PackedSeq::Ref>& records ) const
+    {
+        records.reserve( records.size() + _size );
+        for ( size_t i = 0; i < _slots.size(); i++ )
+        {
+            if ( _slots[i].fingerprint != 0 )
+            {
+                records.push_back( _slots[i].record );
+            }
+        }
+    }
+
+    size_t SeqHash::size() const
+    {
+        return _size;
+    }
+
+    size_t SeqHash::getMemoryUsage() const
+    {
+        return _slots.capacity() * sizeof( Slot );
+    }
+
+    void SeqHash::clear()
+    {
+        std::vector<Slot>().swap( _slots );
+        _size = 0;
+        _max_size = 0;
+    }
+
+    //------------------------------PairedSeqHash-------------------------------//
+    PairedSeqHash::PairedSeqHash()
+    {
+        _size = 0;
+        _max_size = 0;
+        _canonical = false;
+    }
+
+    PairedSeqHash::~PairedSeqHash()
+    {
+
+    }
+
+    void PairedSeqHash::setCanonical( bool canonical )
+    {
+        _canonical = canonical;
+    }
+
+    bool PairedSeqHash::isDuplicate( const RefPair& stored, const RefPair& records ) const
+    {
+        if ( PackedSeq::PackedSeq::compareSequences( stored.first, records.first ) == 0 &&
+                        PackedSeq::PackedSeq::compareSequences( stored.second, records.second ) == 0 )
+        {
+            return true;
+        }
+        return _canonical &&
+               PackedSeq::PackedSeq::compareSequences( stored.first, records.second ) == 0 &&
+               PackedSeq::PackedSeq::compareSequences( stored.second, records.first ) == 0;
+    }
+
+    PairedSeqHash::RefPair* PairedSeqHash::insertPair( std::string_view first_sequence,
+                    std::string_view second_sequence, const RefPair& records, bool& inserted )
+    {
+        uint64_t fingerprint = hashPair( first_sequence, second_sequence, _canonical ).high | 1;
+        size_t slot;
+
+        if ( _size == _max_size )
+        {
+            growTable( _slots, _max_size );
+        }
+        for ( slot = findHomeSlot( fingerprint, _slots.size() ); _slots[slot].fingerprint != 0;
+                        slot = slot + 1 == _slots.size() ? 0 : slot + 1 )
+        {
+            // Equal fingerprints are checked against the stored mates
+            if ( _slots[slot].fingerprint == fingerprint &&
+                            PairedSeqHash::isDuplicate( _slots[slot].records, records ) )
+            {
+                inserted = false;
+                return &_slots[slot].records;
+            }
+        }
+        _slots[slot].fingerprint = fingerprint;
+        _slots[slot].records = records;
+        _size++;
+        inserted = true;
+        return &_slots[slot].records;
+    }
+
+    void PairedSeqHash::getRecords( std::vector<RefPair>& records ) const
+    {
+        records.reserve( records.size() + _size );
+        for ( size_t i = 0; i < _slots.size(); i++ )
+        {
+            if ( _slots[i].fingerprint != 0 )
+            {
+                records.push_back( _slots[i].records );
+            }
+        }
+    }
+
+    size_t PairedSeqHash::size() const
+    {
+        return _size;
+    }
+
+    size_t PairedSeqHash::getMemoryUsage() const
+    {
+        return _slots.capacity() * sizeof( Slot );
+    }
+
+    void PairedSeqHash::clear()
+    {
+        std::vector<Slot>().swap( _slots );
+        _size = 0;
+        _max_size = 0;
+    }
+
+} // namespace SeqHash
@@ -0,0 +1,252 @@
+/*! \file SeqHash.h
+    SeqHash Class Declaration.
+    \verbinclude SeqHash.h
+*/
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "PackedSeq.h"                                // Stored records
+
+namespace SeqHash
+{
+    /** \struct Hash128
+        \brief A 128-bit sequence fingerprint.
+    */
+    struct Hash128
+    {
+        uint64_t high;                         /**<Picks the slot, kept in every slot. */
+        uint64_t low;                          /**<Kept when no record is stored. */
+    };
+
+    /**
+        \fn hashSequence
+        \brief Hashes a sequence with MurmurHash3 (x64, 128-bit).
+        @param sequence sequence text
+        @return Fingerprint
+    */
+    Hash128 hashSequence( std::string_view sequence );
+
+    /**
+        \fn hashPair
+        \brief Hashes the sequences of a mate pair, the first mate's hash seeding the second's.
+        @param first first mate sequence
+        @param second second mate sequence
+        @param canonical hash the mates in text order, so swapped mates hash alike
+        @return Fingerprint
+    */
+    Hash128 hashPair( std::string_view first, std::string_view second, bool canonical = false );
+
+    /** \class SeqHash
+        \brief Open-addressing set of sequences, keyed by their 128-bit fingerprint.
+
+        Each slot holds 16 bytes: the high half of the fingerprint, which also
+        picks the slot, and either the PackedSeq record with that sequence or,
+        when only sequences are kept, the low half of the fingerprint. Slots are
+        probed linearly and the table grows by half when it is 80% full, so it
+        costs 20 to 30 bytes per unique sequence. Records are verified exactly
+        with PackedSeq::compareSequences when their fingerprints match; a table
+        of bare fingerprints treats equal 128-bit fingerprints as equal
+        sequences. A table holds either records or bare fingerprints, not both.
+    */
+    class SeqHash
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \struct Slot
+                \brief A stored sequence, empty while fingerprint is 0.
+            */
+            struct Slot
+            {
+                uint64_t fingerprint;          /**<High half of the hash, never 0 when used. */
+                union
+                {
+                    PackedSeq::Ref record;     /**<Record with the sequence. */
+                    uint64_t check;            /**<Low half of the hash, without records. */
+                };
+            };
+
+            std::vector<Slot> _slots;          /**<Table, any size, never full. */
+            size_t _size;                      /**<Used slots. */
+            size_t _max_size;                  /**<Used slots before the table grows. */
+
+            size_t findSlot( uint64_t fingerprint ) const;
+            void grow();
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs an empty SeqHash, no slot is allocated until the first insert.
+            */
+            SeqHash();
+
+            /** \fn Destructor */
+            ~SeqHash();
+
+            /**
+                \fn insertSequence
+                \brief Adds the fingerprint of a sequence, no record is kept.
+                @param sequence sequence text
+                @return True if the sequence was not in the table
+            */
+            bool insertSequence( std::string_view sequence );
+
+            /**
+                \fn insertHash
+                \brief Adds a fingerprint, ex. of a mate pair, no record is kept.
+                @param hash full fingerprint
+                @return True if the fingerprint was not in the table
+            */
+            bool insertHash( Hash128 hash );
+
+            /**
+                \fn insertRecord
+                \brief Adds a stored record, unless a record with its sequence is in the table.
+                @param sequence sequence text of record
+                @param record stored record
+                @param inserted set to true if record was added
+                @return Slot of the record with this sequence, may be replaced
+                        with a record of the same sequence until the next insert
+            */
+            PackedSeq::Ref* insertRecord( std::string_view sequence, PackedSeq::Ref record,
+                                          bool& inserted );
+
+            /**
+                \fn insertRecord
+                \brief Adds a stored record whose sequence was hashed beforehand, ex. on another thread.
+                @param hash hashSequence of the record's sequence
+                @param record stored record
+                @param inserted set to true if record was added
+                @return Slot of the record with this sequence
+            */
+            PackedSeq::Ref* insertRecord( const Hash128& hash, PackedSeq::Ref record, bool& inserted );
+
+            /**
+                \fn getRecords
+                \brief Appends the stored records, in table order.
+                @param records records
+            */
+            void getRecords( std::vector<PackedSeq::Ref>& records ) const;
+
+            /**
+                \fn size
+                \brief Returns the number of unique sequences.
+                @return Sequences
+            */
+            size_t size() const;
+
+            /**
+                \fn getMemoryUsage
+                \brief Returns the bytes used by the table.
+                @return Bytes
+            */
+            size_t getMemoryUsage() const;
+
+            /**
+                \fn clear
+                \brief Removes every sequence and frees the table.
+            */
+            void clear();
+
+    }; // class SeqHash
+
+    /** \class PairedSeqHash
+        \brief Open-addressing set of mate pairs, keyed by the fingerprint of both sequences.
+
+        The paired form of SeqHash: each 24 byte slot holds the high half of
+        hashPair and the PackedSeq records of both mates, verified exactly when
+        fingerprints match. With setCanonical a pair whose mates are swapped
+        (the first sequence of one is the second of the other) is a duplicate.
+    */
+    class PairedSeqHash
+    {
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /** \typedef RefPair
+                \brief Stored records of the first and second mate.
+            */
+            typedef std::pair<PackedSeq::Ref, PackedSeq::Ref> RefPair;
+
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \struct Slot
+                \brief A stored pair, empty while fingerprint is 0.
+            */
+            struct Slot
+            {
+                uint64_t fingerprint;          /**<High half of the pair hash, never 0 when used. */
+                RefPair records;               /**<Records of both mates. */
+            };
+
+            std::vector<Slot> _slots;          /**<Table, any size, never full. */
+            size_t _size;                      /**<Used slots. */
+            size_t _max_size;                  /**<Used slots before the table grows. */
+            bool _canonical;                   /**<Swapped mates are duplicates. */
+
+            bool isDuplicate( const RefPair& stored, const RefPair& records ) const;
+
+        public:
+            /**
+                \fn Constructor
+                \brief Constructs an empty PairedSeqHash, no slot is allocated until the first insert.
+            */
+            PairedSeqHash();
+
+            /** \fn Destructor */
+            ~PairedSeqHash();
+
+            /**
+                \fn setCanonical
+                \brief Treats pairs with swapped mates as duplicates, before any insert.
+                @param canonical ignore mate orientation
+            */
+            void setCanonical( bool canonical );
+
+            /**
+                \fn insertPair
+                \brief Adds the stored records of a pair, unless a pair with their sequences is in the table.
+                @param first_sequence sequence text of the first mate
+                @param second_sequence sequence text of the second mate
+                @param records stored records of both mates
+                @param inserted set to true if the pair was added
+                @return Slot records of the pair with these sequences, may be replaced
+                        with records of the same sequences until the next insert
+            */
+            RefPair* insertPair( std::string_view first_sequence, std::string_view second_sequence,
+                                 const RefPair& records, bool& inserted );
+
+            /**
+                \fn getRecords
+                \brief Appends the stored pairs, in table order.
+                @param records pairs
+            */
+            void getRecords( std::vector<RefPair>& records ) const;
+
+            /**
+                \fn size
+                \brief Returns the number of unique pairs.
+                @return Pairs
+            */
+            size_t size() const;
+
+            /**
+                \fn getMemoryUsage
+                \brief Returns the bytes used by the table.
+                @return Bytes
+            */
+            size_t getMemoryUsage() const;
+
+            /**
+                \fn clear
+                \brief Removes every pair and frees the table.
+            */
+            void clear();
+
+    }; // class PairedSeqHash
+
+} // namespace SeqHash
@@ -0,0 +1,273 @@
+/*! \file ShardedDedup.cpp
+    ShardedDedup Class Implementation.
+    \verbinclude ShardedDedup.cpp
+*/
+
+#include <thread>
+#include <queue>
+#include <algorithm>
+#include "ShardedDedup.h"                             // Declaration File
+#include "QualityKernel.h"                            // Expected errors of best-quality
+
+namespace ShardedDedup
+{
+    static const size_t MIN_THREAD_SORT = 65536;      // Records worth a thread per shard to sort
+
+    bool parseKeepPolicy( const std::string& name, KeepPolicy& policy )
+    {
+        if ( name == "last" )
+        {
+            policy = KEEP_LAST;
+        }
+        else if ( name == "first" )
+        {
+            policy = KEEP_FIRST;
+        }
+        else if ( name == "best-quality" )
+        {
+            policy = KEEP_BEST_QUALITY;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    //------------------------------Constructor---------------------------------//
+    ShardedDedup::ShardedDedup( size_t num_shards )
+    {
+        for ( size_t i = 0; i < std::max<size_t>( num_shards, 1 ); i++ )
+        {
+            _shards.push_back( std::unique_ptr<Shard>( new Shard() ) );
+            _shards.back()->next_chunk = 0;
+        }
+        _keep_policy = KEEP_LAST;
+        _phred_offset = 33;
+        _bin_qualities = false;
+    }
+
+    //------------------------------Destructor----------------------------------//
+    ShardedDedup::~ShardedDedup()
+    {
+
+    }
+
+    //------------------------------Configuration-------------------------------//
+    void ShardedDedup::setKeepPolicy( KeepPolicy keep_policy, int phred_offset )
+    {
+        _keep_policy = keep_policy;
+        _phred_offset = phred_offset;
+    }
+
+    void ShardedDedup::setBinQualities( bool bin_qualities, int phred_offset )
+    {
+        _bin_qualities = bin_qualities;
+        for ( size_t i = 0; i < _shards.size(); i++ )
+        {
+            _shards[i]->records.setBinQualities( bin_qualities, phred_offset );
+        }
+    }
+
+    //--------------------------------Locking-----------------------------------//
+    // Always in shard order, inserts hold one shard at a time
+    void ShardedDedup::lockAll()
+    {
+        for ( size_t i = 0; i < _shards.size(); i++ )
+        {
+            _shards[i]->lock.lock();
+        }
+    }
+
+    void ShardedDedup::unlockAll()
+    {
+        for ( size_t i = _shards.size(); i > 0; i-- )
+        {
+            _shards[i - 1]->lock.unlock();
+        }
+    }
+
+    //-------------------------------Inserting----------------------------------//
+    void ShardedDedup::insertChunk( size_t chunk_index, const std::vector<FastQ::FastQView>& records )
+    {
+        size_t num_shards = _shards.size();
+        std::vector<std::vector<size_t> > batches( num_shards );
+        std::vector<SeqHash::Hash128> hashes( records.size() );
+        std::vector<uint64_t> errors;
+        std::string quality_buffer;
+        PackedSeq::Ref record;
+        PackedSeq::Ref* kept_record;
+        uint64_t record_errors;
+        bool inserted;
+        bool keep_new;
+
+        // Hashing and routing need no lock, the high half of the hash picks
+        // the slot within a shard, so the low half picks the shard
+        for ( size_t i = 0; i < records.size(); i++ )
+        {
+            hashes[i] = SeqHash::hashSequence( records[i].sequence );
+            batches[hashes[i].low % num_shards].push_back( i );
+        }
+
+        // Expected errors of the reads are summed here too, unless they are
+        // compared once binned as stored
+        if ( _keep_policy == KEEP_BEST_QUALITY && !_bin_qualities )
+        {
+            errors.resize( records.size() );
+            for ( size_t i = 0; i < records.size(); i++ )
+            {
+                errors[i] = QualityKernel::sumErrorProbabilities( records[i].quality, _phred_offset );
+            }
+        }
+
+        for ( size_t visit = 0; visit < num_shards; visit++ )
+        {
+            Shard& shard = *_shards[( chunk_index + visit ) % num_shards];
+            std::unique_lock<std::mutex> lock( shard.lock );
+
+            // The shard takes its batches in file order
+            shard.turn.wait( lock, [&]()
+            {
+                return shard.next_chunk == chunk_index;
+            } );
+
+            for ( size_t i : batches[( chunk_index + visit ) % num_shards] )
+            {
+                record = shard.records.add( records[i] );
+                kept_record = shard.sequences.insertRecord( hashes[i], record, inserted );
+                if ( inserted )
+                {
+                    continue;
+                }
+                if ( _keep_policy == KEEP_BEST_QUALITY )
+                {
+                    record_errors = _bin_qualities ? QualityKernel::sumErrorProbabilities(
+                                        shard.records.getQualityLine( record, quality_buffer ),
+                                        _phred_offset ) : errors[i];
+                    keep_new = record_errors < QualityKernel::sumErrorProbabilities(
+                                   shard.records.getQualityLine( *kept_record, quality_buffer ), _phred_offset );
+                }
+                else
+                {
+                    keep_new = _keep_policy == KEEP_LAST;
+                }
+                if ( keep_new )
+                {
+                    *kept_record = shard.records.replace( *kept_record, record );
+                }
+                else
+                {
+                    shard.records.discard( record );
+                }
+            }
+
+            shard.next_chunk++;
+            lock.unlock();
+            shard.turn.notify_all();
+        }
+    }
+
+    //--------------------------------Output------------------------------------//
+    void ShardedDedup::writeSorted( WriteFunction write )
+    {
+        size_t num_shards = _shards.size();
+        std::vector<std::vector<PackedSeq::Ref> > sorted( num_shards );
+        std::vector<size_t> positions( num_shards, 0 );
+        std::vector<std::thread> sorters;
+        std::string record_buffer;
+        FastQ::FastQView record;
+        size_t shard;
+        size_t num_records = 0;
+
+        ShardedDedup::lockAll();
+
+        // Shards are sorted on their own threads, their table is no longer needed,
+        // small runs spilled under a low memory limit are sorted here
+        auto sortShard = [&]( size_t i )
+        {
+            _shards[i]->sequences.getRecords( sorted[i] );
+            _shards[i]->sequences.clear();
+            std::sort( sorted[i].begin(), sorted[i].end(), PackedSeq::SequenceLess() );
+        };
+        for ( size_t i = 0; i < num_shards; i++ )
+        {
+            num_records += _shards[i]->sequences.size();
+        }
+        for ( size_t i = 0; i < num_shards; i++ )
+        {
+            if ( num_shards > 1 && num_records >= MIN_THREAD_SORT )
+            {
+                sorters.push_back( std::thread( sortShard, i ) );
+            }
+            else
+            {
+                sortShard( i );
+            }
+        }
+        for ( size_t i = 0; i < sorters.size(); i++ )
+        {
+            sorters[i].join();
+        }
+
+        // A shard holds every copy of its sequences, so the merge sees no ties
+        auto later_shard = [&]( size_t first, size_t second )
+        {
+            return PackedSeq::PackedSeq::compareSequences( sorted[first][positions[first]],
+                            sorted[second][positions[second]] ) > 0;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype( later_shard )> merge_queue(
+                        later_shard );
+
+        for ( size_t i = 0; i < num_shards; i++ )
+        {
+            if ( !sorted[i].empty() )
+            {
+                merge_queue.push( i );
+            }
+        }
+        while ( !merge_queue.empty() )
+        {
+            shard = merge_queue.top();
+            merge_queue.pop();
+            _shards[shard]->records.getRecord( sorted[shard][positions[shard]], record_buffer, record );
+            write( record );
+            if ( ++positions[shard] < sorted[shard].size() )
+            {
+                merge_queue.push( shard );
+            }
+        }
+
+        for ( size_t i = 0; i < num_shards; i++ )
+        {
+            _shards[i]->records.clear();
+        }
+        ShardedDedup::unlockAll();
+    }
+
+    //------------------------------Attributes----------------------------------//
+    size_t ShardedDedup::size()
+    {
+        size_t num_sequences = 0;
+
+        for ( size_t i = 0; i < _shards.size(); i++ )
+        {
+            std::lock_guard<std::mutex> lock( _shards[i]->lock );
+            num_sequences += _shards[i]->sequences.size();
+        }
+        return num_sequences;
+    }
+
+    unsigned long long ShardedDedup::getUsedMemory()
+    {
+        unsigned long long used_memory = 0;
+
+        for ( size_t i = 0; i < _shards.size(); i++ )
+        {
+            std::lock_guard<std::mutex> lock( _shards[i]->lock );
+            used_memory += _shards[i]->records.getArena().getUsedMemory() +
+                           _shards[i]->sequences.getMemoryUsage();
+        }
+        return used_memory;
+    }
+
+} // namespace ShardedDedup
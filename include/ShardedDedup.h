@@ -0,0 +1,146 @@
+/*! \file ShardedDedup.h
+    ShardedDedup Class Declaration.
+    \verbinclude ShardedDedup.h
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+#include "FastQ.h"                                    // FastQView
+#include "PackedSeq.h"                                // Record storage of each shard
+#include "SeqHash.h"                                  // Unique sequences of each shard
+
+namespace ShardedDedup
+{
+    /** \enum KeepPolicy
+        \brief Which copy of a duplicated sequence is kept.
+    */
+    enum KeepPolicy
+    {
+        KEEP_LAST,                             /**<The last copy, as the sorted map always did. */
+        KEEP_FIRST,                            /**<The first copy, as --stream. */
+        KEEP_BEST_QUALITY                      /**<The copy with the fewest expected errors, the first of equals. */
+    };
+
+    /**
+        \fn parseKeepPolicy
+        \brief Parses a --keep value, "first", "last" or "best-quality".
+        @param name policy name
+        @param policy set to the policy
+        @return False if the name is unknown
+    */
+    bool parseKeepPolicy( const std::string& name, KeepPolicy& policy );
+
+    /** \class ShardedDedup
+        \brief Unique records split into shards by sequence hash, filled by several threads.
+
+        Parsing threads hash the records of a chunk and route them to the
+        shards in one batch per shard. Each shard has its own PackedSeq and
+        SeqHash behind a lock, and takes the batches of the chunks strictly in
+        file order: a batch waits until the previous chunk's batch for that
+        shard is in. As a sequence always lands in the same shard, the copy
+        kept is the one a single thread reading the file would keep, while the
+        shards fill in parallel. Batches start at a different shard for each
+        chunk, so consecutive chunks rarely wait for each other.
+    */
+    class ShardedDedup
+    {
+            //-------------------------------PRIVATE---------------------------------//
+        private:
+            /** \struct Shard
+                \brief Unique records of one range of sequence hashes.
+            */
+            struct Shard
+            {
+                std::mutex lock;               /**<Held while the shard is changed. */
+                std::condition_variable turn;  /**<Signalled when next_chunk advances. */
+                size_t next_chunk;             /**<Chunk whose batch goes in next. */
+                PackedSeq::PackedSeq records;  /**<Records of the shard. */
+                SeqHash::SeqHash sequences;    /**<Unique sequences of the shard. */
+            };
+
+            std::vector<std::unique_ptr<Shard> > _shards;
+            KeepPolicy _keep_policy;
+            int _phred_offset;                 /**<Quality encoding of best-quality. */
+            bool _bin_qualities;               /**<Stored qualities are binned. */
+
+            void lockAll();
+            void unlockAll();
+
+            //-------------------------------PUBLIC----------------------------------//
+        public:
+            /** \typedef WriteFunction
+                \brief Receives unique records in sequence order.
+            */
+            typedef std::function<void( const FastQ::FastQView& record )> WriteFunction;
+
+            /**
+                \fn Constructor
+                \brief Constructs the ShardedDedup object.
+                @param num_shards number of shards, ex. four per parsing thread
+            */
+            explicit ShardedDedup( size_t num_shards = 1 );
+
+            /** \fn Destructor */
+            ~ShardedDedup();
+
+            /**
+                \fn setKeepPolicy
+                \brief Sets which copy of a duplicate is kept, before any insert.
+                Best-quality compares QualityKernel::sumErrorProbabilities of the
+                qualities as stored, so binned when setBinQualities is on.
+                @param keep_policy policy
+                @param phred_offset quality encoding for best-quality, 33 or 64
+            */
+            void setKeepPolicy( KeepPolicy keep_policy, int phred_offset = 33 );
+
+            /**
+                \fn setBinQualities
+                \brief Bins the qualities of stored records, see PackedSeq::setBinQualities.
+                @param bin_qualities bin and pack qualities
+                @param phred_offset quality encoding, 33 or 64
+            */
+            void setBinQualities( bool bin_qualities, int phred_offset );
+
+            /**
+                \fn insertChunk
+                \brief Adds the records of a chunk, thread safe.
+                Every chunk index from 0 must be inserted exactly once, in any order
+                across threads.
+                @param chunk_index index of the chunk in the file
+                @param records records of the chunk, in file order
+            */
+            void insertChunk( size_t chunk_index, const std::vector<FastQ::FastQView>& records );
+
+            /**
+                \fn writeSorted
+                \brief Sorts the shards on their own threads, writes their merged records and frees them.
+                Inserts wait meanwhile and continue into empty shards, so no record
+                is freed unwritten. Must not run inside insertChunk.
+                @param write receives each unique record in sequence order
+            */
+            void writeSorted( WriteFunction write );
+
+            /**
+                \fn size
+                \brief Returns the number of unique sequences.
+                @return Sequences
+            */
+            size_t size();
+
+            /**
+                \fn getUsedMemory
+                \brief Returns the memory used by the records and tables of all shards.
+                @return Bytes
+            */
+            unsigned long long getUsedMemory();
+
+    }; // class ShardedDedup
+
+} // namespace ShardedDedup
@@ -8,6 +8,9 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <vector>
+#include <thread>
+#include <algorithm>
 #include "FastQ.h"
 
 namespace Utilities
@@ -27,30 +30,246 @@ namespace Utilities
     /*
      *  * Intersection of two maps
     */
-    template<typename KeyType, typename ValueType>
-    std::map<KeyType, std::pair < ValueType, ValueType > > IntersectMaps( const std::map<KeyType, ValueType>&
-                    m1, const std::map<KeyType, ValueType>& m2)
+    template<typename KeyType, typename ValueType, typename Compare, typename Alloc>
+    std::map<KeyType, std::pair < ValueType, ValueType >, Compare > IntersectMaps(
+                    const std::map<KeyType, ValueType, Compare, Alloc>& m1,
+                    const std::map<KeyType, ValueType, Compare, Alloc>& m2)
     {
-        std::map<KeyType, std::pair<ValueType, ValueType> > map_result;
-        typename std::map<KeyType, ValueType>::const_iterator im1 = m1.begin();
-        typename std::map<KeyType, ValueType>::const_iterator im2 = m2.begin();
+        std::map<KeyType, std::pair<ValueType, ValueType>, Compare> map_result( m1.key_comp() );
+        Compare less = m1.key_comp();
 
-        while ( im1 != m1.end() && im2 != m2.end() )
+        // Matches arrive in key order, so each is inserted at the end
+        IntersectSorted( m1.begin(), m1.end(), m2.begin(), m2.end(),
+                         [&]( const std::pair<const KeyType, ValueType>& a,
+                              const std::pair<const KeyType, ValueType>& b )
         {
-            if ( im1->first < im2->first )
-                ++im1;
-            else if ( im2->first < im1->first )
-                ++im2;
+            return less( a.first, b.first ) ? -1 : less( b.first, a.first ) ? 1 : 0;
+        },
+        [&]( const std::pair<const KeyType, ValueType>& a, const std::pair<const KeyType, ValueType>& b )
+        {
+            map_result.insert( map_result.end(), std::make_pair( a.first, std::make_pair( a.second,
+                               b.second ) ) );
+        } );
+
+        return map_result;
+    }
+
+    /*
+     *  * Merge join of two sorted ranges
+    */
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnBoth, typename OnFirst,
+             typename OnSecond>
+    void MergeJoin( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                    OnBoth on_both, OnFirst on_first, OnSecond on_second )
+    {
+        int order;
+
+        while ( first1 != last1 && first2 != last2 )
+        {
+            order = compare( *first1, *first2 );
+            if ( order < 0 )
+            {
+                on_first( *first1 );
+                ++first1;
+            }
+            else if ( order > 0 )
+            {
+                on_second( *first2 );
+                ++first2;
+            }
             else
             {
-                map_result.insert( std::make_pair( im1->first, std::make_pair( im1->second,
-                        im2->second ) ) );
-                ++im1;
-                ++im2;
+                on_both( *first1, *first2 );
+                ++first1;
+                ++first2;
             }
         }
+        for ( ; first1 != last1; ++first1 )
+        {
+            on_first( *first1 );
+        }
+        for ( ; first2 != last2; ++first2 )
+        {
+            on_second( *first2 );
+        }
+    }
 
-        return map_result;
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnMatch>
+    void IntersectSorted( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                          OnMatch on_match )
+    {
+        int order;
+
+        // Stops at the end of either range, the rest cannot match
+        while ( first1 != last1 && first2 != last2 )
+        {
+            order = compare( *first1, *first2 );
+            if ( order < 0 )
+            {
+                ++first1;
+            }
+            else if ( order > 0 )
+            {
+                ++first2;
+            }
+            else
+            {
+                on_match( *first1, *first2 );
+                ++first1;
+                ++first2;
+            }
+        }
+    }
+
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnMissing>
+    void DifferenceSorted( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                           OnMissing on_missing )
+    {
+        MergeJoin( first1, last1, first2, last2, compare, []( const auto&, const auto& ) {}, on_missing,
+                   []( const auto& ) {} );
+    }
+
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnKey>
+    void UnionSorted( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                      OnKey on_key )
+    {
+        MergeJoin( first1, last1, first2, last2, compare,
+                   [&]( const auto& a, const auto& b )
+        {
+            on_key( &a, &b );
+        },
+        [&]( const auto& a )
+        {
+            on_key( &a, static_cast<decltype( &*first2 )>( NULL ) );
+        },
+        [&]( const auto& b )
+        {
+            on_key( static_cast<decltype( &*first1 )>( NULL ), &b );
+        } );
+    }
+
+    /*
+     *  * Merge join of two sorted ranges, one thread per part of the key space
+    */
+    template<typename RandomIt1, typename RandomIt2, typename Compare, typename OnBoth, typename OnFirst,
+             typename OnSecond>
+    void ParallelMergeJoin( RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, RandomIt2 last2,
+                            Compare compare, size_t num_parts, OnBoth on_both, OnFirst on_first,
+                            OnSecond on_second )
+    {
+        size_t size1 = last1 - first1;
+        std::vector<RandomIt1> bounds1;
+        std::vector<RandomIt2> bounds2;
+        std::vector<std::thread> joiners;
+
+        num_parts = std::max<size_t>( 1, std::min( num_parts, size1 ) );
+        bounds1.push_back( first1 );
+        bounds2.push_back( first2 );
+
+        // A run of equal keys is never cut, so each key is in a single part
+        for ( size_t part = 1; part < num_parts; part++ )
+        {
+            RandomIt1 split = first1 + size1 * part / num_parts;
+            split = std::lower_bound( bounds1.back(), split, *split, [&]( const auto& a, const auto& key )
+            {
+                return compare( a, key ) < 0;
+            } );
+            bounds2.push_back( std::lower_bound( bounds2.back(), last2, *split, [&]( const auto& b,
+                                                 const auto& key )
+            {
+                return compare( key, b ) > 0;
+            } ) );
+            bounds1.push_back( split );
+        }
+        bounds1.push_back( last1 );
+        bounds2.push_back( last2 );
+
+        auto joinPart = [&]( size_t part )
+        {
+            MergeJoin( bounds1[part], bounds1[part + 1], bounds2[part], bounds2[part + 1], compare,
+                       [&]( const auto& a, const auto& b )
+            {
+                on_both( part, a, b );
+            },
+            [&]( const auto& a )
+            {
+                on_first( part, a );
+            },
+            [&]( const auto& b )
+            {
+                on_second( part, b );
+            } );
+        };
+        for ( size_t part = 1; part < num_parts; part++ )
+        {
+            joiners.push_back( std::thread( joinPart, part ) );
+        }
+        joinPart( 0 );
+        for ( size_t i = 0; i < joiners.size(); i++ )
+        {
+            joiners[i].join();
+        }
+    }
+
+    template<typename RandomIt1, typename RandomIt2, typename Compare, typename OnMatch>
+    void ParallelIntersectSorted( RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, RandomIt2 last2,
+                                  Compare compare, size_t num_parts, OnMatch on_match )
+    {
+        ParallelMergeJoin( first1, last1, first2, last2, compare, num_parts, on_match,
+                           []( size_t, const auto& ) {}, []( size_t, const auto& ) {} );
+    }
+
+    /*
+     *  * Lookups of a range in a hash table, one thread per part of the range
+    */
+    template<typename RandomIt, typename Table, typename KeyOf, typename OnMatch, typename OnMissing>
+    void ProbeHashed( RandomIt first, RandomIt last, const Table& table, KeyOf key_of, size_t num_parts,
+                      OnMatch on_match, OnMissing on_missing )
+    {
+        size_t size = last - first;
+        std::vector<std::thread> probers;
+
+        num_parts = std::max<size_t>( 1, std::min( num_parts, size ) );
+        auto probePart = [&]( size_t part )
+        {
+            for ( RandomIt it = first + size * part / num_parts; it != first + size * ( part + 1 ) / num_parts;
+                            ++it )
+            {
+                auto entry = table.find( key_of( *it ) );
+                if ( entry != table.end() )
+                {
+                    on_match( part, *it, *entry );
+                }
+                else
+                {
+                    on_missing( part, *it );
+                }
+            }
+        };
+        for ( size_t part = 1; part < num_parts; part++ )
+        {
+            probers.push_back( std::thread( probePart, part ) );
+        }
+        probePart( 0 );
+        for ( size_t i = 0; i < probers.size(); i++ )
+        {
+            probers[i].join();
+        }
+    }
+
+    template<typename RandomIt, typename Table, typename KeyOf, typename OnMatch>
+    void IntersectHashed( RandomIt first, RandomIt last, const Table& table, KeyOf key_of, size_t num_parts,
+                          OnMatch on_match )
+    {
+        ProbeHashed( first, last, table, key_of, num_parts, on_match, []( size_t, const auto& ) {} );
+    }
+
+    template<typename RandomIt, typename Table, typename KeyOf, typename OnMissing>
+    void DifferenceHashed( RandomIt first, RandomIt last, const Table& table, KeyOf key_of, size_t num_parts,
+                           OnMissing on_missing )
+    {
+        ProbeHashed( first, last, table, key_of, num_parts, []( size_t, const auto&, const auto& ) {},
+                     on_missing );
     }
 
     // explicit instantiation
@@ -2,16 +2,133 @@
 
 #include <string>
 #include <map>
+#include <cstddef>
 
 namespace Utilities
 {
 
     template <typename T> std::string to_string( const T& n );
 
-    template<typename KeyType, typename ValueType>
-    std::map<KeyType, std::pair<ValueType, ValueType> > IntersectMaps(
-                    const std::map<KeyType, ValueType>& m1,
-                    const std::map<KeyType, ValueType>& m2 );
+    template<typename KeyType, typename ValueType, typename Compare, typename Alloc>
+    std::map<KeyType, std::pair<ValueType, ValueType>, Compare> IntersectMaps(
+                    const std::map<KeyType, ValueType, Compare, Alloc>& m1,
+                    const std::map<KeyType, ValueType, Compare, Alloc>& m2 );
+
+    //-----------------------------Sorted Ranges---------------------------------//
+    // compare( a, b ) returns a negative, zero or positive int as the key of a
+    // is less than, equal to or greater than the key of b, for elements of
+    // either range. Equal keys are matched one to one in order, as
+    // std::set_intersection does, so ranges of unique keys match once per key.
+
+    /**
+        \fn MergeJoin
+        \brief Walks two sorted ranges once, calling back for every element by the side it is on.
+        Only reads each element once in order, so input iterators over sorted
+        runs on disk work as well as containers.
+        @param first1 start of the first range
+        @param last1 end of the first range
+        @param first2 start of the second range
+        @param last2 end of the second range
+        @param compare three-way key comparison
+        @param on_both called with ( a, b ) for matched elements
+        @param on_first called with ( a ) for elements of the first range only
+        @param on_second called with ( b ) for elements of the second range only
+    */
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnBoth, typename OnFirst,
+             typename OnSecond>
+    void MergeJoin( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                    OnBoth on_both, OnFirst on_first, OnSecond on_second );
+
+    /**
+        \fn IntersectSorted
+        \brief Calls back with ( a, b ) for the elements of two sorted ranges with equal keys.
+    */
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnMatch>
+    void IntersectSorted( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                          OnMatch on_match );
+
+    /**
+        \fn DifferenceSorted
+        \brief Calls back with ( a ) for the elements of the first sorted range missing from the second, ex. orphan mates.
+    */
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnMissing>
+    void DifferenceSorted( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                           OnMissing on_missing );
+
+    /**
+        \fn UnionSorted
+        \brief Calls back with ( a, b ) for every key of two sorted ranges, a or b NULL on the side it is missing from.
+    */
+    template<typename InputIt1, typename InputIt2, typename Compare, typename OnKey>
+    void UnionSorted( InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, Compare compare,
+                      OnKey on_key );
+
+    /**
+        \fn ParallelMergeJoin
+        \brief MergeJoin on threads, each over one partition of the key space.
+        The first range is cut into num_parts pieces, moved back to the start
+        of a run of equal keys, and the second range is cut at the same keys
+        by binary search. Callbacks run concurrently and take the partition
+        index first, partitions cover increasing keys, so results gathered per
+        partition and concatenated are in key order.
+        @param first1 start of the first range
+        @param last1 end of the first range
+        @param first2 start of the second range
+        @param last2 end of the second range
+        @param compare three-way key comparison
+        @param num_parts number of partitions and threads
+        @param on_both called with ( part, a, b )
+        @param on_first called with ( part, a )
+        @param on_second called with ( part, b )
+    */
+    template<typename RandomIt1, typename RandomIt2, typename Compare, typename OnBoth, typename OnFirst,
+             typename OnSecond>
+    void ParallelMergeJoin( RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, RandomIt2 last2,
+                            Compare compare, size_t num_parts, OnBoth on_both, OnFirst on_first,
+                            OnSecond on_second );
+
+    /**
+        \fn ParallelIntersectSorted
+        \brief Calls back with ( part, a, b ) for the elements of two sorted ranges with equal keys, on threads.
+    */
+    template<typename RandomIt1, typename RandomIt2, typename Compare, typename OnMatch>
+    void ParallelIntersectSorted( RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, RandomIt2 last2,
+                                  Compare compare, size_t num_parts, OnMatch on_match );
+
+    //------------------------------Hash Tables----------------------------------//
+    /**
+        \fn ProbeHashed
+        \brief Looks up the key of every element of a range in a hash table, on threads.
+        The range is cut into num_parts pieces, each probing the table on its
+        own thread, so the table's find must be safe to call concurrently, as
+        for a std::unordered_map that is not changed meanwhile.
+        @param first start of the range
+        @param last end of the range
+        @param table table with find and end, ex. std::unordered_map
+        @param key_of returns the key of an element
+        @param num_parts number of partitions and threads
+        @param on_match called with ( part, element, table entry )
+        @param on_missing called with ( part, element ) for keys not in the table
+    */
+    template<typename RandomIt, typename Table, typename KeyOf, typename OnMatch, typename OnMissing>
+    void ProbeHashed( RandomIt first, RandomIt last, const Table& table, KeyOf key_of, size_t num_parts,
+                      OnMatch on_match, OnMissing on_missing );
+
+    /**
+        \fn IntersectHashed
+        \brief Calls back with ( part, element, table entry ) for the elements whose key is in the table.
+    */
+    template<typename RandomIt, typename Table, typename KeyOf, typename OnMatch>
+    void IntersectHashed( RandomIt first, RandomIt last, const Table& table, KeyOf key_of, size_t num_parts,
+                          OnMatch on_match );
+
+    /**
+        \fn DifferenceHashed
+        \brief Calls back with ( part, element ) for the elements whose key is not in the table.
+    */
+    template<typename RandomIt, typename Table, typename KeyOf, typename OnMissing>
+    void DifferenceHashed( RandomIt first, RandomIt last, const Table& table, KeyOf key_of, size_t num_parts,
+                           OnMissing on_missing );
 }
 
 #include "Utilities.cpp"
@@ -0,0 +1,123 @@
+/*! \file NGSXBenchLineScanner.cpp
+    NGSXBenchLineScanner Benchmark: Fastq tokenizing throughput.
+    \verbinclude NGSXBenchLineScanner.cpp
+*/
+
+/*
+    NGSXBenchLineScanner: Compares the std::getline loop the modules used to
+    read fastq files with the LineScanner newline sweep at every instruction
+    set the CPU supports, and with full FastQReader record parsing.
+*/
+
+//----------------------------System Include----------------------------------//
+#include <iostream>           // Input and output to screen
+#include <string>             // String
+#include <vector>             // Newline tables
+#include <fstream>            // File input
+#include <sstream>            // In-memory getline input
+#include <chrono>             // Timing
+#include <iomanip>            // Set Precision
+#include <cstdlib>            // atoi
+
+//----------------------------Custom Include----------------------------------//
+#include "FastQ.h"            // FastQView
+#include "FastQReader.h"      // Record parsing
+#include "LineScanner.h"      // Vectorized newline search
+
+// Prints one benchmark line, throughput in GB/s of input
+static void printResult( const std::string& name, size_t num_bytes, double seconds,
+                         size_t result )
+{
+    std::cout << std::left << std::setw( 28 ) << name << std::right << std::fixed <<
+              std::setprecision( 2 ) << std::setw( 8 ) << num_bytes / seconds / 1e9 << " GB/s" <<
+              "\t(" << result << ")" << std::endl;
+}
+
+//---------------------------------Main---------------------------------------//
+int main( int argc, char* argv[] )
+{
+    //-----------------------------Usage--------------------------------------//
+    if ( argc < 2 || argc > 3 )
+    {
+        std::cerr << "Usage: " << argv[0] << " [input fastq file] [repeats]" << std::endl;
+        return 1;
+    }
+
+    int num_repeats = argc == 3 ? atoi( argv[2] ) : 5;
+    std::ifstream input_file( argv[1], std::ios::binary );
+    std::ostringstream file_contents;
+    std::string data;
+    std::vector<uint32_t> newlines;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<double> elapsed;
+    size_t result;
+
+    if ( input_file.fail() || num_repeats < 1 )
+    {
+        std::cerr << "ERROR: Cannot open input fastq file: " << argv[1] << std::endl;
+        return 1;
+    }
+    file_contents << input_file.rdbuf();
+    data = file_contents.str();
+
+    std::cout << "Input: " << data.size() << " bytes, best instruction set: " <<
+              LineScanner::getLevelName( LineScanner::getBestLevel() ) << "\n" << std::endl;
+
+    //--------------------------getline Baseline-------------------------------//
+    {
+        std::string line;
+        result = 0;
+        start = std::chrono::steady_clock::now();
+        for ( int r = 0; r < num_repeats; r++ )
+        {
+            std::istringstream stream( data );
+            while ( std::getline( stream, line ) )
+            {
+                result++;
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( "std::getline lines", data.size() * num_repeats, elapsed.count(),
+                     result / num_repeats );
+    }
+
+    //--------------------------Newline Sweeps---------------------------------//
+    for ( int level = LineScanner::SCALAR; level <= LineScanner::AVX512; level++ )
+    {
+        if ( !LineScanner::isSupported( LineScanner::Level( level ) ) )
+        {
+            continue;
+        }
+        LineScanner::setLevel( LineScanner::Level( level ) );
+
+        start = std::chrono::steady_clock::now();
+        for ( int r = 0; r < num_repeats; r++ )
+        {
+            LineScanner::findNewlines( data.data(), data.size(), newlines );
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( std::string( "findNewlines " ) + LineScanner::getLevelName(
+                                     LineScanner::Level( level ) ), data.size() * num_repeats,
+                     elapsed.count(), newlines.size() );
+
+        // Whole records, as the modules read them
+        FastQReader::FastQReader reader;
+        FastQ::FastQView record;
+        result = 0;
+        start = std::chrono::steady_clock::now();
+        for ( int r = 0; r < num_repeats; r++ )
+        {
+            reader.openBuffer( data.data(), data.size() );
+            while ( reader.nextRecord( record ) )
+            {
+                result++;
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( std::string( "FastQReader records " ) + LineScanner::getLevelName(
+                                     LineScanner::Level( level ) ), data.size() * num_repeats,
+                     elapsed.count(), result / num_repeats );
+    }
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*! \file NGSXBenchQualityKernel.cpp
+    NGSXBenchQualityKernel Benchmark: Per-read cost of quality threshold counting.
+    \verbinclude NGSXBenchQualityKernel.cpp
+*/
+
+/*
+    NGSXBenchQualityKernel: Compares the per-base loop the quality control
+    modules used, including its original form that copied the quality string
+    for every base, with the QualityKernel sweep at every instruction set the
+    CPU supports. Every level is checked against the scalar count. The
+    expected errors of each read, as --keep best-quality ranks duplicates, are
+    timed the same way against a std::pow per base.
+*/
+
+//----------------------------System Include----------------------------------//
+#include <iostream>           // Input and output to screen
+#include <string>             // String
+#include <vector>             // Quality lines
+#include <chrono>             // Timing
+#include <iomanip>            // Set Precision
+#include <cstdlib>            // atoi
+#include <cmath>              // pow
+
+//----------------------------Custom Include----------------------------------//
+#include "FastQ.h"            // FastQView
+#include "FastQReader.h"      // Record parsing
+#include "LineScanner.h"      // Instruction set levels
+#include "QualityKernel.h"    // Vectorized quality threshold counting
+
+// Prints one benchmark line, cost in nanoseconds per read
+static void printResult( const std::string& name, size_t num_reads, double seconds,
+                         size_t result )
+{
+    std::cout << std::left << std::setw( 32 ) << name << std::right << std::fixed <<
+              std::setprecision( 1 ) << std::setw( 10 ) << seconds / num_reads * 1e9 << " ns/read" <<
+              "\t(" << result << ")" << std::endl;
+}
+
+//---------------------------------Main---------------------------------------//
+int main( int argc, char* argv[] )
+{
+    //-----------------------------Usage--------------------------------------//
+    if ( argc < 2 || argc > 4 )
+    {
+        std::cerr << "Usage: " << argv[0] << " [input fastq file] [repeats] [threshold]" <<
+                  std::endl;
+        return 1;
+    }
+
+    int num_repeats = argc >= 3 ? atoi( argv[2] ) : 5;
+    int threshold = argc == 4 ? atoi( argv[3] ) : 33 + 20;
+    FastQReader::FastQReader reader;
+    FastQ::FastQView record;
+    std::vector<std::string_view> qualities;
+    std::vector<size_t> expected;
+    std::vector<uint64_t> expected_errors;
+    double total_errors;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<double> elapsed;
+    size_t num_bases = 0;
+    size_t num_copied;
+    size_t num_wrong;
+    size_t result;
+
+    if ( !reader.open( argv[1] ) || num_repeats < 1 )
+    {
+        std::cerr << "ERROR: Cannot open input fastq file: " << argv[1] << std::endl;
+        return 1;
+    }
+    while ( reader.nextRecord( record ) )
+    {
+        qualities.push_back( record.quality );
+        num_bases += record.quality.size();
+    }
+    if ( qualities.empty() )
+    {
+        std::cerr << "ERROR: No reads in input fastq file: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Input: " << qualities.size() << " reads, " << num_bases / qualities.size() <<
+              " bases per read, best instruction set: " <<
+              LineScanner::getLevelName( LineScanner::getBestLevel() ) << "\n" << std::endl;
+
+    //--------------------------Per-Base Baselines------------------------------//
+    {
+        // The quality string was copied once per base, only a sample of reads is timed
+        num_copied = qualities.size() < 10000 ? qualities.size() : 10000;
+        result = 0;
+        start = std::chrono::steady_clock::now();
+        for ( size_t r = 0; r < num_copied; r++ )
+        {
+            for ( size_t i = 0; i < qualities[r].size(); i++ )
+            {
+                result += int( std::string( qualities[r] )[i] ) >= threshold;
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( "copy per base (sampled)", num_copied, elapsed.count(), result );
+
+        expected.resize( qualities.size() );
+        result = 0;
+        start = std::chrono::steady_clock::now();
+        for ( int n = 0; n < num_repeats; n++ )
+        {
+            for ( size_t r = 0; r < qualities.size(); r++ )
+            {
+                expected[r] = 0;
+                for ( size_t i = 0; i < qualities[r].size(); i++ )
+                {
+                    expected[r] += int( qualities[r][i] ) >= threshold;
+                }
+                result += expected[r];
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( "per-base loop", qualities.size() * num_repeats, elapsed.count(),
+                     result / num_repeats );
+    }
+
+    //----------------------------Kernel Sweeps--------------------------------//
+    for ( int level = LineScanner::SCALAR; level <= LineScanner::AVX512; level++ )
+    {
+        if ( !LineScanner::isSupported( LineScanner::Level( level ) ) )
+        {
+            continue;
+        }
+        QualityKernel::setLevel( LineScanner::Level( level ) );
+
+        result = 0;
+        start = std::chrono::steady_clock::now();
+        for ( int n = 0; n < num_repeats; n++ )
+        {
+            for ( size_t r = 0; r < qualities.size(); r++ )
+            {
+                result += QualityKernel::countAboveThreshold( qualities[r], threshold );
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( std::string( "countAboveThreshold " ) + LineScanner::getLevelName(
+                                     LineScanner::Level( level ) ), qualities.size() * num_repeats,
+                     elapsed.count(), result / num_repeats );
+
+        num_wrong = 0;
+        for ( size_t r = 0; r < qualities.size(); r++ )
+        {
+            num_wrong += QualityKernel::countAboveThreshold( qualities[r], threshold ) != expected[r];
+        }
+        if ( num_wrong > 0 )
+        {
+            std::cerr << "ERROR: " << num_wrong << " reads counted differently at " <<
+                      LineScanner::getLevelName( LineScanner::Level( level ) ) << std::endl;
+            return 1;
+        }
+    }
+
+    //--------------------------Expected Errors---------------------------------//
+    {
+        total_errors = 0;
+        start = std::chrono::steady_clock::now();
+        for ( size_t r = 0; r < qualities.size(); r++ )
+        {
+            for ( size_t i = 0; i < qualities[r].size(); i++ )
+            {
+                total_errors += std::pow( 10.0, -( qualities[r][i] - 33 ) / 10.0 );
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( "pow per base", qualities.size(), elapsed.count(), size_t( total_errors ) );
+    }
+
+    for ( int level = LineScanner::SCALAR; level <= LineScanner::AVX512; level++ )
+    {
+        if ( !LineScanner::isSupported( LineScanner::Level( level ) ) )
+        {
+            continue;
+        }
+        QualityKernel::setLevel( LineScanner::Level( level ) );
+
+        result = 0;
+        start = std::chrono::steady_clock::now();
+        for ( int n = 0; n < num_repeats; n++ )
+        {
+            for ( size_t r = 0; r < qualities.size(); r++ )
+            {
+                result += QualityKernel::sumErrorProbabilities( qualities[r], 33 );
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        printResult( std::string( "sumErrorProbabilities " ) + LineScanner::getLevelName(
+                                     LineScanner::Level( level ) ), qualities.size() * num_repeats,
+                     elapsed.count(), result / num_repeats / QualityKernel::ERROR_SCALE );
+
+        // Sums are integers, every level must match the scalar one exactly
+        num_wrong = 0;
+        for ( size_t r = 0; r < qualities.size(); r++ )
+        {
+            if ( level == LineScanner::SCALAR )
+            {
+                expected_errors.push_back( QualityKernel::sumErrorProbabilities( qualities[r], 33 ) );
+            }
+            num_wrong += QualityKernel::sumErrorProbabilities( qualities[r], 33 ) != expected_errors[r];
+        }
+        if ( num_wrong > 0 )
+        {
+            std::cerr << "ERROR: " << num_wrong << " reads summed differently at " <<
+                      LineScanner::getLevelName( LineScanner::Level( level ) ) << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -17,12 +17,18 @@
 #include <iomanip>         // Set Precision
 #include <fstream>         // File input and output
 #include <algorithm>       // To use the count function
+#include <vector>          // Matched ids sorted for output
 
 //----------------------------Custom Include----------------------------------//
 #include "FastQ.h"         // FastQ object
+#include "FastQReader.h"   // Memory-mapped or gzip fastq reader
 #include "TextColor.h"     // Unix shell colored output
 #include "ProgressLog.h"   // ProgressLog Class
-#include "Utilities.h"     // Requires IntersectMaps function
+#include "FastQWriter.h"   // Batched fastq output, optionally compressed
+#include "Utilities.h"     // Requires IntersectSorted function
+#include "PackedSeq.h"     // 2 bit packed record storage
+#include "Arena.h"         // Block allocated map nodes
+#include "RecordIndex.h"   // Id to offset index of a mapped fastq
 
 //---------------------------------Main---------------------------------------//
 int main( int argc, char* argv[] )
@@ -35,12 +41,16 @@ int main( int argc, char* argv[] )
                     +
 
                     "\n\tYou must specify two fastq files :\n" +
-                    "\t\t" + "--fq1-in" + "\t\t" + "First fastq" + "\n" +
+                    "\t\t" + "--fq1-in" + "\t\t" + "First fastq, - for standard input" + "\n" +
                     "\t\t" + "--fq2-in" + "\t\t" + "Second  fastq file" + "\n" +
                     "\n\tYou must specify two fastq files :\n" +
                     "\t\t" + "--fq1-out" + "\t\t" + "Output first fastq file " + "\n" +
                     "\t\t" + "--fq2-out" + "\t\t" + "Output second fastq file " + "\n" +
-                    "\t\t" + "--stats" + "\t\t" + "Output stats file " + "\n\n";
+                    "\t\t\t\t\t" + "One of the outputs may be -, for standard output" + "\n" +
+                    "\t\t" + "--stats" + "\t\t" + "Output stats file " + "\n" +
+                    "\n\tOptional:\n" +
+                    "\t\t" + "--sorted" + "\t\t" +
+                    "Both inputs are sorted by id (LC_ALL=C sort -k1,1 -t \" \"), merge them in constant memory" + "\n\n";
 
     //-------------------------------Help Parsing-------------------------------//
 
@@ -49,7 +59,7 @@ int main( int argc, char* argv[] )
                     ( argc == 2 && std::string( argv[1] ) == "-help" ) ||
                     ( argc == 2 && std::string( argv[1] ) == "--help" ) ||
                     ( argc < 11 ) ||
-                    ( argc > 11 ) )
+                    ( argc > 12 ) )
     {
         std::cout << "Usage:" << std::endl;
         std::cout << "" << std::endl;
@@ -67,30 +77,28 @@ int main( int argc, char* argv[] )
     std::string stats_file_name;                   // Output stats file
 
     // Input file streams
-    std::ifstream input_first_fastq_file;          // Input file streams
-    std::ifstream input_second_fastq_file;
-    std::ifstream fastq_file_copy_first;           // Copy for counting lines
-    std::ifstream fastq_file_copy_second;
+    FastQReader::FastQReader input_first_fastq_reader;   // Input readers
+    FastQReader::FastQReader input_second_fastq_reader;
     // Output file streams
-    std::ofstream output_first_fastq_file;         // Output file streams
-    std::ofstream output_second_fastq_file;
+    FastQWriter::FastQPairedWriter output_fastq_files;  // Output first and second file streams
     std::ofstream stats_file;
 
-    // Fastq lines
-    std::string current_line;                      // Strings for FastQ
-    std::string temp_id;
-    std::string temp_seq;
-    std::string temp_line3;
-    std::string temp_qual;
+    FastQ::FastQView temp_fastq;                   // Current record view
 
+    // Packed copies of the reads, keys view the stored ids
+    PackedSeq::PackedSeq reads_forward;
+    PackedSeq::PackedSeq reads_reverse;
+    PackedSeq::Ref temp_record;
+    std::string record_buffer_forward;            // Unpacked records being written
+    std::string record_buffer_reverse;
+    FastQ::FastQView temp_fastq_reverse;
 
-    FastQ::FastQ temp_fastq;                       // Temporary FastQ
-
-    // Associative arrays
-    std::map<std::string, FastQ::FastQ> map_reads_forward;
-    std::map<std::string, FastQ::FastQ> map_reads_reverse;
-    std::map<std::string, std::pair<FastQ::FastQ, FastQ::FastQ> >
-    map_properly_paired;                          // Map to hold paired sequence
+    // Associative arrays, nodes drawn from an arena
+    typedef std::map<std::string_view, PackedSeq::Ref, std::less<std::string_view>,
+            Arena::ArenaAllocator<std::pair<const std::string_view, PackedSeq::Ref> > > ReadMap;
+    Arena::Arena node_arena;
+    ReadMap map_reads_forward( node_arena );
+    ReadMap map_reads_reverse( node_arena );
 
     // Colored text and progress log
     TextColor::TextColor
@@ -98,20 +106,57 @@ int main( int argc, char* argv[] )
     ProgressLog::ProgressLog fastq_progress_log_first; // ProgressLog
     ProgressLog::ProgressLog fastq_progress_log_second;
 
-    int total_num_lines;                          // Lines in the copy file
-    int total_num_records_first;
-    int total_num_records_second;
-    int total_num_records;                        // Sequences in copy file
+    int total_num_records_first = 0;
+    int total_num_records_second = 0;
+    int total_num_records;                        // Sequences in both files
     int final_num_seq;                            // Number of paired sequences
     float percent_paired;                         // Percent of input sequences
-    std::map<std::string, std::pair<FastQ::FastQ, FastQ::FastQ> >::iterator it;
+    std::pair<ReadMap::iterator, bool> inserted;
+
+    // Offsets of the records of the mapped mate by id, the other mate is
+    // streamed against it and only its matches are kept
+    RecordIndex::RecordIndex indexed_ids;
+    bool index_second;                            // The second mate is indexed
+    std::vector<uint64_t> matched_offsets;        // Offset + 1 of each slot's match, mapped
+    std::vector<PackedSeq::Ref> matched_records;  // Packed match of each slot, streamed
+    PackedSeq::PackedSeq streamed_records;
+    std::vector<std::pair<std::string_view, size_t> > matched_ids;
+    FastQReader::FastQReader matched_reader;      // Parses matches read back
+    size_t slot;
+
+    // Sorted inputs are merged, each cursor holds the last record of its
+    // current id, the next record read ahead is checked for order
+    bool sorted_input = false;                    // --sorted, inputs are sorted by id
+    bool inputs_sorted = true;                    // No id out of order was found
+    bool intersected = false;                     // The merge wrote the output
+    FastQ::FastQ run_first;                       // Current record of each input
+    FastQ::FastQ run_second;
+    FastQ::FastQView next_first;                  // Next record of each input
+    FastQ::FastQView next_second;
+    bool has_next_first;
+    bool has_next_second;
+    bool has_run_first;
+    bool has_run_second;
+    int id_order;
 
     //------------------------------Arg Parsing------------------------------//
 
-    for ( int i = 1; i < ( argc - 1 ); i++ ) //all but last argument (file)
+    for ( int i = 1; i < argc; i++ )
     {
 
-        if ( std::string( argv[i] ) == "--fq1-in" )
+        if ( std::string( argv[i] ) == "--sorted" )
+        {
+            sorted_input = true;
+            continue;
+        }
+
+        else if ( i == argc - 1 )
+        {
+            std::cerr << "Missing value for option " << argv[i] << " exiting" << std::endl;
+            return 1;
+        }
+
+        else if ( std::string( argv[i] ) == "--fq1-in" )
         {
             input_file_name_first_fastq = std::string( argv[i + 1] );
             i++;
@@ -154,40 +199,41 @@ int main( int argc, char* argv[] )
 
     }
 
+    // Fastq records go to standard output, so messages go to standard error
+    if ( OutputStream::OutputStream::isStandardOutput( output_file_name_first_fastq ) ||
+                    OutputStream::OutputStream::isStandardOutput( output_file_name_second_fastq ) )
+    {
+        std::cout.rdbuf( std::cerr.rdbuf() );
+    }
+
     //----------------------------------Open Files----------------------------//
 
     // open requires parameter to be a const char*
-    input_first_fastq_file.open( input_file_name_first_fastq.c_str() );
-    input_second_fastq_file.open( input_file_name_second_fastq.c_str() );
-    fastq_file_copy_first.open( input_file_name_first_fastq.c_str() );
-    fastq_file_copy_second.open( input_file_name_second_fastq.c_str() );
-    output_first_fastq_file.open( output_file_name_first_fastq.c_str() );
-    output_second_fastq_file.open( output_file_name_second_fastq.c_str() );
     stats_file.open( stats_file_name.c_str() );
 
     // Check if files can be opened properly
-    if ( input_first_fastq_file.fail() )
+    if ( !input_first_fastq_reader.open( input_file_name_first_fastq ) )
     {
         std::cerr << "ERROR: Cannot open input first fastq file: " <<
                         input_file_name_first_fastq << std::endl;
         return 1;
     }
 
-    if ( input_second_fastq_file.fail() )
+    if ( !input_second_fastq_reader.open( input_file_name_second_fastq ) )
     {
         std::cerr << "ERROR: Cannot open input second fastq file: " <<
                         input_file_name_second_fastq << std::endl;
         return 1;
     }
 
-    if ( output_first_fastq_file.fail() )
+    if ( !output_fastq_files.getFirst().open( output_file_name_first_fastq ) )
     {
         std::cerr << "ERROR: Cannot open output first fastq file: " <<
                         output_file_name_first_fastq << std::endl;
         return 1;
     }
 
-    if ( output_second_fastq_file.fail() )
+    if ( !output_fastq_files.getSecond().open( output_file_name_second_fastq ) )
     {
         std::cerr << "ERROR: Cannot open output second fastq file: " <<
                         output_file_name_second_fastq << std::endl;
@@ -205,105 +251,349 @@ int main( int argc, char* argv[] )
                     "\nBeginning the NGSX NGSXFastQIntersect Module.\n" <<  Palette.RESET <<
                     std::endl;
 
-    // Count the number of sequences in the input file (using the copy)
-    std::cout <<
-                    "Initializing first fastq file and counting the number of sequences (This may take a while)."
-                    << std::endl;
-    total_num_lines = std::count( std::istreambuf_iterator<char>
-                                    ( fastq_file_copy_first ), std::istreambuf_iterator<char>(), '\n' ) + 1;
-    total_num_records_first = total_num_lines / 4;
-    std::cout << "First input fastq file contains " << total_num_records_first <<
-                    " sequences." << std::endl;
-
-    std::cout <<
-                    "Initializing second fastq file and counting the number of sequences (This may take a while)."
-                    << std::endl;
-    total_num_lines = std::count( std::istreambuf_iterator<char>
-                                    ( fastq_file_copy_second ), std::istreambuf_iterator<char>(), '\n' ) + 1;
-    total_num_records_second = total_num_lines / 4;
-    std::cout << "Second input fastq file contains " << total_num_records_second <<
-                    " sequences." << std::endl;
-
-    total_num_records = total_num_records_first + total_num_records_second;
-
-    //----------------------Stores Sequences in Map--------------------------//
-    std::cout << "Analyzing forward reads." << std::endl;
-    fastq_progress_log_first.initLog( total_num_records_first );  // Init log
-
-    // First fastq
-    while ( std::getline( input_first_fastq_file, current_line ) )
+    // Records are read back from the mapped files or packed, so the inputs need
+    // not stay in memory
+    input_first_fastq_reader.setRetainBuffers( false );
+    input_second_fastq_reader.setRetainBuffers( false );
+
+    //--------------------------Merge Sorted Inputs---------------------------//
+    // Ids are ordered as LC_ALL=C sort -k1,1 -t " " orders them, up to the
+    // first space: "@A.B/1" comes before "@A/1" though the read name "@A.B" is
+    // after "@A". A mate suffix "/1" or "/2" is cut to "/", so mates share a key
+    auto getSortKey = []( std::string_view id )
     {
-        temp_id = current_line;
-        std::getline( input_first_fastq_file, temp_seq );   // Sequence
-        std::getline( input_first_fastq_file, temp_line3 ); // Ambiguous
-        std::getline( input_first_fastq_file, temp_qual );  // Qality
+        std::string_view key = id.substr( 0, id.find_first_of( " \t" ) );
 
-        temp_fastq.setRecord( temp_id,
-                        temp_seq,
-                        temp_line3,
-                        temp_qual );
+        return FastQ::getReadName( key ).size() < key.size() ? key.substr( 0, key.size() - 1 ) : key;
+    };
 
+    // Reads up to the next id of one input, whose last record is kept as the
+    // maps did, and checks that the ids are sorted
+    auto nextRun = [&]( FastQReader::FastQReader & reader, FastQ::FastQ & run, FastQ::FastQView & next,
+                        bool& has_next, int& num_records )
+    {
+        if ( !has_next )
+        {
+            return false;
+        }
+        run.setRecord( next );
+        while ( ( has_next = reader.nextRecord( next ) ) )
+        {
+            num_records++;
+            int next_order = getSortKey( next.id ).compare( getSortKey( run.getID() ) );
+            if ( next_order > 0 )
+            {
+                break;
+            }
+            if ( next_order < 0 )
+            {
+                inputs_sorted = false;
+                return false;
+            }
+            run.setRecord( next );
+        }
+        return true;
+    };
 
-        map_reads_forward[temp_id] = temp_fastq;           // Add record to map
+    if ( sorted_input )
+    {
+        std::cout << "Merging reads sorted by id." << std::endl;
+        fastq_progress_log_first.initLogBytes( input_file_name_first_fastq );
+        has_next_first = input_first_fastq_reader.nextRecord( next_first );
+        has_next_second = input_second_fastq_reader.nextRecord( next_second );
+        total_num_records_first = has_next_first;
+        total_num_records_second = has_next_second;
+        has_run_first = nextRun( input_first_fastq_reader, run_first, next_first, has_next_first,
+                                 total_num_records_first );
+        has_run_second = nextRun( input_second_fastq_reader, run_second, next_second, has_next_second,
+                                  total_num_records_second );
+        final_num_seq = 0;
+
+        // Both cursors advance past the lesser id, equal ids are written at once
+        while ( has_run_first && has_run_second )
+        {
+            // Ids with and without a mate suffix are not sorted alike
+            if ( ( getSortKey( run_first.getID() ).size() > FastQ::getReadName( run_first.getID() ).size() ) !=
+                            ( getSortKey( run_second.getID() ).size() > FastQ::getReadName( run_second.getID() ).size() ) )
+            {
+                inputs_sorted = false;
+                break;
+            }
+            id_order = getSortKey( run_first.getID() ).compare( getSortKey( run_second.getID() ) );
+            if ( id_order == 0 )
+            {
+                output_fastq_files.write( run_first.getView(), run_second.getView() );
+                final_num_seq++;
+            }
+            if ( id_order <= 0 )
+            {
+                has_run_first = nextRun( input_first_fastq_reader, run_first, next_first, has_next_first,
+                                         total_num_records_first );
+            }
+            if ( id_order >= 0 )
+            {
+                has_run_second = nextRun( input_second_fastq_reader, run_second, next_second, has_next_second,
+                                          total_num_records_second );
+            }
+            fastq_progress_log_first.updateLogBytes( input_first_fastq_reader.getInputOffset() );
+        }
 
-        // Completed reading 1 sequence record
-        fastq_progress_log_first.incrementLog( 1 );
+        // The rest of the longer input is only counted and checked
+        while ( has_run_first )
+        {
+            has_run_first = nextRun( input_first_fastq_reader, run_first, next_first, has_next_first,
+                                     total_num_records_first );
+        }
+        while ( has_run_second )
+        {
+            has_run_second = nextRun( input_second_fastq_reader, run_second, next_second, has_next_second,
+                                      total_num_records_second );
+        }
+        fastq_progress_log_first.completeLog( total_num_records_first );
+        if ( input_first_fastq_reader.fail() || input_second_fastq_reader.fail() )
+        {
+            return 1;
+        }
+        total_num_records = total_num_records_first + total_num_records_second;
+        intersected = inputs_sorted;
+
+        // Unsorted files are read again from the start, which a pipe cannot be
+        if ( !inputs_sorted && ( InputStream::InputStream::isStandardInput( input_file_name_first_fastq ) ||
+                                 InputStream::InputStream::isStandardInput( input_file_name_second_fastq ) ||
+                                 OutputStream::OutputStream::isStandardOutput( output_file_name_first_fastq ) ||
+                                 OutputStream::OutputStream::isStandardOutput( output_file_name_second_fastq ) ) )
+        {
+            std::cerr << "ERROR: Input fastq files are not sorted by id, and cannot be read again from a pipe"
+                      << std::endl;
+            return 1;
+        }
+        if ( !inputs_sorted )
+        {
+            std::cout << "Input fastq files are not sorted by id, intersecting them unsorted." << std::endl;
+            total_num_records_first = 0;
+            total_num_records_second = 0;
+            if ( !output_fastq_files.close() || !output_fastq_files.getFirst().open( output_file_name_first_fastq ) ||
+                            !output_fastq_files.getSecond().open( output_file_name_second_fastq ) ||
+                            !input_first_fastq_reader.open( input_file_name_first_fastq ) ||
+                            !input_second_fastq_reader.open( input_file_name_second_fastq ) )
+            {
+                std::cerr << "ERROR: Cannot open the fastq files again." << std::endl;
+                return 1;
+            }
+            input_first_fastq_reader.setRetainBuffers( false );
+            input_second_fastq_reader.setRetainBuffers( false );
+        }
     }
 
-    std::cout << "Forward read analysis complete." << std::endl;
+    // Pairs were written while merging sorted inputs
+    if ( !intersected && ( input_first_fastq_reader.isMapped() || input_second_fastq_reader.isMapped() ) )
+    {
+        //----------------------Index One Mate by Id--------------------------//
+        index_second = !input_first_fastq_reader.isMapped();
+        FastQReader::FastQReader& indexed_reader = index_second ? input_second_fastq_reader :
+                        input_first_fastq_reader;
+        FastQReader::FastQReader& streamed_reader = index_second ? input_first_fastq_reader :
+                        input_second_fastq_reader;
+        int& total_num_records_indexed = index_second ? total_num_records_second :
+                                         total_num_records_first;
+        int& total_num_records_streamed = index_second ? total_num_records_first :
+                                          total_num_records_second;
+
+        std::cout << "Indexing " << ( index_second ? "reverse" : "forward" ) << " reads." << std::endl;
+        fastq_progress_log_first.initLogBytes( index_second ? input_file_name_second_fastq :
+                                               input_file_name_first_fastq );
+        indexed_ids.setData( indexed_reader.getData(), indexed_reader.getSize() );
+
+        // Repeated id, the last record is kept
+        while ( indexed_reader.nextRecord( temp_fastq ) )
+        {
+            indexed_ids.insert( temp_fastq );
 
-    // Second fastq
-    std::cout << "Analyzing reverse reads." << std::endl;
-    fastq_progress_log_second.initLog( total_num_records_second ); // Init log
+            // Completed reading 1 sequence record
+            total_num_records_indexed++;
+            fastq_progress_log_first.updateLogBytes( indexed_reader.getInputOffset() );
+        }
+        fastq_progress_log_first.completeLog( total_num_records_indexed );
 
-    while ( std::getline( input_second_fastq_file, current_line ) )
-    {
-        temp_id = current_line;
-        std::getline( input_second_fastq_file, temp_seq );
-        std::getline( input_second_fastq_file, temp_line3 );
-        std::getline( input_second_fastq_file, temp_qual );
+        //----------------------Stream the Other Mate-------------------------//
+        std::cout << "Matching " << ( index_second ? "forward" : "reverse" ) << " reads." << std::endl;
+        fastq_progress_log_second.initLogBytes( index_second ? input_file_name_first_fastq :
+                                                input_file_name_second_fastq );
+        if ( streamed_reader.isMapped() )
+        {
+            matched_offsets.assign( indexed_ids.getNumSlots(), 0 );
+        }
+        else
+        {
+            matched_records.assign( indexed_ids.getNumSlots(), NULL );
+        }
 
-        temp_fastq.setRecord( temp_id,
-                        temp_seq,
-                        temp_line3,
-                        temp_qual );
+        while ( streamed_reader.nextRecord( temp_fastq ) )
+        {
+            slot = indexed_ids.find( temp_fastq.id );
+
+            // Repeated id, the last record is kept
+            if ( slot != RecordIndex::RecordIndex::NOT_FOUND && streamed_reader.isMapped() )
+            {
+                matched_offsets[slot] = temp_fastq.id.data() - streamed_reader.getData() + 1;
+            }
+            else if ( slot != RecordIndex::RecordIndex::NOT_FOUND )
+            {
+                temp_record = streamed_records.add( temp_fastq );
+                matched_records[slot] = matched_records[slot] == NULL ? temp_record :
+                                        streamed_records.replace( matched_records[slot], temp_record );
+            }
+
+            // Completed reading 1 sequence record
+            total_num_records_streamed++;
+            fastq_progress_log_second.updateLogBytes( streamed_reader.getInputOffset() );
+        }
+        fastq_progress_log_second.completeLog( total_num_records_streamed );
+        if ( streamed_reader.fail() )
+        {
+            return 1;
+        }
 
+        total_num_records = total_num_records_first + total_num_records_second;
 
-        map_reads_reverse[temp_id] = temp_fastq;           // Add record to map
+        //---------------------------Write Paired Sequences-----------------------//
+        std::cout << "Writing paired sequences to file." << std::endl;
+        std::cout << "Id index: " << indexed_ids.getMemoryUsage() / ( 1024 * 1024 ) << " MB for " <<
+                  indexed_ids.size() << " ids" << std::endl;
+        final_num_seq = 0;
 
-        // Completed reading 1 sequence record
-        fastq_progress_log_second.incrementLog( 1 );
+        // Pairs are written in read name order, as the map intersection did
+        for ( slot = 0; slot < indexed_ids.getNumSlots(); slot++ )
+        {
+            if ( streamed_reader.isMapped() ? matched_offsets[slot] != 0 : matched_records[slot] != NULL )
+            {
+                matched_ids.push_back( std::make_pair( FastQ::getReadName( indexed_ids.getId( slot ) ),
+                                                       slot ) );
+            }
+        }
+        std::sort( matched_ids.begin(), matched_ids.end() );
+
+        for ( size_t i = 0; i < matched_ids.size(); i++ )
+        {
+            slot = matched_ids[i].second;
+            indexed_ids.getRecord( slot, temp_fastq );
+            if ( streamed_reader.isMapped() )
+            {
+                RecordIndex::readRecordAt( streamed_reader.getData(), streamed_reader.getSize(),
+                                           matched_offsets[slot] - 1, matched_reader, temp_fastq_reverse );
+            }
+            else
+            {
+                streamed_records.getRecord( matched_records[slot], record_buffer_reverse, temp_fastq_reverse );
+            }
+
+            // Both output files, flushed together
+            if ( index_second )
+            {
+                output_fastq_files.write( temp_fastq_reverse, temp_fastq );
+            }
+            else
+            {
+                output_fastq_files.write( temp_fastq, temp_fastq_reverse );
+            }
+
+            final_num_seq++;
+        }
     }
+    else if ( !intersected )
+    {
+        //----------------------Stores Sequences in Map--------------------------//
+        std::cout << "Analyzing forward reads." << std::endl;
+        fastq_progress_log_first.initLogBytes( input_file_name_first_fastq );
+
+        // First fastq
+        while ( input_first_fastq_reader.nextRecord( temp_fastq ) )
+        {
+            temp_record = reads_forward.add( temp_fastq );
+            inserted = map_reads_forward.insert( std::make_pair( FastQ::getReadName(
+                                                   PackedSeq::PackedSeq::getId( temp_record ) ), temp_record ) );  // Add record to map
+
+            // Repeated id, the last record is kept
+            if ( !inserted.second )
+            {
+                inserted.first->second = reads_forward.replace( inserted.first->second, temp_record );
+            }
+
+            // Completed reading 1 sequence record
+            total_num_records_first++;
+            fastq_progress_log_first.updateLogBytes( input_first_fastq_reader.getInputOffset() );
+        }
+        fastq_progress_log_first.completeLog( total_num_records_first );
+        if ( input_first_fastq_reader.fail() )
+        {
+            return 1;
+        }
+
+        std::cout << "Forward read analysis complete." << std::endl;
 
-    std::cout << "Reverse read analysis complete." << std::endl;
+        // Second fastq
+        std::cout << "Analyzing reverse reads." << std::endl;
+        fastq_progress_log_second.initLogBytes( input_file_name_second_fastq );
+
+        while ( input_second_fastq_reader.nextRecord( temp_fastq ) )
+        {
+            temp_record = reads_reverse.add( temp_fastq );
+            inserted = map_reads_reverse.insert( std::make_pair( FastQ::getReadName(
+                                                   PackedSeq::PackedSeq::getId( temp_record ) ), temp_record ) );  // Add record to map
+
+            // Repeated id, the last record is kept
+            if ( !inserted.second )
+            {
+                inserted.first->second = reads_reverse.replace( inserted.first->second, temp_record );
+            }
+
+            // Completed reading 1 sequence record
+            total_num_records_second++;
+            fastq_progress_log_second.updateLogBytes( input_second_fastq_reader.getInputOffset() );
+        }
+        fastq_progress_log_second.completeLog( total_num_records_second );
+        if ( input_second_fastq_reader.fail() )
+        {
+            return 1;
+        }
 
-    //---------------------------Write Unique Sequences-----------------------//
-    std::cout << "Writing paired sequences to file." << std::endl;
-    final_num_seq = 0;
+        std::cout << "Reverse read analysis complete." << std::endl;
 
-    // Use custom map intersection function to find
-    // properly paired reads
-    map_properly_paired = Utilities::IntersectMaps( map_reads_forward, map_reads_reverse );
+        total_num_records = total_num_records_first + total_num_records_second;
 
-    for ( it = map_properly_paired.begin(); it != map_properly_paired.end(); it++ )
-    {
-        // First output file
-        output_first_fastq_file << it->second.first.getID() << std::endl;
-        output_first_fastq_file << it->second.first.getSeq() << std::endl;
-        output_first_fastq_file << it->second.first.getLine3() << std::endl;
-        output_first_fastq_file << it->second.first.getQual() << std::endl;
-
-        // Second output file
-        output_second_fastq_file << it->second.second.getID() << std::endl;
-        output_second_fastq_file << it->second.second.getSeq() << std::endl;
-        output_second_fastq_file << it->second.second.getLine3() << std::endl;
-        output_second_fastq_file << it->second.second.getQual() << std::endl;
-
-        final_num_seq++;
+        //---------------------------Write Unique Sequences-----------------------//
+        std::cout << "Writing paired sequences to file." << std::endl;
+        final_num_seq = 0;
+
+        // Properly paired reads are written as the sorted maps are merged,
+        // without a third map of the pairs
+        Utilities::IntersectSorted( map_reads_forward.begin(), map_reads_forward.end(),
+                                    map_reads_reverse.begin(), map_reads_reverse.end(),
+                                    []( const ReadMap::value_type & a, const ReadMap::value_type & b )
+        {
+            return a.first.compare( b.first );
+        },
+        [&]( const ReadMap::value_type & a, const ReadMap::value_type & b )
+        {
+            reads_forward.getRecord( a.second, record_buffer_forward, temp_fastq );
+            reads_reverse.getRecord( b.second, record_buffer_reverse, temp_fastq_reverse );
+
+            // Both output files, flushed together
+            output_fastq_files.write( temp_fastq, temp_fastq_reverse );
+
+            final_num_seq++;
+        } );
     }
 
     percent_paired = final_num_seq / ( float )total_num_records * 100;
 
+    if ( !output_fastq_files.close() )
+    {
+        std::cerr << "ERROR: Cannot write output fastq files: " << output_file_name_first_fastq <<
+                        " and " << output_file_name_second_fastq << std::endl;
+        return 1;
+    }
+
     stats_file << "Total_Sequences\tPaired_Sequences\tPercent_Paired" << std::endl;
     stats_file << total_num_records << "\t" << final_num_seq << "\t" <<
                     std::setprecision( 4 ) << percent_paired << std::endl;
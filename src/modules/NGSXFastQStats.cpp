@@ -1,5 +1,5 @@
 /*! \file NGSXFastQStats.cpp
- * \brief Calculates length, quality, and GC content per read.
+ * \brief Calculates length, quality, and GC content per read, or aggregate statistics of all reads.
  *
  * \verbinclude FastQStats.cpp
  *
@@ -18,11 +18,17 @@
 #include <string>									  							// String
 #include <fstream>																// File input and output
 #include <algorithm>															// Counting
+#include <sstream>																// Per chunk output
+#include <vector>																	// Per chunk output
 
 //----------------------------Custom Include----------------------------------//
 #include "FastQ.h"                  // FastQ Class
+#include "FastQReader.h"            // Memory-mapped or gzip fastq reader
+#include "FastQBlockReader.h"       // Parallel chunked fastq reader
 #include "ProgressLog.h"						// ProgressLog Class
 #include "TextColor.h"						// Unix shell colored output
+#include "OutputStream.h"           // Buffered, optionally compressed output
+#include "ReadStats.h"              // Aggregate statistics
 
 
 //--------------------------------Main----------------------------------------//
@@ -33,9 +39,12 @@ int main(int argc, char* argv[])
 									"Usage:\n" +
 										"\t" +
 										std::string(argv[0]) +
-										" [input fastq file] [output stats file]\n\n" +
+										" [input fastq file] [output stats file] [options]\n" +
+										"\t" + "Either file may be - for standard input or output" + "\n\n" +
 									"Options:\n" +
-										"\t" + "TBD" + "\n\n";
+										"\t" + "--threads" + "\t" + "Number of threads used to parse the input [INT]" + "\n" +
+										"\t" + "--aggregate" + "\t" + "Write a FastQC style report of per-position qualities and base content, length, GC and quality histograms and duplication levels instead of a line per read" + "\n" +
+										"\t" + "--phred" + "\t\t" + "Quality encoding of --aggregate, 33 (default) or 64 [INT]" + "\n\n";
 
 
 	//---------------------------Help Message-----------------------------------//
@@ -53,49 +62,79 @@ int main(int argc, char* argv[])
 
   std::string input_fastq_file_name;
   input_fastq_file_name = argv[1];                                              /**Command Line Argument 1: Input fastq file. */
-  std::ifstream input_fastq_file;
-	std::ifstream input_fastq_file_copy;																					// Copy for counting the number of lines
+  FastQBlockReader::FastQBlockReader input_fastq_reader;                        // Parallel zero-copy reader of the input fastq file
 
   std::string output_stats_file_name;
   output_stats_file_name = argv[2];                                             /**Command Line Argument 2: Output stats file. */
-  std::ofstream output_stats_file;
+  OutputStream::OutputStream output_stats_file;                                 // Output stats file, may be standard output
 
-  int total_num_lines;																											  	// Number of lines in the copy fastq file
-  int total_num_records;																												// Number of records in the copy fastq file
-
-  std::string current_line;                                                     // Current line of the file that was read in.
+  int total_num_records = 0;																										// Number of records processed
 
 	TextColor::TextColor Palette;																									// TextColor object for coloring text output
   ProgressLog::ProgressLog fastq_progress_log;																  // ProgressLog object to store file processing progress.
-  FastQ::FastQ temp_fastq;								                                      // Temporary FastQ object to hold fastq information
-  std::string temp_id;
-  std::string temp_seq;
-	std::string temp_line3;
-  std::string temp_qual;
-
+  int num_threads = 1;                                                          // Number of parsing threads
+  std::vector<std::string> chunk_output;                                        // Formatted stats of each chunk slot
+  std::vector<int> chunk_num_records;                                           // Number of records in each chunk slot
+  bool aggregate = false;                                                       // Aggregate statistics instead of a line per read
+  int phred_offset = 33;                                                        // Quality encoding of the aggregate statistics
+  std::vector<ReadStats::ReadStats> slot_stats;                                 // Aggregate statistics of each chunk slot
+
+  //-------------------------------Arg Parsing--------------------------------//
+  for (int i = 3; i < argc; i++)
+  {
+    if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+    {
+      std::istringstream ss_threads(argv[i + 1]);
+      if (!(ss_threads >> num_threads))  std::cerr << "Invalid number of threads. " << argv[i + 1] << '\n';
+      i++;
+      continue;
+    }
+    if (std::string(argv[i]) == "--aggregate")
+    {
+      aggregate = true;
+      continue;
+    }
+    if (std::string(argv[i]) == "--phred" && i + 1 < argc)
+    {
+      std::istringstream ss_phred(argv[i + 1]);
+      if (!(ss_phred >> phred_offset) || (phred_offset != 33 && phred_offset != 64))
+      {
+        std::cerr << "ERROR: Invalid quality encoding for --phred: " << argv[i + 1] << std::endl;
+        return 1;
+      }
+      i++;
+      continue;
+    }
+    std::cerr << "Unknown option " << argv[i] << " exiting" << std::endl;
+    return 1;
+  }
 
+  if (OutputStream::OutputStream::isStandardOutput(output_stats_file_name))     // Stats go to standard output, messages to standard error
+  {
+    std::cout.rdbuf(std::cerr.rdbuf());
+  }
 
 
 
   //----------------------------Open Files------------------------------------//
 
-  input_fastq_file.open(input_fastq_file_name.c_str());													// Open input fastq file (open requires parameter to be a const char*)
-	input_fastq_file_copy.open(input_fastq_file_name.c_str());													// Open input fastq file copy
-  output_stats_file.open(output_stats_file_name.c_str());                       // Open output stats file
-
   // Check if files can be opened properly
-  if (input_fastq_file.fail())
+  input_fastq_reader.setNumThreads(num_threads);
+  if (!input_fastq_reader.open(input_fastq_file_name))                           // Map or decompress input fastq file
   {
     std::cerr << "ERROR: Cannot open input fastq file: " << input_fastq_file_name << std::endl;
     return 1;
   }
-  if (output_stats_file.fail())
+  if (!output_stats_file.open(output_stats_file_name))                          // Open output stats file
 	{
 		std::cerr << "ERROR: Cannot open output stats file." << output_stats_file_name << std::endl;
 		return 1;
 	}
 
-  output_stats_file << "Name\tLength\tGC.Content\tAverage.Quality\n";
+  if (!aggregate)
+  {
+    output_stats_file.write("Name\tLength\tGC.Content\tAverage.Quality\n");
+  }
 
 
 
@@ -110,12 +149,8 @@ int main(int argc, char* argv[])
 
 
 
-	// Count the number of sequences in the input file (using the copy)
-	std::cout << "Initializing files and counting the number of sequences (This may take a while).\n" << std::endl;
-	total_num_lines = std::count(std::istreambuf_iterator<char>(input_fastq_file_copy), std::istreambuf_iterator<char>(), '\n') + 1;
-	total_num_records = total_num_lines / 4;																			// 4 lines for each sequence record
-	fastq_progress_log.initLog(total_num_records);																// Initialize the progres log with the total number of records
-	std::cout << "Input fastq file contains " << total_num_records << " sequences.\n" << std::endl;
+	// Progress is measured in bytes of the input file, so no counting pass is needed
+	fastq_progress_log.initLogBytes(input_fastq_file_name);
 
 
 
@@ -127,17 +162,71 @@ int main(int argc, char* argv[])
 
 
 
-  while (std::getline(input_fastq_file, current_line))
+  input_fastq_reader.setRetainBuffers(false);                                   // No views outlive their chunk
+  chunk_output.resize(input_fastq_reader.getNumSlots());
+  chunk_num_records.resize(input_fastq_reader.getNumSlots(), 0);
+  if (aggregate)                                                                // A slot is used by one worker at a time, so its statistics need no lock
   {
-    temp_id = current_line;                                                     // First line is the unique sequence ID
-    std::getline(input_fastq_file, temp_seq);						                        // Second line is the sequence bases
-    std::getline(input_fastq_file, temp_line3);						                    // Read in Third Line, "+", skip
-    std::getline(input_fastq_file, temp_qual);						                      // Fourth line is the sequence quality, RECORD FINISHED
+    slot_stats.resize(input_fastq_reader.getNumSlots(), ReadStats::ReadStats(phred_offset));
+  }
+
+  input_fastq_reader.parse(
+    // Worker thread: format the stats of every record in the chunk
+    [&](size_t chunk_index, FastQReader::FastQReader& chunk_reader)
+    {
+      size_t slot = chunk_index % input_fastq_reader.getNumSlots();             // Results of in-flight chunks never share a slot
+      FastQ::FastQView temp_fastq;                                              // View of the current fastq record
+      float temp_av_qual = 0;                                                   // Average quality is not calculated per read
+      std::ostringstream chunk_stats;
+
+      if (aggregate)                                                            // Count the chunk into the statistics of its slot
+      {
+        while (chunk_reader.nextRecord(temp_fastq))
+        {
+          slot_stats[slot].add(temp_fastq);
+          chunk_num_records[slot]++;
+        }
+        return;
+      }
+      while (chunk_reader.nextRecord(temp_fastq))                               // View the next record, without copying it
+      {
+        chunk_stats << temp_fastq.id << '\t' << temp_fastq.getLength() << '\t' << temp_fastq.getGC() << '\t' << temp_av_qual << '\n';
+        chunk_num_records[slot]++;
+      }
+      chunk_output[slot] = chunk_stats.str();
+    },
+    // Calling thread: write chunks in file order
+    [&](size_t chunk_index)
+    {
+      size_t slot = chunk_index % input_fastq_reader.getNumSlots();
+
+      output_stats_file.write(chunk_output[slot]);
+      std::string().swap(chunk_output[slot]);                                   // Release the chunk output
+      total_num_records += chunk_num_records[slot];
+      chunk_num_records[slot] = 0;
+      fastq_progress_log.updateLogBytes(input_fastq_reader.getChunk(chunk_index).input_end);  // Progress to the end of the chunk
+    });
+
+  if (input_fastq_reader.fail())                                                // Corrupt or truncated compressed input
+  {
+    return 1;
+  }
 
-    temp_fastq.setRecord(temp_id, temp_seq, temp_line3, temp_qual);                         // Store record in the temp fastq object
+	fastq_progress_log.completeLog(total_num_records);														// Report the exact number of records
 
-    output_stats_file << temp_fastq.getID() << '\t' << temp_fastq.getLength() << '\t' << temp_fastq.getGC() << '\t' << temp_fastq.getAvQual() << std::endl;
-		fastq_progress_log.incrementLog(1);																					// Increment progress log by 1 fastq record
+  if (aggregate)                                                                // Merge the slots into one report
+  {
+    for (size_t slot = 1; slot < slot_stats.size(); slot++)
+    {
+      slot_stats[0].merge(slot_stats[slot]);
+    }
+    output_stats_file.write(slot_stats[0].getReport(input_fastq_file_name));
+  }
+
+  if (!output_stats_file.close())
+  {
+    std::cerr << "ERROR: Cannot write output stats file: " << output_stats_file_name << std::endl;
+    return 1;
   }
 
 	std::cout << "\nOutput fastq statistics were written to: " << output_stats_file_name << "\n" << std::endl;
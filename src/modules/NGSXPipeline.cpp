@@ -0,0 +1,241 @@
+/*! \file NGSXPipeline.cpp
+ *  Pipeline Module: Runs several modules over a single read of the input.
+ *  \verbinclude NGSXPipeline.cpp
+ * NGSXPipeline: Implementation
+ *
+ */
+
+//----------------------------System Include----------------------------------//
+#include <iostream>									// Input and output to screen
+#include <string>										// String
+#include <sstream>									// Argument to int
+#include <vector>										// Stage list
+
+//----------------------------Custom Include----------------------------------//
+#include "Pipeline.h"								// Fused stage executor
+#include "OutputStream.h"						// Standard output detection
+#include "TextColor.h"							// Unix shell colored output
+
+//---------------------------------Main---------------------------------------//
+int main(int argc, char* argv[])
+{
+	//---------------------------Help Variables---------------------------------//
+	std::string usage = std::string("NGSX Pipeline Module. Runs quality control, duplicate removal, read stats and intersection in one pass. \n") +
+									"Options:\n" +
+										"\n\tYou must specify one input fastq file, or two for paired-end reads :\n" +
+                    "\t\t" + "--fq-in" + "\t\t" + "Input fastq, - for standard input" + "\n" +
+                    "\t\t" + "--fq1-in" + "\t" + "Input first fastq" + "\n" +
+                    "\t\t" + "--fq2-in" + "\t" + "Input second fastq" + "\n" +
+                    "\n\tYou must specify the matching output fastq files :\n" +
+                    "\t\t" + "--fq-out" + "\t\t" + "Output fastq file, - for standard output " + "\n" +
+                    "\t\t" + "--fq1-out" + "\t" + "Output first fastq" + "\n" +
+                    "\t\t" + "--fq2-out" + "\t" + "Output second fastq" + "\n" +
+		    						"\n\tYou must specify the stages and a prefix for their stats files:\n" +
+                    "\t\t" + "--stages" + "\t" + "Comma separated stages, in order: qc, dedup, stats, intersect (first, paired-end only)" + "\n" +
+                    "\t\t" + "--stats-prefix" + "\t" + "Prefix of the stats files, one per stage" + "\n" +
+										"\n\tParameters of the qc stage: \n" +
+										"\t\t" + "--phred" + "\t\t" + "Phred encoding (33 or 64) [INT]" + "\n" +
+										"\t\t" + "-q" + "\t\t" + "Minimum quality threshold [INT]" + "\n" +
+										"\t\t" + "-p" + "\t\t" + "Proportion of read that must meet minimum quality threshold [FLOAT]" + "\n" +
+										"\t\t" + "-l" + "\t\t" + "Minimum read length to keep [INT]" + "\n" +
+										"\n\tOptional parameters: \n" +
+										"\t\t" + "--threads" + "\t" + "Number of threads used to parse single-end reads [INT]" + "\n\n";
+
+	//-----------------------------Help Message---------------------------------//
+	if ((argc == 1) ||
+		(argc == 2 && std::string(argv[1]) == "-h") ||
+		(argc == 2 && std::string(argv[1]) == "-help") ||
+		(argc == 2 && std::string(argv[1]) == "--help") ||
+		(argc < 9))
+	{
+		std::cerr << usage << std::endl;
+		return 1;
+	}
+
+
+	//-----------------------Implementation Variables-------------------------//
+
+	// File Names
+	std::string input_file_name_first;       // Input fastq, or first fastq
+	std::string input_file_name_second;      // Input second fastq
+	std::string output_file_name_first;      // Output fastq, or first fastq
+	std::string output_file_name_second;     // Output second fastq
+	std::string stats_prefix;                // Prefix of the stats files
+
+	// Stages
+	std::string stage_list;
+	std::vector<Pipeline::StageType> stages;
+	Pipeline::Pipeline pipeline;
+	bool quality_stage = false;
+
+	// Colored text
+	TextColor::TextColor Palette;                   // Colored text output
+
+	// Integer command-line arguments arguments
+	int PHRED_BASE = 33;
+	int MIN_QUAL = -1;
+	float PROP_THRESHOLD = -1;
+	int MIN_LENGTH = -1;
+	int NUM_THREADS = 1;
+
+	//------------------------------Arg Parsing------------------------------//
+
+	for ( int i = 1; i < argc; i++ )
+	{
+
+			if ( i == argc - 1 )
+			{
+					std::cerr << "Missing value for option " << argv[i] << " exiting" << std::endl;
+					return 1;
+			}
+
+			else if ( std::string( argv[i] ) == "--fq-in" || std::string( argv[i] ) == "--fq1-in" )
+			{
+					input_file_name_first = std::string( argv[i + 1] );
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--fq2-in" )
+			{
+					input_file_name_second = std::string( argv[i + 1] );
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--fq-out" || std::string( argv[i] ) == "--fq1-out" )
+			{
+					output_file_name_first = std::string( argv[i + 1] );
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--fq2-out" )
+			{
+					output_file_name_second = std::string( argv[i + 1] );
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--stages" )
+			{
+					stage_list = std::string( argv[i + 1] );
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--stats-prefix" )
+			{
+					stats_prefix = std::string( argv[i + 1] );
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--phred" )
+			{
+					std::istringstream ss_phred(argv[i + 1]);
+					if (!(ss_phred >> PHRED_BASE))  std::cerr << "Invalid phred base. " << argv[i + 1] << '\n';
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "-q" )
+			{
+					std::istringstream ss_min_qual( argv[i + 1] );
+					if (!(ss_min_qual >> MIN_QUAL))  std::cerr << "Invalid minimum quality. " << argv[i + 1] << '\n';
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "-p" )
+			{
+					std::istringstream ss_prop_thresh(argv[i + 1]);
+					if (!(ss_prop_thresh >> PROP_THRESHOLD))  std::cerr << "Invalid quality proportion threshold. " << argv[i + 1] << '\n';
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "-l" )
+			{
+					std::istringstream ss_min_len(argv[i + 1]);
+					if (!(ss_min_len >> MIN_LENGTH))  std::cerr << "Invalid minimum length. " << argv[i + 1] << '\n';
+					i++;
+					continue;
+			}
+
+			else if ( std::string( argv[i] ) == "--threads" )
+			{
+					std::istringstream ss_threads(argv[i + 1]);
+					if (!(ss_threads >> NUM_THREADS))  std::cerr << "Invalid number of threads. " << argv[i + 1] << '\n';
+					i++;
+					continue;
+			}
+
+			else
+			{
+					std::cerr << "Unknown option " << argv[i] << " exiting" << std::endl;
+					return 1;
+			}
+
+	}
+
+	//------------------------------Check Options-----------------------------//
+	if ( input_file_name_first.empty() || output_file_name_first.empty() || stats_prefix.empty() ||
+		input_file_name_second.empty() != output_file_name_second.empty() )
+	{
+			std::cerr << usage << std::endl;
+			return 1;
+	}
+
+	if ( !Pipeline::parseStages( stage_list, stages ) )
+	{
+			std::cerr << "ERROR: Invalid stage list: " << stage_list << std::endl;
+			return 1;
+	}
+
+	if ( !pipeline.setStages( stages ) )
+	{
+			std::cerr << "ERROR: The intersect stage must be the first stage." << std::endl;
+			return 1;
+	}
+
+	for ( size_t i = 0; i < stages.size(); i++ )
+	{
+			quality_stage = quality_stage || stages[i] == Pipeline::QUALITY_FILTER;
+	}
+	if ( quality_stage && ( MIN_QUAL < 0 || PROP_THRESHOLD < 0 || MIN_LENGTH < 0 ) )
+	{
+			std::cerr << "ERROR: The qc stage needs the -q, -p and -l options." << std::endl;
+			return 1;
+	}
+	pipeline.getQualityFilter().setSettings( PHRED_BASE, MIN_QUAL, PROP_THRESHOLD, MIN_LENGTH );
+	pipeline.setNumThreads( NUM_THREADS );
+
+	// Fastq records go to standard output, so messages go to standard error
+	if ( OutputStream::OutputStream::isStandardOutput( output_file_name_first ) ||
+	                OutputStream::OutputStream::isStandardOutput( output_file_name_second ) )
+	{
+			std::cout.rdbuf( std::cerr.rdbuf() );
+	}
+
+	//----------------------------Begin Processing------------------------------//
+	std::cout << Palette.GREEN << "\nBeginning the NGSXPipeline Module.\n" <<  Palette.RESET << std::endl;
+	std::cout << "Stages:";
+	for ( size_t i = 0; i < stages.size(); i++ )
+	{
+			std::cout << " " << Pipeline::getStageName( stages[i] );
+	}
+	std::cout << std::endl;
+
+	if ( !pipeline.run( input_file_name_first, input_file_name_second, output_file_name_first,
+		output_file_name_second, stats_prefix ) )
+	{
+			return 1;
+	}
+
+	std::cout << "Out of: " << pipeline.getNumInput() << " sequences, NGSXPipeline kept: " <<
+							pipeline.getNumOutput() << "." << std::endl;
+	std::cout << "Stats files were written with the prefix: " << stats_prefix << std::endl;
+	std::cout << Palette.GREEN << "\nCompleted the NGSXPipeline Module.\n" <<  Palette.RESET << std::endl;
+	return 0;
+}
@@ -13,15 +13,22 @@
 //----------------------------System Include----------------------------------//
 #include <iostream>           // Input and output to screen
 #include <string>             // String
-#include <map>                // Maps
+#include <vector>             // Unique records sorted for output
+#include <sstream>            // Argument parsing
 #include <iomanip>            // Set Precision
 #include <fstream>            // File input and output
-#include <algorithm>          // To use the count function
 
 //----------------------------Custom Include----------------------------------//
 #include "FastQ.h"            // FastQ object
+#include "FastQReader.h"      // Memory-mapped or gzip fastq reader
+#include "FastQBlockReader.h" // Parallel chunked fastq parsing
 #include "TextColor.h"        // Unix shell colored output
 #include "ProgressLog.h"      // ProgressLog Class
+#include "FastQWriter.h"      // Batched fastq output, optionally compressed
+#include "SeqHash.h"          // Unique sequences by 128-bit fingerprint
+#include "ShardedDedup.h"     // Unique records in hash shards, filled by several threads
+#include "ExternalDedup.h"    // Sorted runs spilled beyond --mem-limit
+#include "NearDedup.h"        // Clusters of reads within --max-mismatches
 
 //---------------------------------Main---------------------------------------//
 int main( int argc, char* argv[] )
@@ -34,11 +41,32 @@ int main( int argc, char* argv[] )
                     +
 
                     "\n\tYou must specify one input fastq file :\n" +
-                    "\t\t" + "--fq-in" + "\t\t\t" + "Input fastq" + "\n" +
+                    "\t\t" + "--fq-in" + "\t\t\t" + "Input fastq, - for standard input" + "\n" +
                     "\n\tYou must specify one ouput fastq file :\n" +
-                    "\t\t" + "--fq-out" + "\t\t" + "Output fastq file " + "\n" +
+                    "\t\t" + "--fq-out" + "\t\t" + "Output fastq file, - for standard output " + "\n" +
                     "\n\tYou must specify one text file for stats output:\n" +
-                    "\t\t" + "--stats" + "\t\t\t" + "Output stats file " + "\n\n";
+                    "\t\t" + "--stats" + "\t\t\t" + "Output stats file " + "\n" +
+                    "\n\tOptional:\n" +
+                    "\t\t" + "--stream" + "\t\t" +
+                    "Keep the first copy of each sequence, writing in input order as records are read"
+                    + "\n" +
+                    "\t\t" + "--bin-quality" + "\t\t" +
+                    "Bin qualities to Phred 2, 12, 23 and 37 to save memory, give the encoding (33 or 64) [INT]"
+                    + "\n" +
+                    "\t\t" + "--mem-limit" + "\t\t" +
+                    "Memory for unique records, ex. 512M, sorted runs beyond it are spilled to $TMPDIR and merged"
+                    + "\n" +
+                    "\t\t" + "--keep" + "\t\t\t" +
+                    "Copy of a duplicated sequence to keep, first, last or best-quality (default last, --stream keeps first)"
+                    + "\n" +
+                    "\t\t" + "--phred" + "\t\t\t" +
+                    "Quality encoding for --keep best-quality, 33 or 64 (default 33, or the --bin-quality encoding) [INT]"
+                    + "\n" +
+                    "\t\t" + "--threads" + "\t\t" + "Number of threads used to find unique sequences [INT]"
+                    + "\n" +
+                    "\t\t" + "--max-mismatches" + "\t" +
+                    "Also remove near-duplicates, reads of equal length within this many mismatches [INT]"
+                    + "\n\n";
 
     //---------------------------Help Message---------------------------------//
     if ( ( argc == 1 ) ||
@@ -46,7 +74,7 @@ int main( int argc, char* argv[] )
                     ( argc == 2 && std::string( argv[1] ) == "-help" ) ||
                     ( argc == 2 && std::string( argv[1] ) == "--help" ) ||
                     ( argc < 7 ) ||
-                    ( argc > 7 ) )
+                    ( argc > 20 ) )
     {
         std::cout << "Usage:" << std::endl;
         std::cout << "" << std::endl;
@@ -58,40 +86,57 @@ int main( int argc, char* argv[] )
     std::string fastq_file_name;                   // Input Fastq
     std::string unique_fastq_file_name;            // Output Fastq
     std::string stats_file_name;                   // Stats file
-
-    std::ifstream fastq_file;                      // Input file stream
-    std::ifstream fastq_file_copy;                 // Copy for number lines
-
-    std::ofstream unique_fastq_file;               // Output file stream
+    bool stream_output = false;                    // Write unique records while reading
+    int bin_quality_phred = 0;                     // Encoding of binned qualities, 0 to keep them
+    size_t memory_limit = 0;                       // Memory for unique records, 0 for no limit
+    bool keep_given = false;                       // --keep was given
+    int phred_offset = 0;                          // Encoding of best-quality, 0 until known
+    ShardedDedup::KeepPolicy keep_policy = ShardedDedup::KEEP_LAST;
+    int num_threads = 1;                           // Parsing threads
+    int max_mismatches = 0;                        // Mismatches of near-duplicates, 0 for exact only
+
+    FastQReader::FastQReader fastq_reader;         // Input fastq reader, --stream
+    FastQBlockReader::FastQBlockReader block_reader;  // Input fastq chunks, in parallel
+    std::vector<unsigned long long> chunk_num_records;  // Records of the chunks in flight
+
+    FastQWriter::FastQWriter unique_fastq_file;  // Output file stream
     std::ofstream stats_file;                      // Stats file
 
-    std::string current_line;                      // String for line read
-    std::string temp_id;
-    std::string temp_seq;
-    std::string temp_line3;
-    std::string temp_qual;
+    // Sorted runs of unique records, spilled when memory_limit is reached
+    ExternalDedup::ExternalDedup spilled_runs;
+    unsigned long long num_merged;
 
-    std::map<std::string, FastQ::FastQ> map_unique_fastq;   // Map of unique seq
+    // Sequences already written by --stream, only their fingerprints are kept
+    SeqHash::SeqHash seen_sequences;
 
     // Colored text and progress log
-    FastQ::FastQ temp_fastq;
+    FastQ::FastQView temp_fastq;
     TextColor::TextColor Palette;                  // Colored text output
     ProgressLog::ProgressLog fastq_progress_log;   // Progress log
 
 
-    int total_num_lines;                           // Number of lines in copy
-    int total_num_records;                         // Number of sequences
-    int final_num_seq;
+    unsigned long long total_num_records = 0;      // Number of sequences
+    unsigned long long final_num_seq;
     float percent_unique;                          // Percent unique of input
 
-    std::map<std::string, FastQ::FastQ>::iterator it;      // Map iterator
-
     //------------------------------Arg Parsing------------------------------//
 
-    for ( int i = 1; i < ( argc - 1 ); i++ ) //all but last argument (file)
+    for ( int i = 1; i < argc; i++ )
     {
 
-        if ( std::string( argv[i] ) == "--fq-in" )
+        if ( std::string( argv[i] ) == "--stream" )
+        {
+            stream_output = true;
+            continue;
+        }
+
+        else if ( i == argc - 1 )
+        {
+            std::cerr << "Missing value for option " << argv[i] << " exiting" << std::endl;
+            return 1;
+        }
+
+        else if ( std::string( argv[i] ) == "--fq-in" )
         {
             fastq_file_name = std::string( argv[i + 1] );
             i++;
@@ -105,6 +150,79 @@ int main( int argc, char* argv[] )
             continue;
         }
 
+        else if ( std::string( argv[i] ) == "--bin-quality" )
+        {
+            std::istringstream ss_phred( argv[i + 1] );
+            if ( !( ss_phred >> bin_quality_phred ) || ( bin_quality_phred != 33 &&
+                            bin_quality_phred != 64 ) )
+            {
+                std::cerr << "ERROR: Invalid quality encoding for --bin-quality: " << argv[i + 1] <<
+                                std::endl;
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
+        else if ( std::string( argv[i] ) == "--mem-limit" )
+        {
+            if ( !ExternalDedup::parseMemoryLimit( argv[i + 1], memory_limit ) )
+            {
+                std::cerr << "ERROR: Invalid memory limit: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
+        else if ( std::string( argv[i] ) == "--keep" )
+        {
+            if ( !ShardedDedup::parseKeepPolicy( argv[i + 1], keep_policy ) )
+            {
+                std::cerr << "ERROR: Invalid copy to keep, first, last or best-quality: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            keep_given = true;
+            i++;
+            continue;
+        }
+
+        else if ( std::string( argv[i] ) == "--phred" )
+        {
+            std::istringstream ss_phred( argv[i + 1] );
+            if ( !( ss_phred >> phred_offset ) || ( phred_offset != 33 && phred_offset != 64 ) )
+            {
+                std::cerr << "ERROR: Invalid quality encoding for --phred: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
+        else if ( std::string( argv[i] ) == "--threads" )
+        {
+            std::istringstream ss_threads( argv[i + 1] );
+            if ( !( ss_threads >> num_threads ) || num_threads < 1 )
+            {
+                std::cerr << "ERROR: Invalid number of threads: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
+        else if ( std::string( argv[i] ) == "--max-mismatches" )
+        {
+            std::istringstream ss_mismatches( argv[i + 1] );
+            if ( !( ss_mismatches >> max_mismatches ) || max_mismatches < 0 )
+            {
+                std::cerr << "ERROR: Invalid number of mismatches: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
         else if ( std::string( argv[i] ) == "--stats" )
         {
             stats_file_name = std::string( argv[i + 1] );
@@ -120,23 +238,59 @@ int main( int argc, char* argv[] )
 
     }
 
+    if ( stream_output && memory_limit > 0 )
+    {
+        std::cerr << "ERROR: --stream keeps fingerprints only, it cannot be combined with --mem-limit" <<
+                  std::endl;
+        return 1;
+    }
+
+    if ( stream_output && keep_given && keep_policy != ShardedDedup::KEEP_FIRST )
+    {
+        std::cerr << "ERROR: --stream writes records as they are read, it keeps the first copy only" <<
+                  std::endl;
+        return 1;
+    }
+
+    if ( max_mismatches > 0 && ( stream_output || memory_limit > 0 ) )
+    {
+        std::cerr << "ERROR: --max-mismatches compares reads across the whole input, it cannot be combined"
+                  << " with --stream or --mem-limit" << std::endl;
+        return 1;
+    }
+
+    if ( phred_offset == 0 )
+    {
+        phred_offset = bin_quality_phred != 0 ? bin_quality_phred : 33;
+    }
+
+    // Fastq records go to standard output, so messages go to standard error
+    if ( OutputStream::OutputStream::isStandardOutput( unique_fastq_file_name ) )
+    {
+        std::cout.rdbuf( std::cerr.rdbuf() );
+    }
+
 
     //----------------------------------Open Files----------------------------//
     // Open requires parameter to be a const char*
-    fastq_file.open(fastq_file_name.c_str() );                    
-    fastq_file_copy.open(fastq_file_name.c_str() );               
-    unique_fastq_file.open(unique_fastq_file_name.c_str() );      
     stats_file.open( stats_file_name.c_str() );
 
-    // Check if files can be opened properly
-    if ( fastq_file.fail() )
+    // Check if files can be opened properly, chunks are cut smaller than the
+    // memory limit so runs are spilled close to it
+    block_reader.setNumThreads( num_threads );
+    block_reader.setRetainBuffers( false );
+    if ( memory_limit > 0 && memory_limit / 8 < 8 * 1024 * 1024 )
+    {
+        block_reader.setChunkSize( memory_limit / 8 );
+    }
+    if ( !( stream_output ? fastq_reader.open( fastq_file_name ) : block_reader.open( fastq_file_name ) ) )
     {
         std::cerr << "ERROR: Cannot open input fastq file: " << fastq_file_name <<
                         std::endl;
         return 1;
     }
 
-    if ( unique_fastq_file.fail() )
+    if ( !unique_fastq_file.open( unique_fastq_file_name ) )
     {
         std::cerr << "ERROR: Cannot open unique fastq file." << unique_fastq_file_name
                         << std::endl;
@@ -153,53 +307,198 @@ int main( int argc, char* argv[] )
     std::cout << Palette.GREEN << "\nBeginning the NGSX RemoveDuplicates Module.\n"
                     <<  Palette.RESET << std::endl;
 
-    // Count the number of sequences in the input file (using the copy)
-    std::cout <<
-                    "Initializing files and counting the number of sequences (This may take a while)."
-                    << std::endl;
-    total_num_lines = std::count( std::istreambuf_iterator<char>( fastq_file_copy ),
-                                    std::istreambuf_iterator<char>(), '\n' ) + 1;
-    total_num_records = total_num_lines / 4;         // 4 lines per record
-    fastq_progress_log.initLog(total_num_records );  // Init progress log
-    std::cout << "Input fastq file contains " << total_num_records << " sequences."
-                    << std::endl;
-
+    // Progress is measured in bytes of the input file, no counting pass is needed
+    fastq_progress_log.initLogBytes( fastq_file_name );
 
-    //---------------------------Find Unique Sequences------------------------//
 
-    while ( std::getline( fastq_file, current_line ) )
+    //---------------------------Stream Unique Sequences----------------------//
+    // Memory holds the unique sequences only, records are written as they are read
+    if ( stream_output )
     {
-        temp_id = current_line;                        // Sequence ID
-        std::getline( fastq_file, temp_seq );          // Sequence Bases
-        std::getline( fastq_file, temp_line3 );        // Ambiguous
-        std::getline( fastq_file, temp_qual );         // Sequence Quality
-
-        temp_fastq.setRecord( temp_id, temp_seq, temp_line3, temp_qual );
-        map_unique_fastq[temp_seq] = temp_fastq;       // Add or replace in map 
-	
-	// Completed reading 1 sequence record
-        
-	fastq_progress_log.incrementLog( 1 );
+        fastq_reader.setRetainBuffers( false );
+        final_num_seq = 0;
+
+        while ( fastq_reader.nextRecord( temp_fastq ) )
+        {
+            if ( seen_sequences.insertSequence( temp_fastq.sequence ) )
+            {
+                unique_fastq_file.write( temp_fastq );
+                final_num_seq++;
+            }
+
+            // Completed reading 1 sequence record
+            total_num_records++;
+            fastq_progress_log.updateLogBytes( fastq_reader.getInputOffset() );
+        }
+        fastq_progress_log.completeLog( total_num_records );
+        if ( fastq_reader.fail() )
+        {
+            return 1;
+        }
     }
+    else if ( max_mismatches > 0 )
+    {
+        //---------------------------Cluster Near-Duplicates----------------------//
+        // Worker threads parse chunks, reads join their cluster in file order as
+        // chunks complete, while the chunk is still in memory
+        NearDedup::NearDedup read_clusters( max_mismatches );
+        read_clusters.setKeepPolicy( keep_policy, phred_offset );
+        read_clusters.setBinQualities( bin_quality_phred != 0, bin_quality_phred );
+        std::vector<std::vector<FastQ::FastQView> > chunk_records( block_reader.getNumSlots() );
+
+        block_reader.parse(
+            // Worker thread: parse the records of one chunk
+            [&]( size_t chunk_index, FastQReader::FastQReader & chunk_reader )
+        {
+            std::vector<FastQ::FastQView>& records = chunk_records[chunk_index % block_reader.getNumSlots()];
+            FastQ::FastQView chunk_fastq;
+
+            records.clear();
+            while ( chunk_reader.nextRecord( chunk_fastq ) )
+            {
+                records.push_back( chunk_fastq );
+            }
+        },
+        // Calling thread: cluster the records in file order
+        [&]( size_t chunk_index )
+        {
+            std::vector<FastQ::FastQView>& records = chunk_records[chunk_index % block_reader.getNumSlots()];
+
+            for ( size_t i = 0; i < records.size(); i++ )
+            {
+                read_clusters.insert( records[i] );
+            }
+            total_num_records += records.size();
+            fastq_progress_log.updateLogBytes( block_reader.getChunk( chunk_index ).input_end );
+        } );
+        fastq_progress_log.completeLog( total_num_records );
+        if ( block_reader.fail() )
+        {
+            return 1;
+        }
 
+        //---------------------------Write Cluster Records------------------------//
+        std::cout << "Writing one record per cluster to file." << std::endl;
+        std::cout << "Reads removed as near-duplicates within " << max_mismatches << " mismatches: " <<
+                  read_clusters.getNumNear() << ", clusters and index: " << read_clusters.getMemoryUsage() /
+                  ( 1024 * 1024 ) << " MB" << std::endl;
+        final_num_seq = 0;
 
-    //---------------------------Write Unique Sequences-----------------------------------//
-    std::cout << "Writing unique sequences to file." << std::endl;
-    final_num_seq = 0;
+        read_clusters.writeSorted( [&]( const FastQ::FastQView & record )
+        {
+            unique_fastq_file.write( record );
 
-    for ( it = map_unique_fastq.begin(); it != map_unique_fastq.end(); ++it )
+            // Completed writing 1 sequence record
+            final_num_seq++;
+        } );
+    }
+    else
     {
-        unique_fastq_file << it->second.getID() << std::endl;
-        unique_fastq_file << it->second.getSeq() << std::endl;
-        unique_fastq_file << it->second.getLine3() << std::endl;
-        unique_fastq_file << it->second.getQual() << std::endl;
+        //---------------------------Find Unique Sequences------------------------//
+        // Worker threads parse chunks and add their records to the hash shards,
+        // which take the chunks in file order, so the copy kept does not depend
+        // on the number of threads. Records are copied into packed storage, so
+        // chunks need not stay in memory.
+        ShardedDedup::ShardedDedup unique_records( num_threads == 1 ? 1 : 4 * num_threads );
+        unique_records.setKeepPolicy( keep_policy, phred_offset );
+        unique_records.setBinQualities( bin_quality_phred != 0, bin_quality_phred );
+        spilled_runs.setKeepFirst( keep_policy == ShardedDedup::KEEP_FIRST );
+        spilled_runs.setKeepBestQuality( keep_policy == ShardedDedup::KEEP_BEST_QUALITY ?
+                                         phred_offset : 0 );
+        chunk_num_records.resize( block_reader.getNumSlots(), 0 );
+        bool spill_failed = false;
+
+        // Writes the unique records so far as a sorted run and frees them
+        auto spillRun = [&]()
+        {
+            if ( !spilled_runs.startRun() )
+            {
+                return false;
+            }
+            unique_records.writeSorted( [&]( const FastQ::FastQView & record )
+            {
+                spilled_runs.write( record );
+            } );
+            return spilled_runs.endRun();
+        };
+
+        block_reader.parse(
+            // Worker thread: add the records of one chunk
+            [&]( size_t chunk_index, FastQReader::FastQReader & chunk_reader )
+        {
+            std::vector<FastQ::FastQView> chunk_records;
+            FastQ::FastQView chunk_fastq;
+
+            while ( chunk_reader.nextRecord( chunk_fastq ) )
+            {
+                chunk_records.push_back( chunk_fastq );
+            }
+            unique_records.insertChunk( chunk_index, chunk_records );
+            chunk_num_records[chunk_index % block_reader.getNumSlots()] = chunk_records.size();
+        },
+        // Calling thread: count records in file order, spill over the memory limit
+        [&]( size_t chunk_index )
+        {
+            total_num_records += chunk_num_records[chunk_index % block_reader.getNumSlots()];
+            fastq_progress_log.updateLogBytes( block_reader.getChunk( chunk_index ).input_end );
+
+            // Chunks in flight may already be in the run, a sequence is always in
+            // the same shard and each shard fills in file order, so runs stay in order
+            if ( memory_limit > 0 && !spill_failed && unique_records.getUsedMemory() >= memory_limit )
+            {
+                spill_failed = !spillRun();
+            }
+        } );
+        fastq_progress_log.completeLog( total_num_records );
+        if ( block_reader.fail() || spill_failed )
+        {
+            return 1;
+        }
+
 
-        // Completed writing 1 sequence record
-        final_num_seq++;
+        //---------------------------Merge Spilled Runs----------------------------//
+        if ( spilled_runs.getNumRuns() > 0 )
+        {
+            if ( unique_records.size() > 0 && !spillRun() )
+            {
+                return 1;
+            }
+            std::cout << "Merging " << spilled_runs.getNumRuns() <<
+                      " sorted runs spilled to disk into the unique sequences file." << std::endl;
+            if ( !spilled_runs.merge( unique_fastq_file, num_merged ) )
+            {
+                return 1;
+            }
+            final_num_seq = num_merged;
+        }
+        else
+        {
+            //---------------------------Write Unique Sequences-----------------------------------//
+            std::cout << "Writing unique sequences to file." << std::endl;
+            final_num_seq = 0;
+
+            std::cout << "Unique records and hash tables: " << unique_records.getUsedMemory() /
+                      ( 1024 * 1024 ) << " MB, " << unique_records.getUsedMemory() /
+                      ( unique_records.size() + 1 ) << " bytes per unique sequence" << std::endl;
+
+            unique_records.writeSorted( [&]( const FastQ::FastQView & record )
+            {
+                unique_fastq_file.write( record );
+
+                // Completed writing 1 sequence record
+                final_num_seq++;
+            } );
+        }
     }
 
     percent_unique = final_num_seq / ( float )total_num_records * 100;
 
+    if ( !unique_fastq_file.close() )
+    {
+        std::cerr << "ERROR: Cannot write output fastq file: " << unique_fastq_file_name << std::endl;
+        return 1;
+    }
+
     stats_file << "Total_Sequences\tUnique_Sequences\tPercent_Unique" << std::endl;
     stats_file << total_num_records << "\t" << final_num_seq << "\t" <<
                     std::setprecision( 4 ) << percent_unique << std::endl;
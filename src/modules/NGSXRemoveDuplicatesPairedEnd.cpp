@@ -13,15 +13,20 @@
 //----------------------------System Include----------------------------------//
 #include <iostream>                    // Input and output to screen
 #include <string>                      // String
-#include <map>                         // Maps
+#include <vector>                      // Unique pairs sorted for output
 #include <iomanip>                     // Set Precision
 #include <fstream>                     // File input and output
-#include <algorithm>                   // To use the count function
+#include <algorithm>                   // Sorting unique pairs
 
 //----------------------------Custom Include----------------------------------//
 #include "FastQ.h"                     // FastQ object
+#include "FastQReader.h"               // Memory-mapped or gzip fastq reader
 #include "TextColor.h"                 // Unix shell colored output
 #include "ProgressLog.h"               // ProgressLog Class
+#include "FastQWriter.h"               // Batched fastq output, optionally compressed
+#include "PackedSeq.h"                 // 2 bit packed record storage
+#include "SeqHash.h"                   // Unique pairs by 128-bit fingerprint
+#include "ExternalDedup.h"             // Sorted runs spilled beyond --mem-limit
 
 //---------------------------------Main---------------------------------------//
 int main( int argc, char* argv[] )
@@ -34,13 +39,24 @@ int main( int argc, char* argv[] )
                     +
 
                     "\n\tYou must specify two fastq files :\n" +
-                    "\t\t" + "--fq1-in" + "\t\t" + "First fastq" + "\n" +
+                    "\t\t" + "--fq1-in" + "\t\t" + "First fastq, - for standard input" + "\n" +
                     "\t\t" + "--fq2-in" + "\t\t" + "Second  fastq file" + "\n" +
                     "\n\tYou must specify two fastq files :\n" +
                     "\t\t" + "--fq1-out" + "\t\t" + "Output first fastq file " + "\n" +
                     "\t\t" + "--fq2-out" + "\t\t" + "Output second fastq file " + "\n" +
+                    "\t\t\t\t\t" + "One of the outputs may be -, for standard output" + "\n" +
 		    "\n\tYou must specify one text file for stats output:\n" +
-                    "\t\t" + "--stats" + "\t\t\t" + "Output stats file " + "\n\n";
+                    "\t\t" + "--stats" + "\t\t\t" + "Output stats file " + "\n" +
+                    "\n\tOptional:\n" +
+                    "\t\t" + "--stream" + "\t\t" +
+                    "Keep the first copy of each pair, writing in input order as records are read"
+                    + "\n" +
+                    "\t\t" + "--mem-limit" + "\t\t" +
+                    "Memory for unique pairs, ex. 512M, sorted runs beyond it are spilled to $TMPDIR and merged"
+                    + "\n" +
+                    "\t\t" + "--canonical" + "\t\t" +
+                    "Pairs with swapped mates are duplicates, output is sorted by the lesser mate first"
+                    + "\n\n";
 
     //-------------------------------Help Parsing-------------------------------//
 
@@ -49,7 +65,7 @@ int main( int argc, char* argv[] )
                     ( argc == 2 && std::string( argv[1] ) == "-help" ) ||
                     ( argc == 2 && std::string( argv[1] ) == "--help" ) ||
                     ( argc < 11 ) ||
-                    ( argc > 11 ) )
+                    ( argc > 15 ) )
     {
         std::cout << "Usage:" << std::endl;
         std::cout << "" << std::endl;
@@ -65,54 +81,71 @@ int main( int argc, char* argv[] )
     std::string output_file_name_first_fastq;      // First output fastq
     std::string output_file_name_second_fastq;     // Second output fastq
     std::string stats_file_name;                   // Stats file
+    bool stream_output = false;                    // Write unique pairs while reading
+    size_t memory_limit = 0;                       // Memory for unique pairs, 0 for no limit
+    bool canonical = false;                        // Ignore mate orientation
 
     // Input file streams
-    std::ifstream input_first_fastq_file;          // Input first file stream
-    std::ifstream input_second_fastq_file;         // Input second file stream
-    std::ifstream fastq_file_copy;                 // Copy for counting lines
+    FastQReader::FastQReader input_first_fastq_reader;   // Input first reader
+    FastQReader::FastQReader input_second_fastq_reader;  // Input second reader
 
     // Output file streams
-    std::ofstream output_first_fastq_file;         // Output first file stream
-    std::ofstream output_second_fastq_file;        // Output second file stream
+    FastQWriter::FastQPairedWriter output_fastq_files;  // Output first and second file streams
     std::ofstream stats_file;                      // Stats file
 
-    // Fastq lines
-    std::string current_line;
-    std::string temp_id_first;
-    std::string temp_seq_first;
-    std::string temp_line3_first;
-    std::string temp_qual_first;
-
-    std::string temp_id_second;
-    std::string temp_seq_second;
-    std::string temp_line3_second;
-    std::string temp_qual_second;
-
-    std::string temp_seq_paired;
-
-    // Associative arrays
-    std::map<std::string, FastQ::FastQPaired> map_unique_paired;  // Map unique
+    // Unique pairs, packed and found by the fingerprint of both sequences
+    typedef SeqHash::PairedSeqHash::RefPair RefPair;
+    PackedSeq::PackedSeq unique_records_first;
+    PackedSeq::PackedSeq unique_records_second;
+    SeqHash::PairedSeqHash unique_pairs;
+    std::vector<RefPair> sorted_pairs;             // Unique pairs sorted by sequence for output
+    RefPair temp_pair;
+    RefPair* kept_pair;
+    bool inserted;
+    std::string record_buffer_first;               // Unpacked records being written
+    std::string record_buffer_second;
+
+    // Sorted runs of unique pairs, spilled when memory_limit is reached
+    ExternalDedup::ExternalDedup spilled_runs( true );
+    unsigned long long num_merged;
+
+    // Pairs already written by --stream, only their fingerprints are kept
+    SeqHash::SeqHash seen_pairs;
 
     // Colored text and progress log
-    FastQ::FastQ temp_fastq_first;
-    FastQ::FastQ temp_fastq_second;
-    FastQ::FastQPaired temp_fastq_paired;
+    FastQ::FastQView temp_fastq_first;
+    FastQ::FastQView temp_fastq_second;
     TextColor::TextColor Palette;                   // Colored text output
     ProgressLog::ProgressLog fastq_progress_log;    // Progress log
 
-    int total_num_lines;                            // Num lines in copy
-    int total_num_records;                          // Num fastq records
+    int total_num_records = 0;                      // Num fastq records
     int final_num_seq;                              // Num unique
     float percent_unique;                           // Percent of input
 
-    std::map<std::string, FastQ::FastQPaired>::iterator it;      // Map iterator
-
     //------------------------------Arg Parsing------------------------------//
 
-    for ( int i = 1; i < ( argc - 1 ); i++ ) //all but last argument (file)
+    for ( int i = 1; i < argc; i++ )
     {
 
-        if ( std::string( argv[i] ) == "--fq1-in" )
+        if ( std::string( argv[i] ) == "--stream" )
+        {
+            stream_output = true;
+            continue;
+        }
+
+        else if ( std::string( argv[i] ) == "--canonical" )
+        {
+            canonical = true;
+            continue;
+        }
+
+        else if ( i == argc - 1 )
+        {
+            std::cerr << "Missing value for option " << argv[i] << " exiting" << std::endl;
+            return 1;
+        }
+
+        else if ( std::string( argv[i] ) == "--fq1-in" )
         {
             input_file_name_first_fastq = std::string( argv[i + 1] );
             i++;
@@ -140,6 +173,17 @@ int main( int argc, char* argv[] )
             continue;
         }
 
+        else if ( std::string( argv[i] ) == "--mem-limit" )
+        {
+            if ( !ExternalDedup::parseMemoryLimit( argv[i + 1], memory_limit ) )
+            {
+                std::cerr << "ERROR: Invalid memory limit: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
         else if ( std::string( argv[i] ) == "--stats" )
         {
             stats_file_name = std::string( argv[i + 1] );
@@ -155,38 +199,47 @@ int main( int argc, char* argv[] )
 
     }
 
+    if ( stream_output && memory_limit > 0 )
+    {
+        std::cerr << "ERROR: --stream keeps sequences only, it cannot be combined with --mem-limit" <<
+                  std::endl;
+        return 1;
+    }
+
+    // Fastq records go to standard output, so messages go to standard error
+    if ( OutputStream::OutputStream::isStandardOutput( output_file_name_first_fastq ) ||
+                    OutputStream::OutputStream::isStandardOutput( output_file_name_second_fastq ) )
+    {
+        std::cout.rdbuf( std::cerr.rdbuf() );
+    }
+
     //----------------------------------Open Files----------------------------//
 
-    input_first_fastq_file.open(input_file_name_first_fastq.c_str() );
-    input_second_fastq_file.open(input_file_name_second_fastq.c_str() );
-    fastq_file_copy.open(input_file_name_first_fastq.c_str() );
-    output_first_fastq_file.open(output_file_name_first_fastq.c_str() );
-    output_second_fastq_file.open(output_file_name_second_fastq.c_str() );
     stats_file.open( stats_file_name.c_str() );
 
     // Check if files can be opened properly
-    if ( input_first_fastq_file.fail() )
+    if ( !input_first_fastq_reader.open( input_file_name_first_fastq ) )
     {
         std::cerr << "ERROR: Cannot open input first fastq file: " <<
                         input_file_name_first_fastq << std::endl;
         return 1;
     }
 
-    if ( input_second_fastq_file.fail() )
+    if ( !input_second_fastq_reader.open( input_file_name_second_fastq ) )
     {
         std::cerr << "ERROR: Cannot open input second fastq file: " <<
                         input_file_name_second_fastq << std::endl;
         return 1;
     }
 
-    if ( output_first_fastq_file.fail() )
+    if ( !output_fastq_files.getFirst().open( output_file_name_first_fastq ) )
     {
         std::cerr << "ERROR: Cannot open output first fastq file: " <<
                         output_file_name_first_fastq << std::endl;
         return 1;
     }
 
-    if ( output_second_fastq_file.fail() )
+    if ( !output_fastq_files.getSecond().open( output_file_name_second_fastq ) )
     {
         std::cerr << "ERROR: Cannot open output second fastq file: " <<
                         output_file_name_second_fastq << std::endl;
@@ -204,74 +257,185 @@ int main( int argc, char* argv[] )
                     "\nBeginning the NGSX RemoveDuplicatesPairedEnd Module.\n" <<  Palette.RESET <<
                     std::endl;
 
-    // Count the number of sequences in the input file (using the copy)
-    std::cout <<
-                    "Initializing files and counting the number of sequences (This may take a while)."
-                    << std::endl;
-    total_num_lines = std::count( std::istreambuf_iterator<char>( fastq_file_copy ),
-                                    std::istreambuf_iterator<char>(), '\n' ) + 1;
-    total_num_records = total_num_lines /  4;           // 4 lines per record
-    fastq_progress_log.initLog(total_num_records );     // Init log
-    std::cout << "Input fastq file contains " << total_num_records << " sequences."
-                    << std::endl;
-
+    // Progress is measured in bytes of the first input file, no counting pass is needed
+    fastq_progress_log.initLogBytes( input_file_name_first_fastq );
 
-    //---------------------------Find Unique Sequences------------------------//
 
-    while ( std::getline( input_first_fastq_file, current_line ) )
+    //---------------------------Stream Unique Sequences----------------------//
+    // Memory holds the unique pairs only, records are written as they are read
+    if ( stream_output )
     {
-        // First fastq
-        temp_id_first = current_line;                               // ID
-        std::getline( input_first_fastq_file,temp_seq_first );      // Sequence
-        std::getline( input_first_fastq_file,temp_line3_first );    // Ambiguous
-        std::getline( input_first_fastq_file, temp_qual_first );    // Quality
-
-        temp_fastq_first.setRecord( temp_id_first, temp_seq_first, temp_line3_first,
-                        temp_qual_first );
+        input_first_fastq_reader.setRetainBuffers( false );
+        input_second_fastq_reader.setRetainBuffers( false );
+        final_num_seq = 0;
 
-        // Second fastq
-        std::getline( input_second_fastq_file, temp_id_second );    // ID
-        std::getline( input_second_fastq_file, temp_seq_second );   // Sequence
-        std::getline( input_second_fastq_file, temp_line3_second ); // Ambiguous
-        std::getline( input_second_fastq_file, temp_qual_second );  // Quality
-
-        temp_fastq_second.setRecord( temp_id_second, temp_seq_second, temp_line3_second,
-                        temp_qual_second );
-
-        temp_seq_paired = temp_seq_first + "}{" + temp_seq_second;
-
-        temp_fastq_paired.setRecord( temp_fastq_first, temp_fastq_second );
-
-        map_unique_paired[temp_seq_paired] = temp_fastq_paired;   // Add/replace
-
-        // Completed reading 1 sequence record
-        fastq_progress_log.incrementLog( 1 );
+        while ( input_first_fastq_reader.nextRecord( temp_fastq_first ) )
+        {
+            // Second fastq, a missing mate is left empty
+            if ( !input_second_fastq_reader.nextRecord( temp_fastq_second ) )
+            {
+                temp_fastq_second = FastQ::FastQView();
+            }
+
+            if ( seen_pairs.insertHash( SeqHash::hashPair( temp_fastq_first.sequence,
+                                        temp_fastq_second.sequence, canonical ) ) )
+            {
+                output_fastq_files.write( temp_fastq_first, temp_fastq_second );
+                final_num_seq++;
+            }
+
+            // Completed reading 1 sequence record
+            total_num_records++;
+            fastq_progress_log.updateLogBytes( input_first_fastq_reader.getInputOffset() );
+        }
+        fastq_progress_log.completeLog( total_num_records );
+        if ( input_first_fastq_reader.fail() || input_second_fastq_reader.fail() )
+        {
+            return 1;
+        }
     }
-
-    //---------------------------Write Unique Sequences-----------------------//
-    std::cout << "Writing unique sequences to file." << std::endl;
-    final_num_seq = 0;
-
-    for ( it = map_unique_paired.begin(); it != map_unique_paired.end(); ++it )
+    else
     {
-        // First output file
-        output_first_fastq_file << it->second.getIDFirst() << std::endl;
-        output_first_fastq_file << it->second.getSeqFirst() << std::endl;
-        output_first_fastq_file << it->second.getLine3First() << std::endl;
-        output_first_fastq_file << it->second.getQualFirst() << std::endl;
-
-        output_second_fastq_file << it->second.getIDSecond() << std::endl;
-        output_second_fastq_file << it->second.getSeqSecond() << std::endl;
-        output_second_fastq_file << it->second.getLine3Second() << std::endl;
-        output_second_fastq_file << it->second.getQualSecond() << std::endl;
-
+        //---------------------------Find Unique Sequences------------------------//
+        // Records are copied into packed storage, so the inputs need not stay in memory
+        input_first_fastq_reader.setRetainBuffers( false );
+        input_second_fastq_reader.setRetainBuffers( false );
+        unique_pairs.setCanonical( canonical );
+        spilled_runs.setCanonical( canonical );
+
+        // Unique pairs in output order, as the sorted set this table replaced
+        auto sortUnique = [&]()
+        {
+            sorted_pairs.clear();
+            unique_pairs.getRecords( sorted_pairs );
+            unique_pairs.clear();
+            if ( canonical )
+            {
+                std::sort( sorted_pairs.begin(), sorted_pairs.end(), PackedSeq::CanonicalPairLess() );
+            }
+            else
+            {
+                std::sort( sorted_pairs.begin(), sorted_pairs.end(), PackedSeq::PairedSequenceLess() );
+            }
+        };
+
+        // Writes the unique pairs so far as a sorted run and frees them
+        auto spillRun = [&]()
+        {
+            sortUnique();
+            if ( !spilled_runs.startRun() )
+            {
+                return false;
+            }
+            for ( size_t i = 0; i < sorted_pairs.size(); i++ )
+            {
+                unique_records_first.getRecord( sorted_pairs[i].first, record_buffer_first, temp_fastq_first );
+                unique_records_second.getRecord( sorted_pairs[i].second, record_buffer_second,
+                                                 temp_fastq_second );
+                spilled_runs.write( temp_fastq_first, temp_fastq_second );
+            }
+            sorted_pairs.clear();
+            unique_records_first.clear();
+            unique_records_second.clear();
+            return spilled_runs.endRun();
+        };
+
+        while ( input_first_fastq_reader.nextRecord( temp_fastq_first ) )
+        {
+            // Second fastq, a missing mate is left empty
+            if ( !input_second_fastq_reader.nextRecord( temp_fastq_second ) )
+            {
+                temp_fastq_second = FastQ::FastQView();
+            }
+
+            temp_pair = std::make_pair( unique_records_first.add( temp_fastq_first ),
+                                        unique_records_second.add( temp_fastq_second ) );
+            kept_pair = unique_pairs.insertPair( temp_fastq_first.sequence, temp_fastq_second.sequence,
+                                                 temp_pair, inserted );
+
+            // Duplicate, the last copy is kept, its mates in their own orientation
+            if ( !inserted )
+            {
+                kept_pair->first = unique_records_first.replace( kept_pair->first, temp_pair.first );
+                kept_pair->second = unique_records_second.replace( kept_pair->second, temp_pair.second );
+            }
+
+            // Over the memory limit, the pairs kept so far become a run on disk
+            if ( memory_limit > 0 && unique_records_first.getArena().getUsedMemory() +
+                            unique_records_second.getArena().getUsedMemory() + unique_pairs.getMemoryUsage() >=
+                            memory_limit && !spillRun() )
+            {
+                return 1;
+            }
+
+            // Completed reading 1 sequence record
+            total_num_records++;
+            fastq_progress_log.updateLogBytes( input_first_fastq_reader.getInputOffset() );
+        }
+        fastq_progress_log.completeLog( total_num_records );
+        if ( input_first_fastq_reader.fail() || input_second_fastq_reader.fail() )
+        {
+            return 1;
+        }
 
-        // Completed writing 1 sequence record
-        final_num_seq++;
+        //---------------------------Merge Spilled Runs----------------------------//
+        if ( spilled_runs.getNumRuns() > 0 )
+        {
+            if ( unique_pairs.size() > 0 && !spillRun() )
+            {
+                return 1;
+            }
+            std::cout << "Merging " << spilled_runs.getNumRuns() <<
+                      " sorted runs spilled to disk into the unique sequences files." << std::endl;
+            if ( !spilled_runs.merge( output_fastq_files, num_merged ) )
+            {
+                return 1;
+            }
+            final_num_seq = num_merged;
+        }
+        else
+        {
+            //---------------------------Write Unique Sequences-----------------------//
+            std::cout << "Writing unique sequences to file." << std::endl;
+            final_num_seq = 0;
+
+            std::cout << "Unique pairs stored in: " << ( unique_records_first.getArena().getMemoryUsage()
+                            + unique_records_second.getArena().getMemoryUsage() ) / ( 1024 * 1024 ) << " MB, " <<
+                      unique_records_first.getArena().getNumBlocks() +
+                      unique_records_second.getArena().getNumBlocks() << " blocks for " <<
+                      unique_records_first.getArena().getNumAllocations() +
+                      unique_records_second.getArena().getNumAllocations() << " allocations" << std::endl;
+            std::cout << "Hash table: " << unique_pairs.getMemoryUsage() / ( 1024 * 1024 ) <<
+                      " MB, " << unique_pairs.getMemoryUsage() / ( unique_pairs.size() + 1 ) <<
+                      " bytes per unique pair" << std::endl;
+
+            sortUnique();
+
+            for ( size_t i = 0; i < sorted_pairs.size(); i++ )
+            {
+                unique_records_first.getRecord( sorted_pairs[i].first, record_buffer_first, temp_fastq_first );
+                unique_records_second.getRecord( sorted_pairs[i].second, record_buffer_second,
+                                                 temp_fastq_second );
+
+                // Both output files, flushed together
+                output_fastq_files.write( temp_fastq_first, temp_fastq_second );
+
+
+                // Completed writing 1 sequence record
+                final_num_seq++;
+            }
+        }
     }
 
     percent_unique = final_num_seq / ( float )total_num_records * 100;
 
+    if ( !output_fastq_files.close() )
+    {
+        std::cerr << "ERROR: Cannot write output fastq files: " << output_file_name_first_fastq <<
+                        " and " << output_file_name_second_fastq << std::endl;
+        return 1;
+    }
+
     stats_file << "Total_Sequences\tUnique_Sequences\tPercent_Unique" << std::endl;
     stats_file << total_num_records << "\t" << final_num_seq << "\t" <<
                     std::setprecision( 4 ) << percent_unique << std::endl;
@@ -140,7 +140,7 @@ for leeHom_ind_sample_dir in os.listdir(samples_dir):
             # Write the sort command for shell output
             makefile.write('\t' +
                             '@cat ' + removedup_target + ' | ' +
-                            'paste - - - - | sort -k1,1 -t " " | tr "\\t" "\\n" ' +
+                            'paste - - - - | LC_ALL=C sort -k1,1 -t " " | tr "\\t" "\\n" ' +
                             '> ' + sorted_target +
                             '\n')
 
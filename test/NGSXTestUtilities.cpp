@@ -0,0 +1,275 @@
+/*! \file NGSXTestUtilities.cpp
+ * \brief Checks the Utilities set operations against the std:: algorithms.
+ *
+ * Random sorted ranges with repeated keys, empty ranges and more parts than
+ * elements are intersected, subtracted and merged sequentially, in parallel,
+ * through a hash table and over input iterators. Every result must match
+ * std::set_intersection, std::set_difference or std::set_union.
+ */
+
+//----------------------------System Include----------------------------------//
+#include <iostream>
+#include <sstream>
+#include <iterator>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+
+//----------------------------Custom Include----------------------------------//
+#include "Utilities.h"              // Set operations under test
+
+/** \struct Element \brief A key, and the index telling copies of a key apart. */
+struct Element
+{
+    int key;
+    int index;
+
+    bool operator==( const Element& other ) const
+    {
+        return key == other.key && index == other.index;
+    }
+};
+
+static int compareKeys( const Element& a, const Element& b )
+{
+    return a.key < b.key ? -1 : a.key > b.key ? 1 : 0;
+}
+
+static bool lessKey( const Element& a, const Element& b )
+{
+    return a.key < b.key;
+}
+
+static std::vector<Element> makeRange( std::mt19937& random, size_t size, int max_key )
+{
+    std::vector<Element> range( size );
+
+    for ( size_t i = 0; i < size; i++ )
+    {
+        range[i].key = random() % max_key;
+    }
+    std::sort( range.begin(), range.end(), lessKey );
+    for ( size_t i = 0; i < size; i++ )
+    {
+        range[i].index = i;
+    }
+    return range;
+}
+
+template<typename T>
+static std::vector<T> concatenate( const std::vector<std::vector<T> >& parts )
+{
+    std::vector<T> all;
+
+    for ( size_t i = 0; i < parts.size(); i++ )
+    {
+        all.insert( all.end(), parts[i].begin(), parts[i].end() );
+    }
+    return all;
+}
+
+static int STATUS = 0;
+
+static void check( bool passed, const std::string& what, size_t size1, size_t size2, size_t num_parts )
+{
+    if ( !passed && STATUS == 0 )
+    {
+        std::cout << "FAIL: " << what << " of ranges of " << size1 << " and " << size2 << " elements in " <<
+                  num_parts << " parts" << std::endl;
+    }
+    STATUS = passed ? STATUS : 1;
+}
+
+static void checkRanges( const std::vector<Element>& first, const std::vector<Element>& second )
+{
+    std::vector<Element> expected_first;      // Matched elements of first, as std::set_intersection
+    std::vector<Element> expected_second;     // Matched elements of second
+    std::vector<Element> expected_difference;
+    std::vector<Element> expected_union;
+    std::vector<Element> matched_first;
+    std::vector<Element> matched_second;
+    std::vector<Element> only_first;
+    std::vector<Element> only_second;
+    std::vector<Element> result;
+    std::unordered_map<int, int> table;
+
+    std::set_intersection( first.begin(), first.end(), second.begin(), second.end(),
+                           std::back_inserter( expected_first ), lessKey );
+    std::set_intersection( second.begin(), second.end(), first.begin(), first.end(),
+                           std::back_inserter( expected_second ), lessKey );
+    std::set_difference( first.begin(), first.end(), second.begin(), second.end(),
+                         std::back_inserter( expected_difference ), lessKey );
+    std::set_union( first.begin(), first.end(), second.begin(), second.end(),
+                    std::back_inserter( expected_union ), lessKey );
+
+    //-----------------------------Sequential----------------------------------//
+    Utilities::IntersectSorted( first.begin(), first.end(), second.begin(), second.end(), compareKeys,
+                                [&]( const Element & a, const Element & b )
+    {
+        matched_first.push_back( a );
+        matched_second.push_back( b );
+    } );
+    check( matched_first == expected_first && matched_second == expected_second, "IntersectSorted",
+           first.size(), second.size(), 1 );
+
+    Utilities::DifferenceSorted( first.begin(), first.end(), second.begin(), second.end(), compareKeys,
+                                 [&]( const Element & a )
+    {
+        result.push_back( a );
+    } );
+    check( result == expected_difference, "DifferenceSorted", first.size(), second.size(), 1 );
+
+    // std::set_union takes a key from the first range when both have it
+    result.clear();
+    Utilities::UnionSorted( first.begin(), first.end(), second.begin(), second.end(), compareKeys,
+                            [&]( const Element * a, const Element * b )
+    {
+        result.push_back( a != NULL ? *a : *b );
+    } );
+    check( result == expected_union, "UnionSorted", first.size(), second.size(), 1 );
+
+    // Keys of a sorted run read back from a stream
+    std::ostringstream run_first;
+    std::ostringstream run_second;
+    std::vector<int> run_matches;
+    std::vector<int> expected_keys;
+    for ( size_t i = 0; i < first.size(); i++ )
+    {
+        run_first << first[i].key << '\n';
+    }
+    for ( size_t i = 0; i < second.size(); i++ )
+    {
+        run_second << second[i].key << '\n';
+    }
+    std::istringstream input_first( run_first.str() );
+    std::istringstream input_second( run_second.str() );
+    Utilities::IntersectSorted( std::istream_iterator<int>( input_first ), std::istream_iterator<int>(),
+                                std::istream_iterator<int>( input_second ), std::istream_iterator<int>(),
+                                []( int a, int b )
+    {
+        return a < b ? -1 : a > b ? 1 : 0;
+    },
+    [&]( int a, int )
+    {
+        run_matches.push_back( a );
+    } );
+    for ( size_t i = 0; i < expected_first.size(); i++ )
+    {
+        expected_keys.push_back( expected_first[i].key );
+    }
+    check( run_matches == expected_keys, "IntersectSorted over input iterators", first.size(), second.size(), 1 );
+
+    //------------------------------Parallel-----------------------------------//
+    for ( size_t num_parts = 1; num_parts <= first.size() + 3; num_parts += 1 + num_parts / 2 )
+    {
+        std::vector<std::vector<Element> > parts_first( num_parts );
+        std::vector<std::vector<Element> > parts_second( num_parts );
+        std::vector<std::vector<Element> > parts_only_first( num_parts );
+        std::vector<std::vector<Element> > parts_only_second( num_parts );
+
+        Utilities::ParallelMergeJoin( first.begin(), first.end(), second.begin(), second.end(), compareKeys,
+                                      num_parts,
+                                      [&]( size_t part, const Element & a, const Element & b )
+        {
+            parts_first[part].push_back( a );
+            parts_second[part].push_back( b );
+        },
+        [&]( size_t part, const Element & a )
+        {
+            parts_only_first[part].push_back( a );
+        },
+        [&]( size_t part, const Element & b )
+        {
+            parts_only_second[part].push_back( b );
+        } );
+        check( concatenate( parts_first ) == expected_first && concatenate( parts_second ) == expected_second &&
+               concatenate( parts_only_first ) == expected_difference, "ParallelMergeJoin", first.size(),
+               second.size(), num_parts );
+
+        // Every element of both ranges is seen once
+        only_second.clear();
+        std::set_difference( second.begin(), second.end(), first.begin(), first.end(),
+                             std::back_inserter( only_second ), lessKey );
+        check( concatenate( parts_only_second ) == only_second, "ParallelMergeJoin second only", first.size(),
+               second.size(), num_parts );
+
+        for ( size_t part = 0; part < num_parts; part++ )
+        {
+            parts_first[part].clear();
+        }
+        Utilities::ParallelIntersectSorted( first.begin(), first.end(), second.begin(), second.end(),
+                                            compareKeys, num_parts,
+                                            [&]( size_t part, const Element & a, const Element & )
+        {
+            parts_first[part].push_back( a );
+        } );
+        check( concatenate( parts_first ) == expected_first, "ParallelIntersectSorted", first.size(),
+               second.size(), num_parts );
+
+        //------------------------------Hashed---------------------------------//
+        table.clear();
+        for ( size_t i = 0; i < second.size(); i++ )
+        {
+            table[second[i].key] = second[i].index;
+        }
+        std::vector<std::vector<Element> > parts_found( num_parts );
+        std::vector<std::vector<Element> > parts_missing( num_parts );
+        std::vector<Element> expected_found;
+        std::vector<Element> expected_missing;
+        bool entries_match = true;
+
+        Utilities::IntersectHashed( first.begin(), first.end(), table, []( const Element & a )
+        {
+            return a.key;
+        }, num_parts,
+        [&]( size_t part, const Element & a, const std::pair<const int, int>& entry )
+        {
+            parts_found[part].push_back( a );
+            entries_match = entries_match && entry.first == a.key;
+        } );
+        Utilities::DifferenceHashed( first.begin(), first.end(), table, []( const Element & a )
+        {
+            return a.key;
+        }, num_parts,
+        [&]( size_t part, const Element & a )
+        {
+            parts_missing[part].push_back( a );
+        } );
+        for ( size_t i = 0; i < first.size(); i++ )
+        {
+            ( table.count( first[i].key ) != 0 ? expected_found : expected_missing ).push_back( first[i] );
+        }
+        check( entries_match && concatenate( parts_found ) == expected_found, "IntersectHashed", first.size(),
+               second.size(), num_parts );
+        check( concatenate( parts_missing ) == expected_missing, "DifferenceHashed", first.size(),
+               second.size(), num_parts );
+    }
+}
+
+//--------------------------------Main----------------------------------------//
+int main()
+{
+    std::mt19937 random( 1 );
+    std::vector<Element> empty;
+    std::vector<Element> first;
+    std::vector<Element> second;
+
+    checkRanges( empty, empty );
+    checkRanges( makeRange( random, 5, 3 ), empty );
+    checkRanges( empty, makeRange( random, 5, 3 ) );
+
+    // Few keys repeat many times, many keys rarely
+    for ( int round = 0; round < 200; round++ )
+    {
+        first = makeRange( random, random() % 60, round % 2 == 0 ? 8 : 200 );
+        second = makeRange( random, random() % 60, round % 2 == 0 ? 8 : 200 );
+        checkRanges( first, second );
+    }
+
+    if ( STATUS == 0 )
+    {
+        std::cout << "PASS: utilities" << std::endl;
+    }
+    return STATUS;
+}
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Writes NUM reads drawn from a pool of POOL sequences of LENGTH bases, each
+# read a copy of a pool sequence with up to two substitutions, a quarter of
+# them trimmed by up to a fifth, and an occasional N. Exact and near
+# duplicates are spread over the whole file, so a file of more than 8 MB has
+# them in different chunks. Qualities vary by read, so some reads fail quality
+# control. With a second file, its reads are the mates "/2" of the reads "/1"
+# of the first.
+#
+# Usage: make_reads.sh NUM LENGTH POOL FILE [FILE_2]
+
+awk -v num="$1" -v length_="$2" -v pool="$3" -v file="$4" -v file2="$5" '
+function sequence(n,    s, i)
+{
+    s = ""
+    for (i = 0; i < n; i++)
+    {
+        s = s substr("ACGT", int(rand() * 4) + 1, 1)
+    }
+    return s
+}
+function mutate(s,    n, i, pos, base)
+{
+    n = int(rand() * 3)
+    for (i = 0; i < n; i++)
+    {
+        pos = int(rand() * length(s)) + 1
+        base = rand() < 0.05 ? "N" : substr("ACGT", int(rand() * 4) + 1, 1)
+        s = substr(s, 1, pos - 1) base substr(s, pos + 1)
+    }
+    return rand() < 0.25 ? substr(s, 1, length(s) - int(rand() * length(s) / 5)) : s
+}
+function quality(n,    q, mean, i)
+{
+    q = ""
+    mean = 10 + int(rand() * 30)
+    for (i = 0; i < n; i++)
+    {
+        q = q sprintf("%c", 33 + mean + int(rand() * 11) - 5)
+    }
+    return q
+}
+BEGIN {
+    srand(7)
+    for (p = 0; p < pool; p++)
+    {
+        first[p] = sequence(length_)
+        second[p] = sequence(length_)
+    }
+    for (r = 0; r < num; r++)
+    {
+        p = int(rand() * pool)
+        s = mutate(first[p])
+        printf "@read%d/1\n%s\n+\n%s\n", r, s, quality(length(s)) > file
+        if (file2 != "")
+        {
+            s = mutate(second[p])
+            printf "@read%d/2\n%s\n+\n%s\n", r, s, quality(length(s)) > file2
+        }
+    }
+}'
@@ -0,0 +1,85 @@
+#!/bin/sh
+# Dedup with a 1 byte --mem-limit spills every record to its own run, the
+# merged output, on several threads and with every --keep policy, must match
+# the in-memory output and no run file may be left. Near-duplicate clusters
+# of a generated file of several chunks must not depend on the number of
+# threads.
+
+BIN=${BIN:-bin}
+DATA=${DATA:-testdata}
+OUT=$(mktemp -d)
+STATUS=0
+
+fail()
+{
+    echo "FAIL: $1"
+    STATUS=1
+}
+
+for KEEP in last first best-quality
+do
+for FASTQ in "$DATA/qualitycontrol_pass1.fastq" "$DATA/qualitycontrol_pass1.out.fastq" \
+             "$DATA/reconcile_pass1.fastq" "$DATA/reconcile_pass2.fastq"
+do
+    NAME=$(basename "$FASTQ" .fastq).$KEEP
+    "$BIN/NGSXRemoveDuplicates" --fq-in "$FASTQ" --fq-out "$OUT/$NAME.mem.fastq" \
+        --stats "$OUT/$NAME.mem.stats" --keep $KEEP > /dev/null || fail "$NAME in memory"
+    TMPDIR=$OUT "$BIN/NGSXRemoveDuplicates" --fq-in "$FASTQ" --fq-out "$OUT/$NAME.spill.fastq" \
+        --stats "$OUT/$NAME.spill.stats" --keep $KEEP --mem-limit 1 --threads 3 > "$OUT/$NAME.log" ||
+        fail "$NAME spilled"
+    grep -q "sorted runs spilled" "$OUT/$NAME.log" || fail "$NAME did not spill"
+    cmp -s "$OUT/$NAME.mem.fastq" "$OUT/$NAME.spill.fastq" || fail "$NAME output differs"
+    cmp -s "$OUT/$NAME.mem.stats" "$OUT/$NAME.spill.stats" || fail "$NAME stats differ"
+done
+done
+
+for ORIENT in "" --canonical
+do
+    NAME=paired$ORIENT
+    "$BIN/NGSXRemoveDuplicatesPairedEnd" --fq1-in "$DATA/reconcile_pass1.fastq" \
+        --fq2-in "$DATA/reconcile_pass2.fastq" --fq1-out "$OUT/$NAME.mem_1.fastq" \
+        --fq2-out "$OUT/$NAME.mem_2.fastq" --stats "$OUT/$NAME.mem.stats" $ORIENT > /dev/null ||
+        fail "$NAME in memory"
+    TMPDIR=$OUT "$BIN/NGSXRemoveDuplicatesPairedEnd" --fq1-in "$DATA/reconcile_pass1.fastq" \
+        --fq2-in "$DATA/reconcile_pass2.fastq" --fq1-out "$OUT/$NAME.spill_1.fastq" \
+        --fq2-out "$OUT/$NAME.spill_2.fastq" --stats "$OUT/$NAME.spill.stats" $ORIENT \
+        --mem-limit 1 > "$OUT/$NAME.log" || fail "$NAME spilled"
+    grep -q "sorted runs spilled" "$OUT/$NAME.log" || fail "$NAME did not spill"
+    cmp -s "$OUT/$NAME.mem_1.fastq" "$OUT/$NAME.spill_1.fastq" || fail "$NAME first output differs"
+    cmp -s "$OUT/$NAME.mem_2.fastq" "$OUT/$NAME.spill_2.fastq" || fail "$NAME second output differs"
+    cmp -s "$OUT/$NAME.mem.stats" "$OUT/$NAME.spill.stats" || fail "$NAME stats differ"
+done
+
+# A read one substitution from the first is a near-duplicate, one two away is not
+printf '@a\nACGTACGTAC\n+\nIIIIIIIIII\n@b\nACGTTCGTAC\n+\nIIIIIIIIII\n@c\nACGTTCGTCC\n+\nIIIIIIIIII\n' \
+    > "$OUT/near.fastq"
+"$BIN/NGSXRemoveDuplicates" --fq-in "$OUT/near.fastq" --fq-out "$OUT/near.out.fastq" \
+    --stats "$OUT/near.stats" --keep first --max-mismatches 1 > /dev/null || fail "near in memory"
+[ "$(grep -c '^@' "$OUT/near.out.fastq")" -eq 2 ] || fail "near clusters"
+grep -q '^@b' "$OUT/near.out.fastq" && fail "near kept the second read"
+# Case is ignored, a lowercase copy and a read one substitution away join the seed
+printf '@a\nACGTACGTAC\n+\nIIIIIIIIII\n@b\nacgtacgtac\n+\nIIIIIIIIII\n@c\nACGTTCGTAC\n+\nIIIIIIIIII\n' \
+    > "$OUT/case.fastq"
+"$BIN/NGSXRemoveDuplicates" --fq-in "$OUT/case.fastq" --fq-out "$OUT/case.out.fastq" \
+    --stats "$OUT/case.stats" --keep first --max-mismatches 1 > /dev/null || fail "near lowercase"
+[ "$(grep -c '^@' "$OUT/case.out.fastq")" -eq 1 ] || fail "near lowercase clusters"
+# Near-duplicates lie in different 8 MB chunks of the generated file, so the
+# parsing threads must meet them in other slots than the one holding the seed
+sh "$(dirname "$0")/make_reads.sh" 60000 150 20000 "$OUT/reads.fastq"
+"$BIN/NGSXRemoveDuplicates" --fq-in "$OUT/reads.fastq" --fq-out "$OUT/reads.exact.fastq" \
+    --stats "$OUT/reads.exact.stats" > /dev/null || fail "reads exact"
+for THREADS in 1 3
+do
+    "$BIN/NGSXRemoveDuplicates" --fq-in "$OUT/reads.fastq" --fq-out "$OUT/reads.near.$THREADS.fastq" \
+        --stats "$OUT/reads.near.$THREADS.stats" --max-mismatches 2 --threads $THREADS > /dev/null ||
+        fail "reads near on $THREADS threads"
+done
+cmp -s "$OUT/reads.near.1.fastq" "$OUT/reads.near.3.fastq" || fail "reads near output differs"
+[ "$(wc -l < "$OUT/reads.near.1.fastq")" -lt "$(wc -l < "$OUT/reads.exact.fastq")" ] ||
+    fail "reads near removed no near-duplicate"
+
+ls "$OUT" | grep -q NGSXDedupRun && fail "run files left in $OUT"
+
+rm -rf "$OUT"
+[ $STATUS -eq 0 ] && echo "PASS: dedup spill"
+exit $STATUS
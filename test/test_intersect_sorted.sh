@@ -0,0 +1,76 @@
+#!/bin/sh
+# FastQIntersect --sorted must merge inputs sorted by the recipe of the README,
+# paste - - - - | LC_ALL=C sort -k1,1 -t " ", which orders "@A.B/1" before
+# "@A/1", from files and from standard input, and write the pairs the unsorted
+# intersection writes. Old style and Casava 1.8 ids are both checked.
+
+BIN=${BIN:-bin}
+OUT=$(mktemp -d)
+STATUS=0
+
+fail()
+{
+    echo "FAIL: $1"
+    STATUS=1
+}
+
+sort_fastq()
+{
+    paste - - - - | LC_ALL=C sort -k1,1 -t " " | tr "\t" "\n"
+}
+
+for STYLE in slash casava
+do
+    for NAME in A A.B A.B.C C A_1 A-2
+    do
+        if [ $STYLE = slash ]
+        then
+            printf '@%s/1\nACGT\n+\nIIII\n' $NAME >> "$OUT/$STYLE.unsorted_1.fastq"
+            printf '@%s/2\nTTTT\n+\nIIII\n' $NAME >> "$OUT/$STYLE.unsorted_2.fastq"
+        else
+            printf '@%s 1:N:0:1\nACGT\n+\nIIII\n' $NAME >> "$OUT/$STYLE.unsorted_1.fastq"
+            printf '@%s 2:N:0:1\nTTTT\n+\nIIII\n' $NAME >> "$OUT/$STYLE.unsorted_2.fastq"
+        fi
+    done
+    # The second file lacks a mate
+    if [ $STYLE = slash ]
+    then
+        printf '@B/1\nACGT\n+\nIIII\n' >> "$OUT/$STYLE.unsorted_1.fastq"
+    else
+        printf '@B 1:N:0:1\nACGT\n+\nIIII\n' >> "$OUT/$STYLE.unsorted_1.fastq"
+    fi
+    sort_fastq < "$OUT/$STYLE.unsorted_1.fastq" > "$OUT/$STYLE.sorted_1.fastq"
+    sort_fastq < "$OUT/$STYLE.unsorted_2.fastq" > "$OUT/$STYLE.sorted_2.fastq"
+
+    "$BIN/NGSXFastQIntersect" --fq1-in "$OUT/$STYLE.unsorted_1.fastq" --fq2-in "$OUT/$STYLE.unsorted_2.fastq" \
+        --fq1-out "$OUT/$STYLE.index_1.fastq" --fq2-out "$OUT/$STYLE.index_2.fastq" \
+        --stats "$OUT/$STYLE.index.stats" > /dev/null || fail "$STYLE unsorted"
+    "$BIN/NGSXFastQIntersect" --fq1-in "$OUT/$STYLE.sorted_1.fastq" --fq2-in "$OUT/$STYLE.sorted_2.fastq" \
+        --fq1-out "$OUT/$STYLE.merge_1.fastq" --fq2-out "$OUT/$STYLE.merge_2.fastq" \
+        --stats "$OUT/$STYLE.merge.stats" --sorted > "$OUT/$STYLE.merge.log" || fail "$STYLE sorted"
+    grep -q "not sorted" "$OUT/$STYLE.merge.log" && fail "$STYLE sorted files taken as unsorted"
+    "$BIN/NGSXFastQIntersect" --fq1-in - --fq2-in "$OUT/$STYLE.sorted_2.fastq" \
+        --fq1-out "$OUT/$STYLE.pipe_1.fastq" --fq2-out "$OUT/$STYLE.pipe_2.fastq" \
+        --stats "$OUT/$STYLE.pipe.stats" --sorted < "$OUT/$STYLE.sorted_1.fastq" > /dev/null 2>&1 ||
+        fail "$STYLE sorted standard input"
+
+    # Merged pairs come in input order, the unsorted ones in read name order
+    for MATE in 1 2
+    do
+        sort_fastq < "$OUT/$STYLE.index_$MATE.fastq" > "$OUT/$STYLE.expected_$MATE.fastq"
+        [ "$(grep -c '^@' "$OUT/$STYLE.expected_$MATE.fastq")" -eq 6 ] || fail "$STYLE unsorted pairs"
+        for NAME in merge pipe
+        do
+            cmp -s "$OUT/$STYLE.expected_$MATE.fastq" "$OUT/$STYLE.${NAME}_$MATE.fastq" ||
+                fail "$STYLE $NAME _$MATE.fastq differs"
+        done
+    done
+    for NAME in merge pipe
+    do
+        cmp -s "$OUT/$STYLE.index.stats" "$OUT/$STYLE.$NAME.stats" || fail "$STYLE $NAME stats differ"
+    done
+done
+
+rm -rf "$OUT"
+[ $STATUS -eq 0 ] && echo "PASS: intersect sorted"
+exit $STATUS
@@ -0,0 +1,89 @@
+#!/bin/sh
+# NGSXPipeline --stages qc,dedup,stats must write the same fastq and stats
+# files as QualityControl, RemoveDuplicates and FastQStats chained with
+# --stream, single-end and paired, on one and four threads, for an input of
+# several chunks. Its intersect stage must write the same pairs as
+# FastQIntersect when read names repeat in both files.
+
+BIN=${BIN:-bin}
+OUT=$(mktemp -d)
+STATUS=0
+QC="--phred 33 -q 20 -p 0.5 -l 30"
+
+fail()
+{
+    echo "FAIL: $1"
+    STATUS=1
+}
+
+sh "$(dirname "$0")/make_reads.sh" 60000 150 20000 "$OUT/reads_1.fastq" "$OUT/reads_2.fastq"
+
+# Single-end
+"$BIN/NGSXQualityControl" --fq-in "$OUT/reads_1.fastq" --fq-out - --stats "$OUT/chain.qc.stats" \
+    $QC --stream 2> /dev/null |
+    "$BIN/NGSXRemoveDuplicates" --fq-in - --fq-out - --stats "$OUT/chain.dedup.stats" --stream 2> /dev/null |
+    tee "$OUT/chain.fastq" | "$BIN/NGSXFastQStats" - "$OUT/chain.reads.tsv" > /dev/null 2>&1 ||
+    fail "single-end modules"
+for THREADS in 1 4
+do
+    NAME=single.$THREADS
+    "$BIN/NGSXPipeline" --fq-in "$OUT/reads_1.fastq" --fq-out "$OUT/$NAME.fastq" \
+        --stages qc,dedup,stats --stats-prefix "$OUT/$NAME" $QC --threads $THREADS > /dev/null ||
+        fail "$NAME pipeline"
+    for FILE in .fastq .qc.stats .dedup.stats .reads.tsv
+    do
+        cmp -s "$OUT/chain$FILE" "$OUT/$NAME$FILE" || fail "$NAME $FILE differs"
+    done
+done
+
+# Paired
+"$BIN/NGSXQualityControlPairedEnd" --fq1-in "$OUT/reads_1.fastq" --fq2-in "$OUT/reads_2.fastq" \
+    --fq1-out "$OUT/qc_1.fastq" --fq2-out "$OUT/qc_2.fastq" --stats "$OUT/chain.paired.qc.stats" \
+    $QC --stream > /dev/null || fail "paired qc"
+"$BIN/NGSXRemoveDuplicatesPairedEnd" --fq1-in "$OUT/qc_1.fastq" --fq2-in "$OUT/qc_2.fastq" \
+    --fq1-out "$OUT/chain.paired_1.fastq" --fq2-out "$OUT/chain.paired_2.fastq" \
+    --stats "$OUT/chain.paired.dedup.stats" --stream > /dev/null || fail "paired dedup"
+"$BIN/NGSXFastQStats" "$OUT/chain.paired_1.fastq" "$OUT/chain.paired.reads_1.tsv" > /dev/null ||
+    fail "paired first stats"
+"$BIN/NGSXFastQStats" "$OUT/chain.paired_2.fastq" "$OUT/chain.paired.reads_2.tsv" > /dev/null ||
+    fail "paired second stats"
+for THREADS in 1 4
+do
+    NAME=paired.$THREADS
+    "$BIN/NGSXPipeline" --fq1-in "$OUT/reads_1.fastq" --fq2-in "$OUT/reads_2.fastq" \
+        --fq1-out "$OUT/${NAME}_1.fastq" --fq2-out "$OUT/${NAME}_2.fastq" \
+        --stages qc,dedup,stats --stats-prefix "$OUT/$NAME" $QC --threads $THREADS > /dev/null ||
+        fail "$NAME pipeline"
+    for FILE in _1.fastq _2.fastq .qc.stats .dedup.stats .reads_1.tsv .reads_2.tsv
+    do
+        cmp -s "$OUT/chain.paired$FILE" "$OUT/$NAME$FILE" || fail "$NAME $FILE differs"
+    done
+done
+
+# Paired with the second mates on standard output, no message may reach it
+"$BIN/NGSXPipeline" --fq1-in "$OUT/reads_1.fastq" --fq2-in "$OUT/reads_2.fastq" \
+    --fq1-out "$OUT/stdout_1.fastq" --fq2-out - --stages qc,dedup,stats --stats-prefix "$OUT/stdout" \
+    $QC 2> /dev/null > "$OUT/stdout_2.fastq" || fail "paired standard output pipeline"
+cmp -s "$OUT/chain.paired_1.fastq" "$OUT/stdout_1.fastq" || fail "paired standard output _1.fastq differs"
+cmp -s "$OUT/chain.paired_2.fastq" "$OUT/stdout_2.fastq" || fail "paired standard output _2.fastq differs"
+
+# Intersect, names repeat in both files and the second has no mate for some
+awk 'NR % 4 == 1 { $0 = "@read" int((NR - 1) / 4) % 7000 "/1" } 1' "$OUT/reads_1.fastq" \
+    > "$OUT/repeat_1.fastq"
+awk 'NR % 4 == 1 { $0 = "@read" int((NR - 1) / 4) % 9000 "/2" } NR % 8 < 5 && NR % 8 > 0' \
+    "$OUT/reads_2.fastq" > "$OUT/repeat_2.fastq"
+"$BIN/NGSXFastQIntersect" --fq1-in "$OUT/repeat_1.fastq" --fq2-in "$OUT/repeat_2.fastq" \
+    --fq1-out "$OUT/intersect_1.fastq" --fq2-out "$OUT/intersect_2.fastq" \
+    --stats "$OUT/intersect.stats" > /dev/null || fail "intersect module"
+"$BIN/NGSXPipeline" --fq1-in "$OUT/repeat_1.fastq" --fq2-in "$OUT/repeat_2.fastq" \
+    --fq1-out "$OUT/pipeline_1.fastq" --fq2-out "$OUT/pipeline_2.fastq" \
+    --stages intersect --stats-prefix "$OUT/pipeline" > /dev/null || fail "intersect pipeline"
+for FILE in _1.fastq _2.fastq
+do
+    cmp -s "$OUT/intersect$FILE" "$OUT/pipeline$FILE" || fail "intersect $FILE differs"
+done
+cmp -s "$OUT/intersect.stats" "$OUT/pipeline.intersect.stats" || fail "intersect stats differ"
+
+rm -rf "$OUT"
+[ $STATUS -eq 0 ] && echo "PASS: pipeline"
+exit $STATUS
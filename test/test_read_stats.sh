@@ -0,0 +1,65 @@
+#!/bin/sh
+# FastQStats --aggregate must report the known values of a small file, and
+# on a generated file of several chunks, whose accumulators are merged, the
+# same report on one and three threads with the totals, GC, N content and
+# deduplicated percentage counted here by awk.
+
+BIN=${BIN:-bin}
+OUT=$(mktemp -d)
+STATUS=0
+
+fail()
+{
+    echo "FAIL: $1"
+    STATUS=1
+}
+
+# Report line, fields given as arguments joined by tabs
+has_line()
+{
+    FILE=$1
+    shift
+    LINE=$(printf '%s\t' "$@")
+    grep -qxF "${LINE%	}" "$FILE"
+}
+
+# Phred 40, 10 and 20 reads of 4, 4 and 2 bases
+printf '@a\nACGT\n+\nIIII\n@b\nGGCN\n+\n++++\n@c\nGG\n+\n55\n' > "$OUT/small.fastq"
+"$BIN/NGSXFastQStats" "$OUT/small.fastq" "$OUT/small.txt" --aggregate > /dev/null || fail "small report"
+has_line "$OUT/small.txt" "Total Sequences" 3 || fail "small total"
+has_line "$OUT/small.txt" "Sequence length" 2-4 || fail "small lengths"
+has_line "$OUT/small.txt" "%GC" 70 || fail "small GC"
+has_line "$OUT/small.txt" 1 23.33 20 10 40 10 40 || fail "small quality of position 1"
+has_line "$OUT/small.txt" 4 25.00 10 10 40 10 40 || fail "small quality of position 4"
+has_line "$OUT/small.txt" 1 66.67 33.33 0.00 0.00 || fail "small content of position 1"
+has_line "$OUT/small.txt" 75 1 || fail "small GC histogram"
+has_line "$OUT/small.txt" 4 50.00 || fail "small N content of position 4"
+has_line "$OUT/small.txt" "#Total Deduplicated Percentage" 100.00 || fail "small duplication"
+
+# About 17 MB, three 8 MB chunks
+sh "$(dirname "$0")/make_reads.sh" 60000 150 20000 "$OUT/reads.fastq"
+for THREADS in 1 3
+do
+    "$BIN/NGSXFastQStats" "$OUT/reads.fastq" "$OUT/reads.$THREADS.txt" --aggregate --threads $THREADS \
+        > /dev/null || fail "reads on $THREADS threads"
+done
+cmp -s "$OUT/reads.1.txt" "$OUT/reads.3.txt" || fail "reads report depends on the threads"
+awk 'NR % 4 == 2 {
+         reads++
+         bases += length($0)
+         gc += gsub(/[GC]/, "&")
+         n += substr($0, 1, 1) == "N"
+         if (!($0 in seen)) { seen[$0] = 1; distinct++ }
+     }
+     END {
+         printf "Total Sequences\t%d\nTotal Bases\t%d\n%%GC\t%d\n", reads, bases, int((gc * 100 + int(bases / 2)) / bases)
+         printf "1\t%.2f\n#Total Deduplicated Percentage\t%.2f\n", n * 100 / reads, distinct * 100 / reads
+     }' "$OUT/reads.fastq" > "$OUT/reads.expected.txt"
+while IFS= read -r LINE
+do
+    grep -qxF "$LINE" "$OUT/reads.3.txt" || fail "reads report lacks: $LINE"
+done < "$OUT/reads.expected.txt"
+
+rm -rf "$OUT"
+[ $STATUS -eq 0 ] && echo "PASS: read stats"
+exit $STATUS